@@ -0,0 +1,56 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+namespace llvm {
+class BasicBlock;
+class Function;
+class Instruction;
+class PostDominatorTree;
+}
+
+namespace pdg {
+
+class DominanceIntervals;
+
+/// Control dependencies of blocks of a single function, by Ferrante, Ottenstein and Warren.
+/// Block is control dependent on terminator of block B if it is in the post-dominance frontier of B,
+/// i.e. it post-dominates a successor of B but not B itself. Frontiers are collected by walking
+/// the post-dominator tree up from successors of each branching block until the immediate
+/// post-dominator of the branch, so the cost is linear in CFG size plus number of dependencies.
+class ControlDependencies
+{
+public:
+    using Branches = std::vector<llvm::Instruction*>;
+
+public:
+    ControlDependencies(llvm::Function& F, const llvm::PostDominatorTree& postDomTree);
+    /// Same, from immediate post-dominators kept in the snapshot
+    ControlDependencies(llvm::Function& F, const DominanceIntervals& intervals);
+
+    ControlDependencies(const ControlDependencies& ) = delete;
+    ControlDependencies(ControlDependencies&& ) = delete;
+    ControlDependencies& operator =(const ControlDependencies& ) = delete;
+    ControlDependencies& operator =(ControlDependencies&& ) = delete;
+
+public:
+    /// Terminators the block is control dependent on, empty for blocks executed unconditionally
+    const Branches& getControllingBranches(llvm::BasicBlock* block) const;
+
+    /// Number of block to branch dependencies
+    unsigned size() const
+    {
+        return m_dependenciesNum;
+    }
+
+private:
+    template <typename PostDominators>
+    void compute(llvm::Function& F, const PostDominators& postDominators);
+
+private:
+    std::unordered_map<llvm::BasicBlock*, Branches> m_blockBranches;
+    unsigned m_dependenciesNum;
+}; // class ControlDependencies
+
+} // namespace pdg
@@ -5,26 +5,79 @@
 
 namespace llvm {
 
+class BasicBlock;
+class Function;
 class Value;
 } // namespace llvm
 
 namespace pdg {
 
-class PDGNode;
-
 /// Interface to query def-use results
 class DefUseResults
 {
 public:
-    using PDGNodeTy = std::shared_ptr<PDGNode>;
-    using PDGNodes = std::vector<PDGNodeTy>;
-    using DefSite = std::pair<llvm::Value*, PDGNodeTy>;
+    /// Definition site of a value. Either a single defining value,
+    /// or definitions reaching the use through a phi, given with their blocks.
+    /// Def-use results do not create graph nodes, PDGBuilder does.
+    struct DefSite
+    {
+        DefSite() = default;
+
+        explicit DefSite(llvm::Value* defValue)
+            : value(defValue)
+        {
+        }
+
+        DefSite(const std::vector<llvm::Value*>& values,
+                const std::vector<llvm::BasicBlock*>& blocks)
+            : phiValues(values)
+            , phiBlocks(blocks)
+        {
+        }
+
+        bool isPhi() const
+        {
+            return !phiValues.empty();
+        }
+
+        bool empty() const
+        {
+            return !value && phiValues.empty();
+        }
+
+        llvm::Value* value = nullptr;
+        std::vector<llvm::Value*> phiValues;
+        std::vector<llvm::BasicBlock*> phiBlocks;
+    };
 
 public:
     virtual ~DefUseResults() {}
 
     virtual DefSite getDefNode(llvm::Value* value) = 0;
+
+    /// Whether def sites of memory uses of a function may lie in other functions
+    virtual bool hasInterproceduralDefSites() const
+    {
+        return true;
+    }
+
+    /// Drops results cached for values of the function, called when its body has changed.
+    /// Whole program results are not recomputed
+    virtual void invalidate(llvm::Function* F)
+    {
+    }
+
+    /// Called before def sites of memory uses of the function are requested.
+    /// Results may compute them for the whole function at once
+    virtual void prepareFunction(llvm::Function* F)
+    {
+    }
+
+    /// Called when def sites of all memory uses of the function have been requested.
+    /// Caches needed only while answering them can be dropped, results stay
+    virtual void finishFunction(llvm::Function* F)
+    {
+    }
 }; // class DefUseResults
 
 } // namespace pdg
-
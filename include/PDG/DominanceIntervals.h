@@ -0,0 +1,98 @@
+#pragma once
+
+#include "llvm/ADT/DenseMap.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace llvm {
+class BasicBlock;
+class DominatorTree;
+class Function;
+class PostDominatorTree;
+}
+
+namespace pdg {
+
+/// Snapshot of dominator and post-dominator trees of a single function.
+/// Every block gets DFS in and out numbers in both trees, A dominates B iff the interval of A
+/// encloses the interval of B, so a query is a block index lookup and two comparisons.
+/// Immediate post-dominators are kept for control dependence computation.
+/// The snapshot does not refer to the trees it was taken from.
+class DominanceIntervals
+{
+public:
+    DominanceIntervals(llvm::Function& F,
+                       const llvm::DominatorTree& domTree,
+                       const llvm::PostDominatorTree& postDomTree);
+
+    DominanceIntervals(const DominanceIntervals& ) = delete;
+    DominanceIntervals(DominanceIntervals&& ) = delete;
+    DominanceIntervals& operator =(const DominanceIntervals& ) = delete;
+    DominanceIntervals& operator =(DominanceIntervals&& ) = delete;
+
+public:
+    /// Same semantics as llvm::DominatorTree::dominates: blocks not in the tree are dominated
+    /// by every block and dominate none
+    bool dominates(llvm::BasicBlock* blockA, llvm::BasicBlock* blockB) const
+    {
+        return enclose(m_domIntervals, getBlockIndex(blockA), getBlockIndex(blockB));
+    }
+
+    bool posdominates(llvm::BasicBlock* blockA, llvm::BasicBlock* blockB) const
+    {
+        return enclose(m_postDomIntervals, getBlockIndex(blockA), getBlockIndex(blockB));
+    }
+
+    bool isInPostDomTree(llvm::BasicBlock* block) const
+    {
+        const unsigned index = getBlockIndex(block);
+        return index != NoBlock && m_postDomIntervals[index].in != NotInTree;
+    }
+
+    /// Null for blocks post-dominated by the virtual exit only, and for blocks not in the tree
+    llvm::BasicBlock* getImmediatePostDominator(llvm::BasicBlock* block) const;
+
+private:
+    static const unsigned NoBlock = ~0u;
+    static const uint32_t NotInTree = ~0u;
+
+    struct Interval
+    {
+        uint32_t in = NotInTree;
+        uint32_t out = NotInTree;
+    };
+    using Intervals = std::vector<Interval>;
+
+    unsigned getBlockIndex(llvm::BasicBlock* block) const
+    {
+        auto pos = m_blockIndices.find(block);
+        return pos == m_blockIndices.end() ? NoBlock : pos->second;
+    }
+
+    static bool enclose(const Intervals& intervals, unsigned indexA, unsigned indexB)
+    {
+        if (indexA == indexB) {
+            return true;
+        }
+        if (indexB == NoBlock || intervals[indexB].in == NotInTree) {
+            return true;
+        }
+        if (indexA == NoBlock || intervals[indexA].in == NotInTree) {
+            return false;
+        }
+        return intervals[indexA].in <= intervals[indexB].in && intervals[indexB].out <= intervals[indexA].out;
+    }
+
+    template <typename DomTreeNode>
+    void numberTree(const DomTreeNode* root, Intervals& intervals);
+
+private:
+    llvm::DenseMap<llvm::BasicBlock*, unsigned> m_blockIndices;
+    std::vector<llvm::BasicBlock*> m_blocks;
+    Intervals m_domIntervals;
+    Intervals m_postDomIntervals;
+    std::vector<unsigned> m_immediatePostDominators;
+}; // class DominanceIntervals
+
+} // namespace pdg
@@ -1,17 +1,31 @@
 #pragma once
 
+#include <memory>
+
 namespace llvm {
 class BasicBlock;
+class Function;
 }
 
 namespace pdg {
 
+class ControlDependencies;
+
 /// Interface to query dominance relationship of llvm objects
 class DominanceResults
 {
 public:
+    virtual ~DominanceResults() {}
+
     virtual bool dominates(llvm::BasicBlock* blockA, llvm::BasicBlock* blockB) = 0;
     virtual bool posdominates(llvm::BasicBlock* blockA, llvm::BasicBlock* blockB) = 0;
+    /// Control dependencies of all blocks of the function, computed at once
+    virtual std::unique_ptr<ControlDependencies> getControlDependencies(llvm::Function* F) = 0;
+
+    /// Drops results cached for the function, called when its body has changed
+    virtual void invalidate(llvm::Function* F)
+    {
+    }
 };
 
 } // namespace pdg
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "llvm/Analysis/TargetLibraryInfo.h"
+
+#include <memory>
+#include <unordered_map>
+
+namespace llvm {
+
+class AAResults;
+class AssumptionCache;
+class BasicAAResult;
+class DominatorTree;
+class Function;
+class MemorySSA;
+class Module;
+class PostDominatorTree;
+}
+
+namespace pdg {
+
+/// Function analyses needed by the builder, owned outside of any pass manager.
+/// Dominator trees are computed when a function is materialized, which happens on the thread
+/// running the build. Alias analysis and MemorySSA are computed on first request, which happens
+/// in single threaded memory def-use stage.
+/// Results stay valid until they are released or this object is destroyed.
+class FunctionAnalyses
+{
+public:
+    explicit FunctionAnalyses(llvm::Module& M);
+    ~FunctionAnalyses();
+
+    FunctionAnalyses(const FunctionAnalyses& ) = delete;
+    FunctionAnalyses(FunctionAnalyses&& ) = delete;
+    FunctionAnalyses& operator =(const FunctionAnalyses& ) = delete;
+    FunctionAnalyses& operator =(FunctionAnalyses&& ) = delete;
+
+public:
+    void computeDominance(llvm::Function* F);
+
+    llvm::DominatorTree* getDomTree(llvm::Function* F);
+    llvm::PostDominatorTree* getPostDomTree(llvm::Function* F);
+    llvm::AAResults* getAAResults(llvm::Function* F);
+    llvm::MemorySSA* getMemorySSA(llvm::Function* F);
+    /// Frees results of the function, it should not be queried until dominance is computed again
+    void release(llvm::Function* F);
+    void releaseAll();
+
+private:
+    struct Results;
+    Results& getResults(llvm::Function* F);
+
+private:
+    llvm::TargetLibraryInfoImpl m_tlii;
+    llvm::TargetLibraryInfo m_tli;
+    std::unordered_map<llvm::Function*, std::unique_ptr<Results>> m_results;
+}; // class FunctionAnalyses
+
+} // namespace pdg
+
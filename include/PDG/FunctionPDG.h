@@ -1,34 +1,61 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "PDG.h"
+#include "PDGArena.h"
 #include "PDGLLVMNode.h"
 
 namespace pdg {
+
+/// Nodes of a single function.
+/// Node ids and value to node mapping are kept in the owning PDG, except for constants:
+/// every function using a constant gets a node of its own, which is mapped here.
+/// A detached function PDG, built concurrently with others, keeps its nodes locally
+/// with provisional ids until it is attached to the PDG.
+/// Formal argument nodes form the interface of the function and are kept in a separate arena,
+/// so that the body can be released while other functions still connect to the interface.
+/// Edges of body and interface nodes are kept in arenas of their own, which are cleared
+/// once all edges have been moved to the compact graph.
 class FunctionPDG
 {
 public:
-    using PDGNodeTy = std::shared_ptr<PDGNode>;
-    using PDGLLVMArgumentNodes = std::unordered_map<llvm::Argument*, PDGNodeTy>;
-    using PDGLLVMNodes = std::unordered_map<llvm::Value*, PDGNodeTy>;
+    using NodeId = PDGNode::NodeId;
+    using PDGNodeTy = PDGNode*;
+    /// Formal argument nodes indexed by argument number
+    using PDGLLVMArgumentNodes = std::vector<PDGNodeTy>;
     using PDGNodes = std::vector<PDGNode*>;
-    using arg_iterator = PDGLLVMArgumentNodes::iterator;
-    using arg_const_iterator = PDGLLVMArgumentNodes::const_iterator;
-    using llvm_iterator = PDGLLVMNodes::iterator;
-    using const_llvm_iterator = PDGLLVMNodes::const_iterator;
     using iterator = PDGNodes::iterator;
     using const_iterator = PDGNodes::const_iterator;
     using CallSites = std::vector<llvm::CallSite>;
+    using LocalNodes = std::vector<std::pair<llvm::Value*, PDGNodeTy>>;
+    using LocalValueNodes = std::unordered_map<llvm::Value*, PDGNodeTy>;
+
+    static const uint64_t NoFingerprint = 0;
 
 public:
-    explicit FunctionPDG(llvm::Function* F)
-        : m_function(F)
+    FunctionPDG(PDG* pdg, llvm::Function* F)
+        : m_interfaceArena(InterfaceArenaChunkSize)
+        , m_interfaceEdgeArena(InterfaceArenaChunkSize)
+        , m_pdg(pdg)
+        , m_function(F)
         , m_functionDefinitionBuilt(false)
+        , m_bodyFingerprint(NoFingerprint)
+        , m_bodyLayout(NoFingerprint)
+        , m_vaArgNode(nullptr)
+        , m_detached(false)
+        , m_provisionalBase(0)
+        , m_attachedBase(0)
     {
         if (F->isVarArg()) {
-            m_vaArgNode.reset(new PDGLLVMVaArgNode(F));
+            m_vaArgNode = m_interfaceArena.create<PDGLLVMVaArgNode>(F);
+            m_vaArgNode->setEdgeArena(&m_interfaceEdgeArena);
+            addNode(m_vaArgNode);
         }
     }
 
@@ -50,6 +77,18 @@ public:
         return const_cast<FunctionPDG*>(this)->getFunction();
     }
 
+    /// Arena owning nodes of this function
+    PDGArena& getArena()
+    {
+        return m_arena;
+    }
+
+    /// Arena owning formal argument nodes
+    PDGArena& getInterfaceArena()
+    {
+        return m_interfaceArena;
+    }
+
 
     void setFunctionDefBuilt(bool built)
     {
@@ -77,27 +116,51 @@ public:
 
     bool hasFormalArgNode(llvm::Argument* arg) const
     {
-        return m_formalArgNodes.find(arg) != m_formalArgNodes.end();
+        const unsigned argNo = arg->getArgNo();
+        return argNo < m_formalArgNodes.size() && m_formalArgNodes[argNo] != nullptr;
     }
     bool hasNode(llvm::Value* value) const
     {
-        return m_functionLLVMNodes.find(value) != m_functionLLVMNodes.end();
+        return findNode(value) != nullptr;
     }
 
     PDGNodeTy getFormalArgNode(llvm::Argument* arg)
     {
         assert(hasFormalArgNode(arg));
-        return m_formalArgNodes.find(arg)->second;
+        return m_formalArgNodes[arg->getArgNo()];
     }
     const PDGNodeTy getFormalArgNode(llvm::Argument* arg) const
     {
         return const_cast<FunctionPDG*>(this)->getFormalArgNode(arg);
     }
 
+    /// Constants other than global variables and functions get a node in each function using them
+    static bool isFunctionLocalConstant(llvm::Value* val)
+    {
+        return llvm::isa<llvm::Constant>(val) && !llvm::isa<llvm::GlobalVariable>(val) && !llvm::isa<llvm::Function>(val);
+    }
+
+    /// Returns node of the value, or null if the value does not have a node
+    PDGNodeTy findNode(llvm::Value* val) const
+    {
+        if (isFunctionLocalConstant(val)) {
+            auto pos = m_constantNodes.find(val);
+            return pos == m_constantNodes.end() ? nullptr : pos->second;
+        }
+        if (m_detached) {
+            auto pos = m_localValueNodes.find(val);
+            if (pos != m_localValueNodes.end()) {
+                return pos->second;
+            }
+        }
+        return m_pdg->findNode(val);
+    }
+
     PDGNodeTy getNode(llvm::Value* val)
     {
-        assert(hasNode(val));
-        return m_functionLLVMNodes.find(val)->second;
+        auto* node = findNode(val);
+        assert(node);
+        return node;
     }
     const PDGNodeTy getNode(llvm::Value* val) const
     {
@@ -106,82 +169,205 @@ public:
 
     bool addFormalArgNode(llvm::Argument* arg, PDGNodeTy argNode)
     {
-        auto res = m_formalArgNodes.insert(std::make_pair(arg, argNode));
-        if (res.second) {
-            m_functionNodes.push_back(res.first->second.get());
+        if (hasFormalArgNode(arg)) {
+            return false;
         }
-        return res.second;
+        argNode->setEdgeArena(&m_interfaceEdgeArena);
+        if (!addNode(arg, argNode)) {
+            return false;
+        }
+        const unsigned argNo = arg->getArgNo();
+        if (m_formalArgNodes.size() <= argNo) {
+            m_formalArgNodes.resize(m_function->arg_size(), nullptr);
+        }
+        m_formalArgNodes[argNo] = argNode;
+        return true;
     }
     bool addFormalArgNode(llvm::Argument* arg)
     {
         if (hasFormalArgNode(arg)) {
             return false;
         }
-        auto res = m_formalArgNodes.insert(std::make_pair(arg, PDGNodeTy(new PDGLLVMFormalArgumentNode(arg))));
-        assert(res.second);
-        m_functionNodes.push_back(res.first->second.get());
-        return true;
+        return addFormalArgNode(arg, m_interfaceArena.create<PDGLLVMFormalArgumentNode>(arg));
     }
 
     bool addNode(llvm::Value* val, PDGNodeTy node)
     {
-        auto res = m_functionLLVMNodes.insert(std::make_pair(val, node));
-        if (res.second) {
-            m_functionNodes.push_back(res.first->second.get());
+        assert(isOwnNode(node));
+        if (!node->hasEdgeArena()) {
+            node->setEdgeArena(&m_edgeArena);
         }
-        return res.second;
+        if (m_detached) {
+            if (!m_localValueNodes.insert(std::make_pair(val, node)).second) {
+                return false;
+            }
+            addLocalNode(val, node);
+            return true;
+        }
+        if (!m_pdg->addNode(val, node)) {
+            return false;
+        }
+        m_functionNodes.push_back(node);
+        return true;
+    }
+
+    /// Adds node of a constant used by the function, see isFunctionLocalConstant.
+    /// The node gets an id, but is not mapped to the value in PDG
+    bool addConstantNode(llvm::Constant* constant, PDGNodeTy node)
+    {
+        assert(isFunctionLocalConstant(constant));
+        if (!m_constantNodes.insert(std::make_pair(constant, node)).second) {
+            return false;
+        }
+        return addNode(node);
     }
 
     bool addNode(PDGNodeTy node)
     {
-        m_functionNodes.push_back(node.get());
+        assert(isOwnNode(node));
+        if (!node->hasEdgeArena()) {
+            node->setEdgeArena(&m_edgeArena);
+        }
+        if (m_detached) {
+            addLocalNode(nullptr, node);
+            return true;
+        }
+        m_pdg->addNode(node);
+        m_functionNodes.push_back(node);
+        return true;
     }
 
-    void addCallSite(const llvm::CallSite& callSite)
+public:
+    /// Nodes added after detaching get provisional ids starting from provisionalBase
+    /// and are not visible in PDG. Nodes of PDG must not be modified while detached.
+    void detach(NodeId provisionalBase)
     {
-        m_callSites.push_back(callSite);
+        assert(!m_detached);
+        m_detached = true;
+        m_provisionalBase = provisionalBase;
     }
 
-    const CallSites& getCallSites() const
+    bool isDetached() const
     {
-        return m_callSites;
+        return m_detached;
     }
 
-public:
-    arg_iterator formalArgBegin()
+    /// Registers local nodes in PDG in the order they were added,
+    /// and replaces provisional ids in their edges with final ones
+    void attach()
     {
-        return m_formalArgNodes.begin();
+        assert(m_detached);
+        m_attachedBase = m_pdg->size();
+        for (auto& localNode : m_localNodes) {
+            localNode.second->setNodeId(PDGNode::InvalidNodeId);
+            // values of local nodes belong to this function, no other function could map them
+            if (!localNode.first) {
+                m_pdg->addNode(localNode.second);
+            } else {
+                const bool added = m_pdg->addNode(localNode.first, localNode.second);
+                assert(added);
+                (void)added;
+            }
+        }
+        auto idMapping = [this] (NodeId id) { return getAttachedId(id); };
+        for (auto& localNode : m_localNodes) {
+            localNode.second->remapEdges(idMapping);
+        }
+        m_detached = false;
+        LocalNodes().swap(m_localNodes);
+        LocalValueNodes().swap(m_localValueNodes);
+    }
+
+    /// Final id of a node with given provisional id, valid after attaching
+    NodeId getAttachedId(NodeId id) const
+    {
+        return id < m_provisionalBase ? id : m_attachedBase + (id - m_provisionalBase);
+    }
+
+    /// Removes nodes of the function body from PDG and frees them. Formal argument nodes,
+    /// call sites calling the function and the function node stay. Edges between released and
+    /// remaining nodes are dropped. The body can be built again from the interface that is left.
+    /// Only nodes of this function's values are released, including those created while building
+    /// other functions, e.g. definition sites of their memory uses
+    void releaseBody()
+    {
+        assert(!m_detached);
+        m_bodyFingerprint = NoFingerprint;
+        m_bodyLayout = NoFingerprint;
+        PDGNodes interfaceNodes;
+        PDGNodes bodyNodes;
+        for (auto* node : m_functionNodes) {
+            if (isInterfaceNode(node)) {
+                interfaceNodes.push_back(node);
+            } else {
+                // values of a changed body may be deleted already, their parents were checked
+                // when nodes were added, the arena freeing them must be this function's
+                assert(m_arena.contains(node));
+                bodyNodes.push_back(node);
+            }
+        }
+        m_pdg->removeNodes(bodyNodes);
+        m_functionNodes.swap(interfaceNodes);
+        LocalValueNodes().swap(m_constantNodes);
+        m_edgeArena.clear();
+        m_arena.clear();
     }
-    arg_iterator formalArgEnd()
+
+    /// Frees memory of node edges. Edges of all nodes must have been released, see PDG::freeze
+    void clearEdgeArenas()
+    {
+        assert(std::none_of(m_functionNodes.begin(), m_functionNodes.end(), [] (PDGNodeTy node) {
+            return !node->getInEdges().empty() || !node->getOutEdges().empty();
+        }));
+        m_edgeArena.clear();
+        m_interfaceEdgeArena.clear();
+    }
+
+    void addCallSite(const llvm::CallSite& callSite)
     {
-        return m_formalArgNodes.end();
+        m_callSites.push_back(callSite);
     }
-    arg_const_iterator formalArgBegin() const
+
+    /// Forgets call sites made by given instructions. Instructions are compared by address only,
+    /// so they may have been deleted already
+    void removeCallSites(const std::unordered_set<llvm::Value*>& instructions)
     {
-        return m_formalArgNodes.begin();
+        auto end = std::remove_if(m_callSites.begin(), m_callSites.end(),
+                                  [&instructions] (const llvm::CallSite& callSite) {
+                                      return instructions.count(callSite.getInstruction()) != 0;
+                                  });
+        m_callSites.erase(end, m_callSites.end());
     }
-    arg_const_iterator formalArgEnd() const
+
+    /// Hash of the body the nodes were built from, see PDGBuilder::computeFingerprint.
+    /// NoFingerprint if the body is not built
+    uint64_t getBodyFingerprint() const
     {
-        return m_formalArgNodes.end();
+        return m_bodyFingerprint;
     }
 
-    llvm_iterator llvmNodesBegin()
+    void setBodyFingerprint(uint64_t fingerprint)
     {
-        return m_functionLLVMNodes.begin();
+        m_bodyFingerprint = fingerprint;
     }
-    llvm_iterator llvmNodesEnd()
+
+    /// Hash of the body's values the nodes are keyed by, see PDGBuilder::computeLayout
+    uint64_t getBodyLayout() const
     {
-        return m_functionLLVMNodes.end();
+        return m_bodyLayout;
     }
-    const_llvm_iterator llvmNodesBegin() const
+
+    void setBodyLayout(uint64_t layout)
     {
-        return m_functionLLVMNodes.begin();
+        m_bodyLayout = layout;
     }
-    const_llvm_iterator llvmNodesEnd() const
+
+    const CallSites& getCallSites() const
     {
-        return m_functionLLVMNodes.end();
+        return m_callSites;
     }
 
+public:
     iterator nodesBegin()
     {
         return m_functionNodes.begin();
@@ -230,14 +416,55 @@ public:
     }
 
 private:
+    /// Nodes of local values, i.e. instructions, blocks and arguments, belong to the function of the value.
+    /// Nodes of constants belong to every function using them
+    bool isOwnNode(PDGNodeTy node) const
+    {
+        auto* llvmNode = llvm::dyn_cast<PDGLLVMNode>(node);
+        if (!llvmNode || !llvmNode->getNodeValue() || isFunctionLocalConstant(llvmNode->getNodeValue())) {
+            return true;
+        }
+        return node->getParent() == m_function;
+    }
+
+    bool isInterfaceNode(PDGNodeTy node) const
+    {
+        return node == m_vaArgNode
+            || std::find(m_formalArgNodes.begin(), m_formalArgNodes.end(), node) != m_formalArgNodes.end();
+    }
+
+    void addLocalNode(llvm::Value* val, PDGNodeTy node)
+    {
+        node->setNodeId(m_provisionalBase + m_localNodes.size());
+        m_localNodes.push_back(std::make_pair(val, node));
+        m_functionNodes.push_back(node);
+    }
+
+private:
+    // formal arguments are few, the default chunk would waste memory of functions with released bodies
+    static const std::size_t InterfaceArenaChunkSize = 1024;
+
+    // arenas go first to outlive containers referring to their nodes
+    PDGArena m_arena;
+    PDGArena m_interfaceArena;
+    PDGArena m_edgeArena;
+    PDGArena m_interfaceEdgeArena;
+    PDG* m_pdg;
     llvm::Function* m_function;
     bool m_functionDefinitionBuilt;
+    uint64_t m_bodyFingerprint;
+    uint64_t m_bodyLayout;
     PDGLLVMArgumentNodes m_formalArgNodes;
     PDGNodeTy m_vaArgNode;
     // TODO: formal ins, formal outs? formal vaargs?
-    PDGLLVMNodes m_functionLLVMNodes;
     PDGNodes m_functionNodes;
     CallSites m_callSites;
+    bool m_detached;
+    NodeId m_provisionalBase;
+    NodeId m_attachedBase;
+    LocalNodes m_localNodes;
+    LocalValueNodes m_localValueNodes;
+    LocalValueNodes m_constantNodes;
 }; // class FunctionPDG
 
 } // namespace pdg
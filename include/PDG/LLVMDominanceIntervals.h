@@ -0,0 +1,58 @@
+#pragma once
+
+#include "DominanceResults.h"
+#include "DominanceIntervals.h"
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+namespace llvm {
+class DominatorTree;
+class PostDominatorTree;
+class Function;
+}
+
+namespace pdg {
+
+/// Dominance results answered from DominanceIntervals snapshots.
+/// Control dependencies are computed from the post-dominator tree directly, snapshots are taken
+/// only for dominance queries, when a function is first queried or when snapshot is called.
+/// Trees are not referred to afterwards. Getters backed by a pass manager are not thread safe,
+/// so neither are these results, parallel builds do not query them from workers.
+class LLVMDominanceIntervals : public DominanceResults
+{
+public:
+    using DominatorTreeGetter =
+                            std::function<const llvm::DominatorTree* (llvm::Function* F)>;
+    using PostDominatorTreeGetter =
+                            std::function<const llvm::PostDominatorTree* (llvm::Function* F)>;
+
+public:
+    LLVMDominanceIntervals(const DominatorTreeGetter& domTreeGetter,
+                           const PostDominatorTreeGetter& postdomTreeGetter);
+
+    LLVMDominanceIntervals(const LLVMDominanceIntervals& ) = delete;
+    LLVMDominanceIntervals(LLVMDominanceIntervals&& ) = delete;
+    LLVMDominanceIntervals& operator =(const LLVMDominanceIntervals& ) = delete;
+    LLVMDominanceIntervals& operator =(LLVMDominanceIntervals&& ) = delete;
+
+public:
+    virtual bool dominates(llvm::BasicBlock* blockA, llvm::BasicBlock* blockB) override;
+    virtual bool posdominates(llvm::BasicBlock* blockA, llvm::BasicBlock* blockB) override;
+    virtual std::unique_ptr<ControlDependencies> getControlDependencies(llvm::Function* F) override;
+    virtual void invalidate(llvm::Function* F) override;
+
+    /// Snapshot of the function, taken on first request. The last one is kept at hand,
+    /// queries in one function in a row do not look the function up
+    const DominanceIntervals& snapshot(llvm::Function* F);
+
+private:
+    DominatorTreeGetter m_domTreeGetter;
+    PostDominatorTreeGetter m_posdomTreeGetter;
+    std::unordered_map<llvm::Function*, std::unique_ptr<DominanceIntervals>> m_snapshots;
+    llvm::Function* m_lastFunction;
+    const DominanceIntervals* m_lastSnapshot;
+}; // class LLVMDominanceIntervals
+
+} // namespace pdg
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "PDG/PDG/DefUseResults.h"
+#include "PDG/PDG/ModRefCache.h"
 
+#include <cstdint>
 #include <functional>
 #include <unordered_set>
 #include <unordered_map>
@@ -13,6 +15,7 @@ class BasicBlock;
 class Function;
 class Instruction;
 class MemoryAccess;
+class MemoryDef;
 class MemoryPhi;
 class MemorySSA;
 class Value;
@@ -25,6 +28,34 @@ class LLVMMemorySSADefUseAnalysisResults : public DefUseResults
 public:
     using MemorySSAGetter = std::function<llvm::MemorySSA* (llvm::Function*)>;
     using AARGetter = std::function<llvm::AAResults* (llvm::Function*)>;
+    using AARReleaser = std::function<void (llvm::Function*)>;
+
+    /// Counters of walks from memory phis to definitions of a location
+    struct WalkStatistics
+    {
+        uint64_t queriesNum = 0;
+        // queries answered from memo table without walking
+        uint64_t memoHitsNum = 0;
+        // accesses of a walk whose def sites were memoized by an earlier walk
+        uint64_t memoReusesNum = 0;
+        uint64_t visitedAccessesNum = 0;
+        uint64_t longestWalk = 0;
+        // locations whose def sites were computed for a whole function at once
+        uint64_t sweepsNum = 0;
+        // walk results filled by sweeps
+        uint64_t precomputedNum = 0;
+
+        double getHitRate() const
+        {
+            return queriesNum == 0 ? 0 : double(memoHitsNum) / queriesNum;
+        }
+
+        double getAverageWalkLength() const
+        {
+            const uint64_t walksNum = queriesNum - memoHitsNum;
+            return walksNum == 0 ? 0 : double(visitedAccessesNum) / walksNum;
+        }
+    };
 
 public:
     LLVMMemorySSADefUseAnalysisResults(const MemorySSAGetter& mssaGetter,
@@ -37,6 +68,45 @@ public:
 
 public:
     virtual DefSite getDefNode(llvm::Value* value) override;
+    /// MemorySSA of a function only sees definitions in the function
+    virtual bool hasInterproceduralDefSites() const override
+    {
+        return false;
+    }
+    virtual void invalidate(llvm::Function* F) override;
+    virtual void prepareFunction(llvm::Function* F) override;
+    /// Drops memoized walks and alias answers of the function, def sites of its values stay
+    virtual void finishFunction(llvm::Function* F) override;
+
+    /// When set, prepareFunction computes def sites of all loads of the function reached by memory phis,
+    /// in one sweep per location read by more than one phi. Set by default
+    void setPrecomputeDefSites(bool precompute)
+    {
+        m_precomputeDefSites = precompute;
+    }
+
+    /// Called with functions whose alias analysis results are no longer needed,
+    /// i.e. when the function is finished or invalidated
+    void setAAResultsReleaser(const AARReleaser& releaser)
+    {
+        m_aarReleaser = releaser;
+    }
+
+    const WalkStatistics& getWalkStatistics() const
+    {
+        return m_walkStatistics;
+    }
+
+    /// Number of alias analysis answers kept while a function is being connected
+    void setModRefCacheCapacity(std::size_t capacity)
+    {
+        m_modRefCache.setCapacity(capacity);
+    }
+
+    const ModRefCache::Statistics& getModRefCacheStatistics() const
+    {
+        return m_modRefCache.getStatistics();
+    }
 
 private:
     struct PHI {
@@ -48,18 +118,63 @@ private:
         }
     };
 
+    /// Def sites of a location reachable from a memory access
+    struct WalkKey
+    {
+        llvm::MemoryAccess* access;
+        const llvm::Value* pointer;
+        uint64_t size;
+
+        bool operator ==(const WalkKey& other) const
+        {
+            return access == other.access && pointer == other.pointer && size == other.size;
+        }
+    };
+
+    struct WalkKeyHash
+    {
+        std::size_t operator()(const WalkKey& key) const;
+    };
+
+    using WalkResults = std::unordered_map<WalkKey, PHI, WalkKeyHash>;
+    /// Accesses of a function defining memory, i.e. phis and defs, in block order
+    struct FunctionAccesses
+    {
+        std::vector<llvm::MemoryAccess*> accesses;
+        std::unordered_map<llvm::MemoryAccess*, unsigned> indices;
+    };
+
 private:
     llvm::MemoryAccess* getMemoryDefAccess(llvm::Instruction* instr, llvm::MemorySSA* memorySSA);
-    PHI getDefSites(llvm::Value* value,
-                    llvm::MemoryAccess* access,
-                    llvm::MemorySSA* memorySSA,
-                    llvm::AAResults* aa,
-                    std::unordered_set<llvm::MemoryAccess*>& processedAccesses);
+    bool isDefSite(llvm::MemoryDef* def, const llvm::Value* pointer, uint64_t size, llvm::AAResults* aa);
+    /// Definitions of memory read by the value, reachable from the access without passing
+    /// another definition of it. Memoized, loads of the same location share walks
+    const PHI& getDefSites(llvm::Value* value,
+                           llvm::MemoryAccess* access,
+                           llvm::MemorySSA* memorySSA,
+                           llvm::AAResults* aa);
+    /// Forward sweep over phis reaching the given ones, computing def sites of the location as the least
+    /// fixed point of def sites of phi operands. Results of the given phis are memoized as walks
+    void sweepLocation(const llvm::Value* pointer,
+                       uint64_t size,
+                       const std::vector<llvm::MemoryPhi*>& phis,
+                       const FunctionAccesses& functionAccesses,
+                       llvm::MemorySSA* memorySSA,
+                       llvm::AAResults* aa,
+                       WalkResults& walkResults);
 
 private:
-    const MemorySSAGetter& m_memorySSAGetter;
-    const AARGetter& m_aarGetter;
-    std::unordered_map<llvm::Value*, DefSite> m_valueDefSite;
+    MemorySSAGetter m_memorySSAGetter;
+    AARGetter m_aarGetter;
+    AARReleaser m_aarReleaser;
+    using ValueDefSites = std::unordered_map<llvm::Value*, DefSite>;
+
+    // by function of the value, null for values outside of functions
+    std::unordered_map<llvm::Function*, ValueDefSites> m_valueDefSites;
+    std::unordered_map<llvm::Function*, WalkResults> m_walkResults;
+    WalkStatistics m_walkStatistics;
+    ModRefCache m_modRefCache;
+    bool m_precomputeDefSites;
 }; // class LLVMMemorySSADefUseAnalysisResults
 
 } // namespace pdg
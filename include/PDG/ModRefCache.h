@@ -0,0 +1,99 @@
+#pragma once
+
+#include "llvm/Analysis/AliasAnalysis.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+namespace llvm {
+class Function;
+class Instruction;
+class Value;
+}
+
+namespace pdg {
+
+/// Cache of alias analysis mod/ref answers in front of AAResults, keyed by (instruction, pointer, size).
+/// Holds answers for instructions of one function at a time: it is cleared when def-use of the function
+/// is finished, or when an instruction of another function is queried.
+/// The number of answers is bounded, the cache is flushed when it is full.
+class ModRefCache
+{
+public:
+    static const std::size_t DefaultCapacity = 1 << 16;
+
+    struct Statistics
+    {
+        uint64_t hitsNum = 0;
+        uint64_t missesNum = 0;
+        // clears because the cache was full
+        uint64_t flushesNum = 0;
+
+        double getHitRate() const
+        {
+            const uint64_t queriesNum = hitsNum + missesNum;
+            return queriesNum == 0 ? 0 : double(hitsNum) / queriesNum;
+        }
+    };
+
+public:
+    explicit ModRefCache(std::size_t capacity = DefaultCapacity);
+
+    ModRefCache(const ModRefCache& ) = delete;
+    ModRefCache(ModRefCache&& ) = delete;
+    ModRefCache& operator =(const ModRefCache& ) = delete;
+    ModRefCache& operator =(ModRefCache&& ) = delete;
+
+public:
+    llvm::ModRefInfo getModRefInfo(llvm::AAResults* aa,
+                                   llvm::Instruction* instr,
+                                   const llvm::Value* pointer,
+                                   uint64_t size);
+
+    /// Drops answers if they are of the given function
+    void clear(llvm::Function* F);
+
+    /// Zero capacity disables caching
+    void setCapacity(std::size_t capacity)
+    {
+        m_capacity = capacity;
+    }
+
+    std::size_t size() const
+    {
+        return m_answers.size();
+    }
+
+    const Statistics& getStatistics() const
+    {
+        return m_statistics;
+    }
+
+private:
+    struct Key
+    {
+        llvm::Instruction* instr;
+        const llvm::Value* pointer;
+        uint64_t size;
+
+        bool operator ==(const Key& other) const
+        {
+            return instr == other.instr && pointer == other.pointer && size == other.size;
+        }
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(const Key& key) const;
+    };
+
+private:
+    std::size_t m_capacity;
+    // function of cached answers
+    llvm::Function* m_function;
+    std::unordered_map<Key, llvm::ModRefInfo, KeyHash> m_answers;
+    Statistics m_statistics;
+}; // class ModRefCache
+
+} // namespace pdg
@@ -1,8 +1,13 @@
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
+#include "PDGArena.h"
+#include "PDGCompactGraph.h"
 #include "PDGLLVMNode.h"
 
 namespace llvm {
@@ -10,6 +15,7 @@ namespace llvm {
 class Module;
 class Function;
 class GlobalVariable;
+class Value;
 } // namespace llvm
 
 namespace pdg {
@@ -19,24 +25,31 @@ class PDGLLVMGlobalVariableNode;
 class PDGLLVMFunctionNode;
 
 /// Program Dependence Graph
+/// Every node gets a dense module-wide id when it is added to the graph.
+/// Values having a node (globals, functions and function local values) are mapped
+/// to node ids with a single table. Constants have a node per function using them,
+/// which is mapped by the function PDG, see FunctionPDG::isFunctionLocalConstant.
 class PDG
 {
 public:
-    // TODO: consider collecting all nodes in one map with Value key
-    using PDGNodeTy = std::shared_ptr<PDGNode>;
-    using PDGFunctionNodeTy = std::shared_ptr<PDGLLVMFunctionNode>;
-    using GlobalVariableNodes = std::unordered_map<llvm::GlobalVariable*, PDGNodeTy>;
-    using FunctionNodes = std::unordered_map<llvm::Function*, PDGFunctionNodeTy>;
+    using NodeId = PDGNode::NodeId;
+    using EdgeKinds = PDGEdge::EdgeKinds;
+    using PDGNodeTy = PDGNode*;
+    using PDGFunctionNodeTy = PDGLLVMFunctionNode*;
+    using Nodes = std::vector<PDGNodeTy>;
+    using ValueNodeIds = std::unordered_map<llvm::Value*, NodeId>;
+    /// Kinds of edges recorded between two nodes, keyed by packed (source, destination) ids.
+    /// Used by the builder to deduplicate edges of one function at a time
+    using EdgeKindsMap = std::unordered_map<uint64_t, EdgeKinds>;
     using FunctionPDGTy = std::shared_ptr<FunctionPDG>;
     using FunctionPDGs = std::unordered_map<llvm::Function*, FunctionPDGTy>;
+    /// Builds PDG of a pending function, see addPendingFunction
+    using FunctionPDGBuilder = std::function<void (llvm::Function* F)>;
 
 public:
-    explicit PDG(llvm::Module* M)
-        : m_module(M)
-    {
-    }
+    explicit PDG(llvm::Module* M);
     
-    ~PDG() = default;
+    ~PDG();
     PDG(const PDG& ) = delete;
     PDG(PDG&& ) = delete;
     PDG& operator =(const PDG& ) = delete;
@@ -48,76 +61,128 @@ public:
         return m_module;
     }
 
-    const GlobalVariableNodes& getGlobalVariableNodes() const
+    /// Arena owning module level nodes: global variables and functions
+    PDGArena& getArena()
     {
-        return m_globalVariableNodes;
+        return m_arena;
     }
 
-    GlobalVariableNodes& getGlobalVariableNodes()
+    const FunctionPDGs& getFunctionPDGs() const
     {
-        return m_globalVariableNodes;
+        return m_functionPDGs;
     }
 
-    const FunctionNodes& getFunctionNodes() const
+    FunctionPDGs& getFunctionPDGs()
     {
-        return m_functionNodes;
+        return m_functionPDGs;
     }
 
-    FunctionNodes& getFunctionNodes()
+public:
+    /// Number of nodes. Node ids are in range [0, size())
+    NodeId size() const
     {
-        return m_functionNodes;
+        return m_nodes.size();
     }
 
-    const FunctionPDGs& getFunctionPDGs() const
+    const Nodes& getNodes() const
     {
-        return m_functionPDGs;
+        return m_nodes;
     }
 
-    FunctionPDGs& getFunctionPDGs()
+    /// Null for ids of removed nodes
+    PDGNodeTy getNode(NodeId id) const
     {
-        return m_functionPDGs;
+        return m_nodes[id];
     }
 
-    bool hasGlobalVariableNode(llvm::GlobalVariable* variable) const
+    /// Returns node of the value, or null if the value does not have a node
+    PDGNodeTy findNode(llvm::Value* value) const
     {
-        return m_globalVariableNodes.find(variable) != m_globalVariableNodes.end();
+        auto pos = m_valueNodeIds.find(value);
+        return pos == m_valueNodeIds.end() ? nullptr : m_nodes[pos->second];
     }
 
-    bool hasFunctionNode(llvm::Function* function) const
+    bool hasNode(llvm::Value* value) const
     {
-        return m_functionNodes.find(function) != m_functionNodes.end();
+        return m_valueNodeIds.find(value) != m_valueNodeIds.end();
     }
 
-    bool hasFunctionPDG(llvm::Function* F) const
+    PDGNodeTy getNode(llvm::Value* value) const
     {
-        return m_functionPDGs.find(F) != m_functionPDGs.end();
+        auto* node = findNode(value);
+        assert(node);
+        return node;
     }
 
-    PDGNodeTy getGlobalVariableNode(llvm::GlobalVariable* variable);
-    PDGFunctionNodeTy getFunctionNode(llvm::Function* function) const;
+    /// Adds node which does not correspond to a single value, e.g. actual argument or phi
+    NodeId addNode(PDGNodeTy node);
+    /// Adds node for the value. Returns false if the value already has a node
+    bool addNode(llvm::Value* value, PDGNodeTy node);
+    /// Unregisters nodes and drops their edges from remaining nodes. Ids of removed nodes are not reused.
+    /// Frozen graph keeps edges of removed nodes in its compact graph until it is frozen again
+    void removeNodes(const Nodes& nodes);
 
-    const PDGNodeTy getGlobalVariableNode(llvm::GlobalVariable* variable) const
+    /// Records edge kind in the given map. Returns false if it is already there
+    static bool addEdgeKind(EdgeKindsMap& edgeKinds, NodeId source, NodeId dest, EdgeKinds kind);
+    /// Accounts edges added to nodes and parallel edges rejected by the builder.
+    /// The graph does not deduplicate edges itself until it is frozen
+    void addEdgeStatistics(unsigned edgesNum, unsigned duplicateEdgesNum)
     {
-        return const_cast<PDG*>(this)->getGlobalVariableNode(variable);
+        m_edgesNum += edgesNum;
+        m_duplicateEdgesNum += duplicateEdgesNum;
     }
 
-    FunctionPDGTy getFunctionPDG(llvm::Function* F);
-    const FunctionPDGTy getFunctionPDG(llvm::Function* F) const
+    /// Number of edges recorded. Exact after freezing, before that parallel edges
+    /// added by different build stages are counted separately
+    unsigned getEdgesNum() const
     {
-        return const_cast<PDG*>(this)->getFunctionPDG(F);
+        return m_edgesNum;
     }
 
-    bool addGlobalVariableNode(llvm::GlobalVariable* variable, PDGNodeTy node)
+    /// Number of parallel edges rejected by the builder or merged by freezing
+    unsigned getDuplicateEdgesNum() const
     {
-        return m_globalVariableNodes.insert(std::make_pair(variable, node)).second;
+        return m_duplicateEdgesNum;
     }
 
-    bool addGlobalVariableNode(llvm::GlobalVariable* variable);
-    bool addFunctionNode(llvm::Function* function, PDGFunctionNodeTy node)
+public:
+    bool hasGlobalVariableNode(llvm::GlobalVariable* variable) const;
+    bool hasFunctionNode(llvm::Function* function) const;
+
+    /// True for built and pending functions
+    bool hasFunctionPDG(llvm::Function* F) const
+    {
+        return m_functionPDGs.find(F) != m_functionPDGs.end() || isPendingFunction(F);
+    }
+
+    bool isPendingFunction(llvm::Function* F) const
     {
-        return m_functionNodes.insert(std::make_pair(function, node)).second;
+        return m_pendingFunctions.find(F) != m_pendingFunctions.end();
     }
 
+    /// Returns PDG of the function as it is now, without building pending functions.
+    /// Null if there is none
+    FunctionPDGTy findFunctionPDG(llvm::Function* F) const
+    {
+        auto pos = m_functionPDGs.find(F);
+        return pos == m_functionPDGs.end() ? nullptr : pos->second;
+    }
+
+    PDGNodeTy getGlobalVariableNode(llvm::GlobalVariable* variable) const;
+    PDGFunctionNodeTy getFunctionNode(llvm::Function* function) const;
+
+    /// Builds PDG of a pending function first. Compact graph of a frozen PDG is marked stale,
+    /// it has to be refreshed before it is queried again, see PDGCompactGraph::refresh.
+    /// Building is not thread safe, even through the const overload
+    FunctionPDGTy getFunctionPDG(llvm::Function* F);
+    const FunctionPDGTy getFunctionPDG(llvm::Function* F) const
+    {
+        return const_cast<PDG*>(this)->getFunctionPDG(F);
+    }
+
+    bool addGlobalVariableNode(llvm::GlobalVariable* variable, PDGNodeTy node);
+    bool addGlobalVariableNode(llvm::GlobalVariable* variable);
+    bool addFunctionNode(llvm::Function* function, PDGFunctionNodeTy node);
     bool addFunctionNode(llvm::Function* function);
     
     bool addFunctionPDG(llvm::Function* F, FunctionPDGTy functionPDG)
@@ -125,11 +190,59 @@ public:
         return m_functionPDGs.insert(std::make_pair(F, functionPDG)).second;
     }
 
+    /// Lazy construction. PDG of a pending function is built by the function PDG builder
+    /// on first getFunctionPDG call. Functions nobody asks for are never built
+    void setFunctionPDGBuilder(const FunctionPDGBuilder& builder)
+    {
+        m_functionPDGBuilder = builder;
+    }
+
+    void addPendingFunction(llvm::Function* F)
+    {
+        m_pendingFunctions.insert(F);
+    }
+
+    unsigned getPendingFunctionsNum() const
+    {
+        return m_pendingFunctions.size();
+    }
+
+public:
+    /// Compacts finished graph into CSR form indexed by node ids.
+    /// Node edge sets are released. Nodes and edges added after freezing, e.g. by lazy construction
+    /// of a function PDG, are merged into the compact graph when it is frozen again or, for lazily
+    /// built functions, refreshed. Edges of nodes removed after freezing are dropped from it.
+    void freeze();
+
+    bool isFrozen() const
+    {
+        return m_compactGraph != nullptr;
+    }
+
+    const PDGCompactGraph* getCompactGraph() const
+    {
+        return m_compactGraph.get();
+    }
+
+    PDGCompactGraph* getCompactGraph()
+    {
+        return m_compactGraph.get();
+    }
+
 private:
+    PDGArena m_arena;
+    // edges of module level nodes, cleared when the graph is frozen
+    PDGArena m_edgeArena;
     llvm::Module* m_module;
-    GlobalVariableNodes m_globalVariableNodes;
-    FunctionNodes m_functionNodes;
+    Nodes m_nodes;
+    ValueNodeIds m_valueNodeIds;
+    unsigned m_edgesNum;
+    unsigned m_duplicateEdgesNum;
+    bool m_hasRemovedNodes;
     FunctionPDGs m_functionPDGs;
+    std::unordered_set<llvm::Function*> m_pendingFunctions;
+    FunctionPDGBuilder m_functionPDGBuilder;
+    std::unique_ptr<PDGCompactGraph> m_compactGraph;
 };
 
 } // namespace pdg
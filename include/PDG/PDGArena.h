@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace pdg {
+
+/// Bump allocator owning PDG nodes and their edge arrays.
+/// Objects are placed into large chunks and are never freed one by one.
+/// Destructors are recorded only for objects that are not trivially destructible,
+/// the memory itself is released chunk by chunk when the arena is destroyed or cleared.
+/// Growing arrays, e.g. node edges, use power of two blocks, which are reused once given back.
+class PDGArena
+{
+public:
+    explicit PDGArena(std::size_t chunkSize = DefaultChunkSize);
+    ~PDGArena();
+
+    PDGArena(const PDGArena& ) = delete;
+    PDGArena(PDGArena&& ) = delete;
+    PDGArena& operator =(const PDGArena& ) = delete;
+    PDGArena& operator =(PDGArena&& ) = delete;
+
+public:
+    template <typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        void* mem = allocate(sizeof(T), alignof(T));
+        T* object = new (mem) T(std::forward<Args>(args)...);
+        registerDestructor(object, std::is_trivially_destructible<T>());
+        return object;
+    }
+
+    /// Copies trivially destructible values into the arena, null for an empty range
+    template <typename T>
+    T* copyArray(const T* values, std::size_t size)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "arrays are never destroyed");
+        if (size == 0) {
+            return nullptr;
+        }
+        T* array = static_cast<T*>(allocate(sizeof(T) * size, alignof(T)));
+        std::uninitialized_copy(values, values + size, array);
+        return array;
+    }
+
+    /// Returns block of at least given size, which is rounded up to a power of two and stored back.
+    /// Blocks are aligned for any scalar type
+    void* allocateBlock(std::size_t& size);
+    /// Keeps block returned by allocateBlock for reuse by blocks of the same size
+    void deallocateBlock(void* block, std::size_t size);
+
+    /// Destroys all objects and releases memory, the arena can be used again
+    void clear();
+
+    /// True if the object was allocated in this arena. Linear in the number of chunks
+    bool contains(const void* object) const;
+
+    std::size_t getChunksNum() const
+    {
+        return m_chunks.size();
+    }
+
+    std::size_t getAllocatedSize() const
+    {
+        return m_allocatedSize;
+    }
+
+private:
+    static const std::size_t DefaultChunkSize = 64 * 1024;
+
+    struct Chunk
+    {
+        std::unique_ptr<char[]> memory;
+        std::size_t size;
+    };
+
+    struct Destructor
+    {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    template <typename T>
+    static void destroyObject(void* object)
+    {
+        static_cast<T*>(object)->~T();
+    }
+
+    template <typename T>
+    void registerDestructor(T* , std::true_type)
+    {
+    }
+
+    template <typename T>
+    void registerDestructor(T* object, std::false_type)
+    {
+        m_destructors.push_back(Destructor{object, &PDGArena::destroyObject<T>});
+    }
+
+    void* allocate(std::size_t size, std::size_t alignment);
+
+private:
+    const std::size_t m_chunkSize;
+    std::vector<Chunk> m_chunks;
+    char* m_current;
+    char* m_end;
+    std::size_t m_allocatedSize;
+    std::vector<Destructor> m_destructors;
+    // heads of lists of freed blocks indexed by log2 of block size, blocks keep the link to the next one
+    std::vector<void*> m_freeBlocks;
+}; // class PDGArena
+
+} // namespace pdg
+
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace pdg {
+
+/// On-disk layout of a frozen PDG.
+/// Sections are arrays of values in byte order of the writer (checked with byteOrderMark),
+/// placed at 8 byte aligned offsets, so that a mapped file is used in place.
+/// Edges are kept in the CSR form of PDGCompactGraph, node i of the file is the node with id i.
+///
+///   NodeKinds      uint8_t[nodesNum]         PDGLLVMNode::NodeType of node
+///   NodeLabels     uint32_t[nodesNum]        Strings offset of node label
+///   NodeFunctions  uint32_t[nodesNum]        index of node parent function, or InvalidIndex
+///   FunctionNames  uint32_t[functionsNum]    Strings offset of function name
+///   OutOffsets     uint32_t[nodesNum + 1]
+///   OutTargets     uint32_t[edgesNum]
+///   OutKinds       uint8_t[edgesNum]         PDGEdge::Kind of edge
+///   InOffsets      uint32_t[nodesNum + 1]
+///   InSources      uint32_t[edgesNum]
+///   InKinds        uint8_t[edgesNum]
+///   Strings        char[stringsSize]         NUL terminated strings
+///
+/// Version must be increased whenever layout, node types or edge kind values change.
+struct PDGBinaryHeader
+{
+    static const uint32_t CurrentVersion = 1;
+    static const uint32_t ByteOrderMark = 0x01020304;
+    static const uint32_t InvalidIndex = ~0u;
+    static const unsigned MagicSize = 8;
+
+    enum Section : uint32_t {
+        NodeKinds = 0,
+        NodeLabels,
+        NodeFunctions,
+        FunctionNames,
+        OutOffsets,
+        OutTargets,
+        OutKinds,
+        InOffsets,
+        InSources,
+        InKinds,
+        Strings,
+        SectionsNum
+    };
+
+    static const char* getMagic()
+    {
+        return "PDGBIN\0";
+    }
+
+    bool hasValidMagic() const
+    {
+        return std::memcmp(magic, getMagic(), MagicSize) == 0;
+    }
+
+    char magic[MagicSize];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    uint32_t nodesNum;
+    uint32_t edgesNum;
+    uint32_t functionsNum;
+    uint32_t stringsSize;
+    uint64_t sectionOffsets[SectionsNum];
+    uint64_t fileSize;
+}; // struct PDGBinaryHeader
+
+static_assert(sizeof(PDGBinaryHeader) % 8 == 0, "sections following the header must stay aligned");
+
+} // namespace pdg
+
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "PDGBinaryFormat.h"
+#include "PDGEdge.h"
+
+namespace pdg {
+
+/// Read only PDG loaded from a file written by PDGBinaryWriter.
+/// The file is mapped into memory and queried in place, no LLVM is needed to use it.
+/// Only the header and section bounds are validated on open, contents are trusted.
+class PDGBinaryGraph
+{
+public:
+    using NodeId = PDGEdge::NodeId;
+    using EdgeKinds = PDGEdge::EdgeKinds;
+    using NodeIds = std::vector<NodeId>;
+
+    static const uint32_t InvalidIndex = PDGBinaryHeader::InvalidIndex;
+
+    /// Adjacent nodes of a node with kinds of connecting edges
+    struct Adjacency
+    {
+        const NodeId* nodes;
+        const EdgeKinds* kinds;
+        unsigned size;
+    };
+
+public:
+    PDGBinaryGraph();
+    ~PDGBinaryGraph();
+    PDGBinaryGraph(const PDGBinaryGraph& ) = delete;
+    PDGBinaryGraph(PDGBinaryGraph&& ) = delete;
+    PDGBinaryGraph& operator =(const PDGBinaryGraph& ) = delete;
+    PDGBinaryGraph& operator =(PDGBinaryGraph&& ) = delete;
+
+public:
+    /// Maps the file. Returns false and sets error message on failure
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const
+    {
+        return m_header != nullptr;
+    }
+
+    const std::string& getError() const
+    {
+        return m_error;
+    }
+
+public:
+    NodeId size() const
+    {
+        return m_header->nodesNum;
+    }
+
+    unsigned edgesSize() const
+    {
+        return m_header->edgesNum;
+    }
+
+    /// PDGLLVMNode::NodeType of the node
+    unsigned getNodeKind(NodeId id) const
+    {
+        return m_nodeKinds[id];
+    }
+
+    const char* getNodeLabel(NodeId id) const
+    {
+        return m_strings + m_nodeLabels[id];
+    }
+
+    /// Index of the function node belongs to, InvalidIndex for module level nodes
+    uint32_t getNodeFunction(NodeId id) const
+    {
+        return m_nodeFunctions[id];
+    }
+
+    uint32_t functionsSize() const
+    {
+        return m_header->functionsNum;
+    }
+
+    const char* getFunctionName(uint32_t index) const
+    {
+        return m_strings + m_functionNames[index];
+    }
+
+    /// Index of the function with given name, InvalidIndex if there is no such function
+    uint32_t findFunction(const std::string& name) const;
+
+    Adjacency getSuccessors(NodeId id) const
+    {
+        return Adjacency{m_outTargets + m_outOffsets[id],
+                         m_outKinds + m_outOffsets[id],
+                         m_outOffsets[id + 1] - m_outOffsets[id]};
+    }
+
+    Adjacency getPredecessors(NodeId id) const
+    {
+        return Adjacency{m_inSources + m_inOffsets[id],
+                         m_inKinds + m_inOffsets[id],
+                         m_inOffsets[id + 1] - m_inOffsets[id]};
+    }
+
+public:
+    /// Same semantics as PDGCompactGraph slices
+    NodeIds forwardSlice(NodeId from, EdgeKinds kinds = PDGEdge::AnyEdge) const;
+    NodeIds backwardSlice(NodeId from, EdgeKinds kinds = PDGEdge::AnyEdge) const;
+
+private:
+    bool fail(const std::string& error);
+    bool mapSections();
+
+    template <typename T>
+    bool getSection(PDGBinaryHeader::Section section, uint64_t size, const T*& data);
+
+    NodeIds slice(NodeId from, EdgeKinds kinds, bool forward) const;
+
+private:
+    std::string m_error;
+    void* m_mapping;
+    uint64_t m_mappingSize;
+    const PDGBinaryHeader* m_header;
+    const uint8_t* m_nodeKinds;
+    const uint32_t* m_nodeLabels;
+    const uint32_t* m_nodeFunctions;
+    const uint32_t* m_functionNames;
+    const uint32_t* m_outOffsets;
+    const NodeId* m_outTargets;
+    const EdgeKinds* m_outKinds;
+    const uint32_t* m_inOffsets;
+    const NodeId* m_inSources;
+    const EdgeKinds* m_inKinds;
+    const char* m_strings;
+}; // class PDGBinaryGraph
+
+} // namespace pdg
+
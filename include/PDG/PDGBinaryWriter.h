@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+
+namespace pdg {
+
+class PDG;
+
+/// Writes frozen PDG in the format described in PDGBinaryFormat.h
+class PDGBinaryWriter
+{
+public:
+    explicit PDGBinaryWriter(const PDG& pdg);
+
+    PDGBinaryWriter(const PDGBinaryWriter& ) = delete;
+    PDGBinaryWriter(PDGBinaryWriter&& ) = delete;
+    PDGBinaryWriter& operator =(const PDGBinaryWriter& ) = delete;
+    PDGBinaryWriter& operator =(PDGBinaryWriter&& ) = delete;
+
+public:
+    /// Returns false if the file can not be written
+    bool write(const std::string& path);
+
+private:
+    const PDG& m_pdg;
+}; // class PDGBinaryWriter
+
+} // namespace pdg
+
@@ -1,14 +1,21 @@
 #pragma once
 
+#include "llvm/IR/CallSite.h"
 #include "llvm/IR/InstVisitor.h"
 
+#include "ControlDependencies.h"
+#include "PDGEdge.h"
+
+#include <cstdint>
 #include <memory>
+#include <unordered_map>
 #include <unordered_set>
 #include <functional>
+#include <string>
+#include <vector>
 
 namespace llvm {
 
-class CallSite;
 class MemorySSA;
 class Module;
 class Function;
@@ -20,12 +27,24 @@ class Value;
 namespace pdg {
 
 class PDG;
+class PDGArena;
 class PDGNode;
 class FunctionPDG;
 class DefUseResults;
 class DominanceResults;
 class IndirectCallSiteResults;
 
+/// Builds PDG of a module in stages.
+/// Intraprocedural phase builds SSA data and control dependencies of functions, records values read
+/// from memory and call sites. It does not need def-use or indirect call site results, hence can run
+/// while pointer analysis is still running, provided that dominance results do not come from a pass
+/// manager. Function PDGs can be built by several threads,
+/// each worker thread gets its own builder context.
+/// Memory def-use stage connects recorded memory reads to their definitions.
+/// Link phase resolves callees of all recorded call sites and adds interprocedural edges.
+/// In lazy mode only module level nodes are built upfront, see buildLazily.
+/// Build scope can be restricted to functions reachable from given roots, see setRoots.
+/// PDG of a changed module can be updated by rebuilding changed functions only, see update.
 class PDGBuilder : public llvm::InstVisitor<PDGBuilder>
 {
 public:
@@ -34,9 +53,53 @@ public:
     using DefUseResultsTy = std::shared_ptr<DefUseResults>;
     using IndCSResultsTy = std::shared_ptr<IndirectCallSiteResults>;
     using DominanceResultsTy = std::shared_ptr<DominanceResults>;
-    using PDGNodeTy = std::shared_ptr<PDGNode>;
+    using PDGNodeTy = PDGNode*;
     using FunctionSet = std::unordered_set<llvm::Function*>;
 
+    /// Call site with its intraprocedural nodes, connected to callees in link step
+    struct CallSiteStub
+    {
+        llvm::CallSite callSite;
+        PDGNodeTy callNode;
+        // indexed by argument number, null for arguments without nodes
+        std::vector<PDGNodeTy> actualArgNodes;
+    };
+    using CallSiteStubs = std::vector<CallSiteStub>;
+
+    /// Value read from memory, connected to its definition site in memory def-use stage
+    struct MemoryUse
+    {
+        llvm::Function* function;
+        llvm::Value* value;
+        PDGNodeTy node;
+    };
+    using MemoryUses = std::vector<MemoryUse>;
+
+    /// Callees of a call site resolved in link phase
+    struct CallSiteCallees
+    {
+        FunctionSet callees;
+        bool isIndirectCall = false;
+    };
+    /// Link results, keyed by call instructions. Can be kept and reused by another build of the same module
+    using LinkResults = std::unordered_map<llvm::Instruction*, CallSiteCallees>;
+    using LinkResultsTy = std::shared_ptr<LinkResults>;
+    /// Makes body of a lazily loaded function available. Returns false if the body can not be loaded
+    using FunctionMaterializer = std::function<bool (llvm::Function* F)>;
+    /// Receives finished function PDG in streaming build
+    using FunctionPDGSink = std::function<void (FunctionPDG& functionPDG)>;
+
+    /// Functions of the module as seen by update
+    struct UpdateResults
+    {
+        // bodies unchanged since they were built
+        std::vector<llvm::Function*> reusedFunctions;
+        // changed bodies, including ones which became declarations
+        std::vector<llvm::Function*> rebuiltFunctions;
+        // functions new to the graph and definitions which had no body built
+        std::vector<llvm::Function*> addedFunctions;
+    };
+
 public:
     explicit PDGBuilder(llvm::Module* M);
 
@@ -46,12 +109,89 @@ public:
     PDGBuilder& operator =(const PDGBuilder& ) = delete;
     PDGBuilder& operator =(PDGBuilder&& ) = delete;
  
+    /// Runs all stages
     void build();
+    /// Builds function PDGs. Memory reads stay unconnected to definitions, call sites to callees
+    void buildIntraprocedural();
+    /// Connects memory reads recorded by intraprocedural phase to their definitions
+    void connectMemoryDefUses();
+    /// Connects call sites recorded by intraprocedural phase to their callees
+    void link();
+    /// Creates PDG with module level nodes only. Defined functions are left pending and are built
+    /// on first PDG::getFunctionPDG call together with their memory def-use and outgoing call edges.
+    /// Edges from call sites of a caller appear once the caller is built.
+    /// All analysis results should be set and stay valid for the lifetime of the PDG
+    void buildLazily();
+    /// Builds functions one at a time. Each function gets its memory def-use and outgoing call edges,
+    /// is passed to the sink and has its body released, so that memory is bounded by the largest function.
+    /// Nodes given to the sink keep their edges, edges from nodes of other functions appear as in edges.
+    /// Edges into a function from its callers are passed along with the callers.
+    /// Resulting PDG keeps module level nodes and formal arguments only and can not be frozen.
+    /// If def-use results may find def sites in other functions (SVFG), no body is released before
+    /// all functions are built and passed to the sink, memory is not bounded then.
+    /// Link results are kept only if they were set before the build. Runs in a single thread
+    void buildStreaming(const FunctionPDGSink& sink);
+    /// Brings PDG built earlier for this module up to date with its current state.
+    /// Bodies whose fingerprints or layouts changed are released and built again, cached def-use results
+    /// of them are invalidated and the materializer is called for them again to recompute
+    /// function analyses. Call sites of rebuilt bodies are linked again, edges from unchanged
+    /// callers stay attached to formal arguments, which are kept. Frozen graph is frozen again.
+    /// Link results of the earlier build must be set, they are updated in place and entries of
+    /// call sites which are not in reused bodies are dropped.
+    /// Def-use results must find def sites within the function only (MemorySSA): memory edges
+    /// from a released body into unchanged functions would be lost. Functions and globals removed
+    /// from the module are not supported, indirect call targets are used as they are and should be
+    /// updated by the caller.
+    /// Roots, if any, should be the same as for the earlier build. Runs in a single thread
+    UpdateResults update(PDGType pdg);
 
 public:
     void setDesUseResults(DefUseResultsTy defUse);
     void setIndirectCallSitesResults(IndCSResultsTy indCSResults);
     void setDominanceResults(DominanceResultsTy domResults);
+    /// Number of threads building function PDGs in intraprocedural phase, one by default.
+    /// With more than one thread dominance results are not queried, each worker computes control
+    /// dependencies of its function from a post-dominator tree of its own and frees it right away.
+    void setThreadsNum(unsigned threadsNum);
+    /// Callees of call sites found in given link results are not resolved again
+    void setLinkResults(LinkResultsTy linkResults);
+    /// Called for each defined function right before its body is first visited.
+    /// Always called from the thread running the build, never from workers.
+    /// Functions failed to materialize are built as declarations, they get formal argument nodes only
+    void setFunctionMaterializer(const FunctionMaterializer& materializer);
+    /// Restricts the build to functions reachable from the roots over the resolved call graph,
+    /// indirect call targets included. Bodies of other functions are skipped, they get formal argument
+    /// nodes only. Reachability is computed when the build starts, so indirect call site results
+    /// should be set before intraprocedural phase. Empty set means whole module
+    void setRoots(const FunctionSet& roots);
+
+    /// Collects functions of the module whose names match any of the patterns.
+    /// A pattern matches a name equal to it or one it matches as a whole as a regular expression.
+    /// Returns false and describes the first pattern which is not a valid regular expression in error
+    static bool findFunctions(llvm::Module* M,
+                              const std::vector<std::string>& patterns,
+                              FunctionSet& functions,
+                              std::string& error);
+
+    /// Functions bodies of which are built, valid after the build has started
+    bool isInBuildScope(llvm::Function* F) const;
+
+    /// Hash of the function body structure: opcodes, types, predicates and operands, with arguments,
+    /// blocks and instructions numbered by position, globals by name and constants by contents.
+    /// Changes whenever an instruction or block is added, removed or changed, but not when
+    /// the body is replaced by an equal copy. Never equals FunctionPDG::NoFingerprint
+    static uint64_t computeFingerprint(llvm::Function* F);
+    /// Hash of the blocks and instructions the body consists of, in order. Nodes are keyed by them,
+    /// so a body with an unchanged fingerprint is reused only if its layout is the same too.
+    /// Together with the fingerprint it means every position still holds an equal instruction
+    /// at the address the nodes were built for, whatever was freed and allocated in between.
+    /// Only comparable within one process. Never equals FunctionPDG::NoFingerprint
+    static uint64_t computeLayout(llvm::Function* F);
+
+    LinkResultsTy getLinkResults() const
+    {
+        return m_linkResults;
+    }
 
     PDGType getPDG()
     {
@@ -87,10 +227,29 @@ protected:
     virtual PDGNodeTy createFormalArgNodeFor(llvm::Argument* arg);
     virtual PDGNodeTy createNullNode();
     virtual PDGNodeTy createConstantNodeFor(llvm::Constant* constant);
+    virtual PDGNodeTy createPhiNodeFor(const std::vector<llvm::Value*>& values,
+                                       const std::vector<llvm::BasicBlock*>& blocks);
 
 private:
+    /// Results of a function built by a worker, attached to PDG when all workers are done
+    struct FunctionLinkInfo;
+    using FunctionLinkInfos = std::vector<FunctionLinkInfo>;
+
+    void computeReachableFunctions();
+    void buildParallel();
+    void buildFunctionLazily(llvm::Function* F);
+    void releaseFunctionBody(FunctionPDG& functionPDG);
+    void prepareModuleNodes();
+    void attachFunctions(FunctionLinkInfos& linkInfos);
+    void resolveCallSites();
+    void linkCallSite(const CallSiteStub& stub, const CallSiteCallees& callees);
+    bool isSharedNode(PDGNodeTy node) const;
+
+    /// Returns false if the function has failed to materialize
+    bool materialize(llvm::Function* F);
     void buildFunctionPDG(llvm::Function* F);
     void buildFunctionDefinition(llvm::Function* F);
+    FunctionPDGTy getFunctionDefinition(llvm::Function* F);
     void visitGlobals();
     void visitFormalArguments(FunctionPDG* functionPDG, llvm::Function* F);
     void visitBlock(llvm::BasicBlock& B);
@@ -102,12 +261,17 @@ private:
     void selfVisitCallSite(llvm::CallSite& callSite);
     void addDataEdge(PDGNodeTy source, PDGNodeTy dest);
     void addControlEdge(PDGNodeTy source, PDGNodeTy dest);
+    void addEdge(PDGNodeTy source, PDGNodeTy dest, PDGEdge::Kind kind);
+    void resetEdgeKinds();
+    void addMemoryUse(llvm::Value* value, PDGNodeTy valueNode);
     void connectToDefSite(llvm::Value* value, PDGNodeTy valueNode);
     void addActualArgumentNodeConnections(PDGNodeTy actualArgNode,
                                           unsigned argIdx,
                                           const llvm::CallSite& cs,
                                           const FunctionSet& callees);
     void addPhiNodeConnections(PDGNodeTy node);
+    FunctionPDGTy getOwnerFunctionPDG(llvm::Function* F);
+    PDGArena& getInterfaceArenaFor(llvm::Function* F);
 
 protected:
     PDGType m_pdg;
@@ -118,6 +282,23 @@ private:
     DefUseResultsTy m_defUse;
     IndCSResultsTy m_indCSResults;
     DominanceResultsTy m_domResults;
+    // of the function being built
+    std::unique_ptr<ControlDependencies> m_controlDependencies;
+    unsigned m_threadsNum;
+    // set for worker contexts only
+    FunctionLinkInfo* m_linkInfo;
+    CallSiteStubs m_callSiteStubs;
+    MemoryUses m_memoryUses;
+    // edges added for the function being built, connected or linked, see addEdge
+    std::unordered_map<uint64_t, PDGEdge::EdgeKinds> m_edgeKinds;
+    LinkResultsTy m_linkResults;
+    FunctionMaterializer m_materializer;
+    FunctionSet m_materializedFunctions;
+    FunctionSet m_unmaterializedFunctions;
+    FunctionSet m_roots;
+    FunctionSet m_reachableFunctions;
+    // nodes with smaller ids are shared between functions and are modified by link step only
+    unsigned m_sharedNodesNum;
 }; // class PDGBuilder
 
 } // namespace pdg
@@ -0,0 +1,338 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "PDGEdge.h"
+#include "PDGNode.h"
+
+namespace pdg {
+
+/// Compressed sparse row representation of a finished PDG.
+/// Nodes are indexed by their PDG node ids, adjacency is kept in offset/target arrays
+/// with edge kinds packed in a parallel byte array.
+/// Control edges from block nodes to their members are not stored as edges, only members of each
+/// block are kept, see PDGNode::getBlockNodeId. Adjacency ranges and slices include them.
+/// Graph marked stale is rebuilt on explicit refresh, see markStale.
+class PDGCompactGraph
+{
+public:
+    using NodeId = PDGNode::NodeId;
+    using EdgeKinds = PDGEdge::EdgeKinds;
+    using Nodes = std::vector<PDGNode*>;
+    using NodeIds = std::vector<NodeId>;
+    using node_iterator = Nodes::iterator;
+    using const_node_iterator = Nodes::const_iterator;
+    using Rebuilder = std::function<void ()>;
+
+    /// Iterates over adjacent nodes of a node, dereferences to PDGNode*.
+    /// Stored edges come first, followed by implicit block membership control edges.
+    /// Edges with kinds not in the filter mask are skipped by looking at kind bytes only.
+    class adjacency_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = PDGNode*;
+        using difference_type = std::ptrdiff_t;
+        using pointer = PDGNode**;
+        using reference = PDGNode*;
+
+    public:
+        adjacency_iterator() = default;
+        adjacency_iterator(const PDGCompactGraph* graph,
+                           const NodeId* pos,
+                           const NodeId* end,
+                           const EdgeKinds* kind,
+                           const NodeId* implicitPos,
+                           const NodeId* implicitEnd,
+                           EdgeKinds kinds)
+            : m_graph(graph)
+            , m_pos(pos)
+            , m_end(end)
+            , m_kind(kind)
+            , m_implicitPos(implicitPos)
+            , m_implicitEnd(implicitEnd)
+            , m_kinds(kinds)
+        {
+            skipFiltered();
+        }
+
+        PDGNode* operator*() const
+        {
+            return m_graph->m_nodes[*m_pos];
+        }
+
+        adjacency_iterator& operator++()
+        {
+            ++m_pos;
+            if (m_kind) {
+                ++m_kind;
+                skipFiltered();
+            }
+            return *this;
+        }
+
+        adjacency_iterator operator++(int)
+        {
+            adjacency_iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const adjacency_iterator& other) const
+        {
+            return m_pos == other.m_pos;
+        }
+
+        bool operator!=(const adjacency_iterator& other) const
+        {
+            return m_pos != other.m_pos;
+        }
+
+        NodeId getNodeId() const
+        {
+            return *m_pos;
+        }
+
+        PDGEdge::Kind getEdgeKind() const
+        {
+            return m_kind ? static_cast<PDGEdge::Kind>(*m_kind) : PDGEdge::ControlEdge;
+        }
+
+        bool isDataEdge() const
+        {
+            return getEdgeKind() & PDGEdge::DataEdges;
+        }
+
+        bool isControlEdge() const
+        {
+            return getEdgeKind() & PDGEdge::ControlEdges;
+        }
+
+    private:
+        /// Skips filtered stored edges. Once they are exhausted, moves to implicit edges,
+        /// which are all control edges and so are either all visited or all skipped
+        void skipFiltered()
+        {
+            while (m_pos != m_end && !(*m_kind & m_kinds)) {
+                ++m_pos;
+                ++m_kind;
+            }
+            if (m_pos != m_end) {
+                return;
+            }
+            m_kind = nullptr;
+            m_pos = (m_kinds & PDGEdge::ControlEdge) ? m_implicitPos : m_implicitEnd;
+            m_end = m_implicitEnd;
+        }
+
+    private:
+        const PDGCompactGraph* m_graph = nullptr;
+        const NodeId* m_pos = nullptr;
+        const NodeId* m_end = nullptr;
+        // null while iterating implicit edges
+        const EdgeKinds* m_kind = nullptr;
+        const NodeId* m_implicitPos = nullptr;
+        const NodeId* m_implicitEnd = nullptr;
+        EdgeKinds m_kinds = PDGEdge::AnyEdge;
+    }; // class adjacency_iterator
+
+public:
+    PDGCompactGraph() = default;
+    ~PDGCompactGraph() = default;
+    PDGCompactGraph(const PDGCompactGraph& ) = delete;
+    PDGCompactGraph(PDGCompactGraph&& ) = delete;
+    PDGCompactGraph& operator =(const PDGCompactGraph& ) = delete;
+    PDGCompactGraph& operator =(PDGCompactGraph&& ) = delete;
+
+public:
+    /// Collects edges of given nodes into CSR arrays and releases node edge sets.
+    /// Node at position i must have id i, null for ids of removed nodes.
+    /// Can be called again with more nodes appended, edges added to nodes in between are merged in
+    /// and edges of nodes removed in between are dropped. Block members are collected from all nodes.
+    /// Parallel edges are merged, adjacent nodes are ordered by id. Returns number of edges merged.
+    /// Rebuilding invalidates adjacency iterators.
+    unsigned build(const Nodes& nodes);
+
+    /// Defers rebuilding with more nodes and edges until refresh, so that several changes
+    /// are merged in at once. The rebuilder is expected to call build. Nodes given are set to
+    /// this graph right away, so that the graph can be refreshed from any of its nodes.
+    /// Stale graph must not be queried
+    void markStale(const Nodes& addedNodes, const Rebuilder& rebuilder);
+
+    bool isStale() const
+    {
+        return m_stale;
+    }
+
+    /// Rebuilds stale graph. Queries never rebuild it implicitly, so that concurrent readers of
+    /// a fresh graph do not race; refreshing must not run concurrently with them
+    void refresh()
+    {
+        if (m_stale) {
+            m_stale = false;
+            m_rebuilder();
+        }
+    }
+
+public:
+    NodeId size() const
+    {
+        assert(!m_stale);
+        return m_nodes.size();
+    }
+
+    /// Number of stored edges
+    unsigned edgesSize() const
+    {
+        assert(!m_stale);
+        return m_outTargets.size();
+    }
+
+    /// Number of block membership control edges, which are not stored
+    unsigned implicitEdgesSize() const
+    {
+        assert(!m_stale);
+        return m_members.size();
+    }
+
+    /// Null for ids of removed nodes
+    PDGNode* getNode(NodeId id) const
+    {
+        assert(!m_stale);
+        return m_nodes[id];
+    }
+
+    bool hasNode(const PDGNode* node) const;
+    NodeId getNodeId(const PDGNode* node) const;
+
+    node_iterator nodesBegin()
+    {
+        assert(!m_stale);
+        return m_nodes.begin();
+    }
+    node_iterator nodesEnd()
+    {
+        assert(!m_stale);
+        return m_nodes.end();
+    }
+    const_node_iterator nodesBegin() const
+    {
+        assert(!m_stale);
+        return m_nodes.begin();
+    }
+    const_node_iterator nodesEnd() const
+    {
+        assert(!m_stale);
+        return m_nodes.end();
+    }
+
+    /// Adjacency ranges, optionally restricted to edges of given kinds
+    adjacency_iterator succBegin(NodeId id, EdgeKinds kinds = PDGEdge::AnyEdge) const
+    {
+        assert(!m_stale);
+        return adjacencyBegin(id, kinds, m_outOffsets, m_outTargets, m_outKinds, getMembers(id));
+    }
+    adjacency_iterator succEnd(NodeId id, EdgeKinds kinds = PDGEdge::AnyEdge) const
+    {
+        assert(!m_stale);
+        return adjacencyEnd(id, kinds, m_outOffsets, m_outTargets, m_outKinds, getMembers(id));
+    }
+    adjacency_iterator predBegin(NodeId id, EdgeKinds kinds = PDGEdge::AnyEdge) const
+    {
+        assert(!m_stale);
+        return adjacencyBegin(id, kinds, m_inOffsets, m_inSources, m_inKinds, getBlock(id));
+    }
+    adjacency_iterator predEnd(NodeId id, EdgeKinds kinds = PDGEdge::AnyEdge) const
+    {
+        assert(!m_stale);
+        return adjacencyEnd(id, kinds, m_inOffsets, m_inSources, m_inKinds, getBlock(id));
+    }
+
+    unsigned getOutDegree(NodeId id) const
+    {
+        assert(!m_stale);
+        const auto members = getMembers(id);
+        return m_outOffsets[id + 1] - m_outOffsets[id] + (members.second - members.first);
+    }
+
+    unsigned getInDegree(NodeId id) const
+    {
+        assert(!m_stale);
+        const auto block = getBlock(id);
+        return m_inOffsets[id + 1] - m_inOffsets[id] + (block.second - block.first);
+    }
+
+public:
+    /// Traversal API. Returns ids of nodes reachable from (reaching) given node,
+    /// following only edges of given kinds. The start node is included.
+    NodeIds forwardSlice(NodeId from, EdgeKinds kinds = PDGEdge::AnyEdge) const;
+    NodeIds backwardSlice(NodeId from, EdgeKinds kinds = PDGEdge::AnyEdge) const;
+
+private:
+    /// Ends of implicit edges of a node, as a range of ids
+    using IdRange = std::pair<const NodeId*, const NodeId*>;
+
+    adjacency_iterator adjacencyBegin(NodeId id,
+                                      EdgeKinds kinds,
+                                      const NodeIds& offsets,
+                                      const NodeIds& targets,
+                                      const std::vector<EdgeKinds>& edgeKinds,
+                                      IdRange implicitEnds) const
+    {
+        return adjacency_iterator(this,
+                                  targets.data() + offsets[id],
+                                  targets.data() + offsets[id + 1],
+                                  edgeKinds.data() + offsets[id],
+                                  implicitEnds.first,
+                                  implicitEnds.second,
+                                  kinds);
+    }
+
+    adjacency_iterator adjacencyEnd(NodeId id,
+                                    EdgeKinds kinds,
+                                    const NodeIds& offsets,
+                                    const NodeIds& targets,
+                                    const std::vector<EdgeKinds>& edgeKinds,
+                                    IdRange implicitEnds) const
+    {
+        return adjacency_iterator(this,
+                                  targets.data() + offsets[id + 1],
+                                  targets.data() + offsets[id + 1],
+                                  edgeKinds.data() + offsets[id + 1],
+                                  implicitEnds.second,
+                                  implicitEnds.second,
+                                  kinds);
+    }
+
+    void buildMembers();
+    /// Members of a block node, empty for other nodes
+    IdRange getMembers(NodeId id) const;
+    /// Block node of a member, empty for other nodes
+    IdRange getBlock(NodeId id) const;
+
+    NodeIds slice(NodeId from, EdgeKinds kinds, bool forward) const;
+
+private:
+    Nodes m_nodes;
+    NodeIds m_outOffsets;
+    NodeIds m_outTargets;
+    std::vector<EdgeKinds> m_outKinds;
+    NodeIds m_inOffsets;
+    NodeIds m_inSources;
+    std::vector<EdgeKinds> m_inKinds;
+    // members of block m_memberBlocks[i] are in [m_memberOffsets[i], m_memberOffsets[i + 1]) of m_members.
+    // Blocks are sorted by id
+    NodeIds m_memberBlocks;
+    NodeIds m_memberOffsets;
+    NodeIds m_members;
+    bool m_stale = false;
+    Rebuilder m_rebuilder;
+}; // class PDGCompactGraph
+
+} // namespace pdg
+
@@ -1,109 +1,80 @@
 #pragma once
 
-#include <memory>
-
-#include "PDGNode.h"
+#include <cstdint>
 
 namespace pdg {
 
-class PDGEdge {
+/// Packed edge record: source and destination node ids and a kind byte.
+/// Edges are stored by value in node adjacency lists while the graph is built,
+/// and are moved to CSR arrays of PDGCompactGraph when the graph is frozen.
+class PDGEdge
+{
 public:
-    using PDGNodeTy = std::shared_ptr<PDGNode>;
+    using NodeId = unsigned;
+    using EdgeKinds = uint8_t;
+
+    enum Kind : EdgeKinds {
+        DataEdge = 1 << 0,
+        ControlEdge = 1 << 1,
+        // actual argument to formal argument
+        ParameterInEdge = 1 << 2,
+        // returned value to function, function to call site
+        ParameterOutEdge = 1 << 3,
+        // definition reaching a use through memory
+        MemoryEdge = 1 << 4,
+        // call site to callee
+        CallEdge = 1 << 5,
+
+        // masks
+        DataEdges = DataEdge | ParameterInEdge | ParameterOutEdge | MemoryEdge,
+        ControlEdges = ControlEdge | CallEdge,
+        AnyEdge = DataEdges | ControlEdges
+    };
 
 public:
-    PDGEdge(PDGNodeTy sourceNode, PDGNodeTy destNode)
-        : m_source(sourceNode)
-        , m_dest(destNode)
+    PDGEdge(NodeId source, NodeId dest, Kind kind)
+        : m_source(source)
+        , m_dest(dest)
+        , m_kind(kind)
     {
     }
 
-    virtual ~PDGEdge() = default;
-    PDGEdge(const PDGEdge&) = delete;
-    PDGEdge(PDGEdge&&) = delete;
-    PDGEdge& operator =(const PDGEdge&) = delete;
-    PDGEdge& operator =(PDGEdge&&) = delete;
-
 public:
-    virtual const bool isDataEdge() const = 0;
-    virtual const bool isControlEdge() const = 0;
-
-    const PDGNodeTy getSource() const
-    {
-        return m_source;
-    }
-
-    PDGNodeTy getSource()
+    NodeId getSourceId() const
     {
         return m_source;
     }
 
-    const PDGNodeTy getDestination() const
+    NodeId getDestinationId() const
     {
         return m_dest;
     }
 
-    PDGNodeTy getDestination()
+    Kind getKind() const
     {
-        return m_dest;
+        return static_cast<Kind>(m_kind);
     }
 
-private:
-    PDGNodeTy m_source;
-    PDGNodeTy m_dest;
-}; // class PDGEdge
-
-class PDGDataEdge : public PDGEdge
-{
-public:
-    PDGDataEdge(PDGNodeTy sourceNode, PDGNodeTy destNode)
-        : PDGEdge(sourceNode, destNode)
+    bool isDataEdge() const
     {
+        return m_kind & DataEdges;
     }
 
-    const bool isDataEdge() const override
+    bool isControlEdge() const
     {
-        return true;
+        return m_kind & ControlEdges;
     }
 
-    const bool isControlEdge() const override
+    bool operator ==(const PDGEdge& other) const
     {
-        return false;
-    }
-public:
-    static bool classof(const PDGEdge* node)
-    {
-        return node->isDataEdge();
+        return m_source == other.m_source && m_dest == other.m_dest && m_kind == other.m_kind;
     }
 
-}; // class PDGDataEdge
-
-class PDGControlEdge : public PDGEdge
-{
-public:
-    PDGControlEdge(PDGNodeTy sourceNode, PDGNodeTy destNode)
-        : PDGEdge(sourceNode, destNode)
-    {
-    }
-
-    const bool isDataEdge() const override
-    {
-        return false;
-    }
-
-    const bool isControlEdge() const override
-    {
-        return true;
-    }
-
-public:
-    static bool classof(const PDGEdge* node)
-    {
-        return node->isControlEdge();
-    }
-
-
-}; // class PDGControlEdge
-
+private:
+    NodeId m_source;
+    NodeId m_dest;
+    EdgeKinds m_kind;
+}; // class PDGEdge
 
 } // namespace pdg
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "PDG/PDG/PDGCompactGraph.h"
 #include "PDG/PDG/PDGEdge.h"
 #include "PDG/PDG/PDGNode.h"
 #include "PDG/PDG/PDGLLVMNode.h"
@@ -14,29 +15,25 @@ using namespace pdg;
 namespace llvm {
 
 /*!
- * GraphTraits for nodes
+ * GraphTraits for nodes. Iterates over compact graph of frozen PDG
  */
 template<> struct GraphTraits<PDGNode*>
 {
     typedef PDGNode NodeType;
     typedef PDGNode* NodeRef;
-    typedef PDGNode::PDGEdgeType EdgeType;
-
-    typedef std::pointer_to_unary_function<EdgeType, NodeRef> DerefEdge;
-    typedef mapped_iterator<PDGNode::iterator, DerefEdge> ChildIteratorType;
+    typedef PDGCompactGraph::adjacency_iterator ChildIteratorType;
 
     static NodeRef getEntryNode(NodeType* pdgN) {
         return pdgN;
     }
 
     static inline ChildIteratorType child_begin(NodeType* N) {
-        return map_iterator(N->outEdgesBegin(), DerefEdge(edgeDereference));
+        assert(N->isFrozen());
+        return N->getCompactGraph()->succBegin(N->getNodeId());
     }
     static inline ChildIteratorType child_end(NodeType* N) {
-        return map_iterator(N->outEdgesEnd(), DerefEdge(edgeDereference));
-    }
-    static NodeRef edgeDereference(EdgeType edge) {
-        return edge->getDestination().get();
+        assert(N->isFrozen());
+        return N->getCompactGraph()->succEnd(N->getNodeId());
     }
 };
 
@@ -48,23 +45,19 @@ struct GraphTraits<Inverse<PDGNode*> >
 {
     typedef PDGNode NodeType;
     typedef PDGNode* NodeRef;
-    typedef PDGNode::PDGEdgeType EdgeType;
-
-    typedef std::pointer_to_unary_function<EdgeType, NodeRef> DerefEdge;
-    typedef mapped_iterator<PDGNode::iterator, DerefEdge> ChildIteratorType;
+    typedef PDGCompactGraph::adjacency_iterator ChildIteratorType;
 
     static inline NodeRef getEntryNode(Inverse<NodeType* > G) {
         return G.Graph;
     }
 
     static inline ChildIteratorType child_begin(NodeType* N) {
-        return map_iterator(N->inEdgesBegin(), DerefEdge(edgeDereference));
+        assert(N->isFrozen());
+        return N->getCompactGraph()->predBegin(N->getNodeId());
     }
     static inline ChildIteratorType child_end(NodeType* N) {
-        return map_iterator(N->inEdgesEnd(), DerefEdge(edgeDereference));
-    }
-    static NodeRef edgeDereference(EdgeType edge) {
-        return edge->getSource().get();
+        assert(N->isFrozen());
+        return N->getCompactGraph()->predEnd(N->getNodeId());
     }
 };
 
@@ -100,7 +93,6 @@ struct DOTGraphTraits<FunctionPDG*> : public DefaultDOTGraphTraits
 {
     typedef GraphTraits<FunctionPDG*>::NodeType NodeType;
     typedef GraphTraits<FunctionPDG*>::NodeRef NodeRef;
-    typedef GraphTraits<FunctionPDG*>::EdgeType EdgeType;
     typedef GraphTraits<FunctionPDG*>::ChildIteratorType ChildIteratorType;
 
     DOTGraphTraits(bool isSimple = false)
@@ -133,15 +125,20 @@ struct DOTGraphTraits<FunctionPDG*> : public DefaultDOTGraphTraits
 
     static std::string getEdgeAttributes(NodeRef node, ChildIteratorType edge_iter, FunctionPDG* graph)
     {
-        EdgeType edge = *(edge_iter.getCurrent());
-        if (llvm::isa<PDGDataEdge>(edge.get())) {
-            if (llvm::isa<pdg::PDGLLVMFormalArgumentNode>(edge->getDestination().get())) {
-                return "color=green";
-            } else {
-                return "color=black";
-            }
-        } else if (llvm::isa<PDGControlEdge>(edge.get())) {
+        switch (edge_iter.getEdgeKind()) {
+        case pdg::PDGEdge::DataEdge:
+            return "color=black";
+        case pdg::PDGEdge::ParameterInEdge:
+        case pdg::PDGEdge::ParameterOutEdge:
+            return "color=green";
+        case pdg::PDGEdge::MemoryEdge:
+            return "color=red";
+        case pdg::PDGEdge::ControlEdge:
             return "color=blue";
+        case pdg::PDGEdge::CallEdge:
+            return "color=blue,style=dashed";
+        default:
+            break;
         }
         assert(false);
         return "";
@@ -2,6 +2,7 @@
 
 #include "PDGNode.h"
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/IR/Argument.h"
 #include "llvm/IR/CallSite.h"
 #include "llvm/IR/Constants.h"
@@ -37,7 +38,7 @@ public:
     {
     }
 
-    virtual ~PDGLLVMNode() = default;
+    ~PDGLLVMNode() = default;
 
 public:
     virtual unsigned getNodeType() const override
@@ -384,6 +385,7 @@ public:
     explicit PDGLLVMBasicBlockNode(llvm::BasicBlock* block)
         : PDGLLVMNode(llvm::dyn_cast<llvm::Value>(block), NodeType::BasicBlockNode)
         , m_block(block)
+        , m_controlDependent(false)
     {
     }
 
@@ -398,6 +400,17 @@ public:
         return m_block;
     }
 
+    /// Instructions of a control dependent block are members of it, see PDGNode::getBlockNodeId
+    bool isControlDependent() const
+    {
+        return m_controlDependent;
+    }
+
+    void setControlDependent(bool controlDependent)
+    {
+        m_controlDependent = controlDependent;
+    }
+
     bool hasParent() const override
     {
         return true;
@@ -421,6 +434,7 @@ public:
 
 private:
     llvm::BasicBlock* m_block;
+    bool m_controlDependent;
 }; // class PDGLLVMBasicBlockNode
 
 class PDGNullNode : public PDGLLVMNode
@@ -465,17 +479,19 @@ public:
 }; // class PDGNullNode
 
 
+/// Incoming values and blocks are kept in arrays owned by the arena of the node
 class PDGPhiNode : public PDGLLVMNode
 {
 public:
-    using Values = std::vector<llvm::Value*>;
-    using Blocks = std::vector<llvm::BasicBlock*>;
+    using Values = llvm::ArrayRef<llvm::Value*>;
+    using Blocks = llvm::ArrayRef<llvm::BasicBlock*>;
 
 public:
-    PDGPhiNode(const Values& values, const Blocks& blocks)
+    PDGPhiNode(llvm::Value** values, llvm::BasicBlock** blocks, unsigned size)
         : PDGLLVMNode(nullptr, NodeType::PhiNode)
         , m_values(values)
         , m_blocks(blocks)
+        , m_size(size)
     {
     }
 
@@ -484,18 +500,18 @@ public:
 
     bool hasParent() const override
     {
-        return !m_blocks.empty();
+        return m_size != 0;
     }
 
     llvm::Function* getParent() const override
     {
-        return m_blocks.empty() ? nullptr : m_blocks.front()->getParent();
+        return m_size == 0 ? nullptr : m_blocks[0]->getParent();
     }
 
 public:
     unsigned getNumValues() const
     {
-        return m_values.size();
+        return m_size;
     }
 
     llvm::Value* getValue(unsigned i) const
@@ -508,6 +524,16 @@ public:
         return m_blocks[i];
     }
 
+    Values getValues() const
+    {
+        return Values(m_values, m_size);
+    }
+
+    Blocks getBlocks() const
+    {
+        return Blocks(m_blocks, m_size);
+    }
+
 public:
     static bool classof(const PDGLLVMNode* node)
     {
@@ -520,8 +546,9 @@ public:
     }
 
 private:
-    Values m_values;
-    Blocks m_blocks;
+    llvm::Value** m_values;
+    llvm::BasicBlock** m_blocks;
+    unsigned m_size;
 }; // class PDGPhiNode
 
 } // namespace pdg
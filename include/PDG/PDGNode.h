@@ -1,7 +1,13 @@
 #pragma once
 
-#include <memory>
-#include <unordered_set>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "PDGArena.h"
+#include "PDGEdge.h"
 
 namespace llvm {
 
@@ -11,19 +17,121 @@ class Function;
 
 namespace pdg {
 
-class PDGEdge;
+class PDGCompactGraph;
+
+/// Edges of a node kept in arena blocks of the node's owner.
+/// Trivially destructible: memory goes back to the arena when edges are released,
+/// or together with the arena
+class PDGEdgeList
+{
+public:
+    using iterator = PDGEdge*;
+    using const_iterator = const PDGEdge*;
+
+public:
+    iterator begin()
+    {
+        return m_edges;
+    }
+
+    iterator end()
+    {
+        return m_edges + m_size;
+    }
+
+    const_iterator begin() const
+    {
+        return m_edges;
+    }
+
+    const_iterator end() const
+    {
+        return m_edges + m_size;
+    }
+
+    unsigned size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    void push_back(const PDGEdge& edge, PDGArena& arena)
+    {
+        if (m_size == m_capacity) {
+            std::size_t blockSize = sizeof(PDGEdge) * (m_capacity == 0 ? InitialCapacity : 2 * m_capacity);
+            auto* edges = static_cast<PDGEdge*>(arena.allocateBlock(blockSize));
+            if (m_edges) {
+                std::memcpy(edges, m_edges, sizeof(PDGEdge) * m_size);
+                arena.deallocateBlock(m_edges, getBlockSize());
+            }
+            m_edges = edges;
+            m_capacity = blockSize / sizeof(PDGEdge);
+        }
+        new (m_edges + m_size) PDGEdge(edge);
+        ++m_size;
+    }
+
+    bool remove(const PDGEdge& edge)
+    {
+        auto pos = std::find(begin(), end(), edge);
+        if (pos == end()) {
+            return false;
+        }
+        std::copy(pos + 1, end(), pos);
+        --m_size;
+        return true;
+    }
+
+    void release(PDGArena& arena)
+    {
+        if (m_edges) {
+            arena.deallocateBlock(m_edges, getBlockSize());
+        }
+        m_edges = nullptr;
+        m_size = 0;
+        m_capacity = 0;
+    }
+
+private:
+    static const uint32_t InitialCapacity = 4;
+
+    std::size_t getBlockSize() const
+    {
+        // capacity was derived from a power of two block size
+        std::size_t blockSize = 1;
+        while (blockSize < sizeof(PDGEdge) * m_capacity) {
+            blockSize <<= 1;
+        }
+        return blockSize;
+    }
+
+private:
+    PDGEdge* m_edges = nullptr;
+    uint32_t m_size = 0;
+    uint32_t m_capacity = 0;
+}; // class PDGEdgeList
 
+/// Base of PDG nodes. Nodes live in arenas and are never destroyed one by one,
+/// node types should stay trivially destructible
 class PDGNode
 {
 public:
-    using PDGEdgeType = std::shared_ptr<PDGEdge>;
-    using PDGEdges = std::unordered_set<PDGEdgeType>;
+    using NodeId = PDGEdge::NodeId;
+    using PDGEdgeType = PDGEdge;
+    /// Edges are deduplicated by PDG before being added to nodes
+    using PDGEdges = PDGEdgeList;
     using iterator = PDGEdges::iterator;
     using const_iterator = PDGEdges::const_iterator;
 
+    static const NodeId InvalidNodeId = ~0u;
+
 public:
     PDGNode() = default;
-    virtual ~PDGNode() = default;
+    ~PDGNode() = default;
     PDGNode(const PDGNode&) = delete;
     PDGNode(PDGNode&&) = delete;
     PDGNode& operator =(const PDGNode&) = delete;
@@ -49,22 +157,38 @@ public:
 
     virtual bool addInEdge(PDGEdgeType inEdge)
     {
-        return m_inEdges.insert(inEdge).second;
+        assert(m_edgeArena);
+        m_inEdges.push_back(inEdge, *m_edgeArena);
+        return true;
     }
 
     virtual bool addOutEdge(PDGEdgeType outEdge)
     {
-        return m_outEdges.insert(outEdge).second;
+        assert(m_edgeArena);
+        m_outEdges.push_back(outEdge, *m_edgeArena);
+        return true;
     }
 
     virtual bool removeInEdge(PDGEdgeType inEdge)
     {
-        m_inEdges.erase(inEdge);
+        return m_inEdges.remove(inEdge);
     }
 
     virtual bool removeOutEdge(PDGEdgeType outEdge)
     {
-        m_outEdges.erase(outEdge);
+        return m_outEdges.remove(outEdge);
+    }
+
+    /// Arena edges of the node are allocated from, set by the graph part owning the node
+    bool hasEdgeArena() const
+    {
+        return m_edgeArena != nullptr;
+    }
+
+    void setEdgeArena(PDGArena* arena)
+    {
+        assert(m_inEdges.empty() && m_outEdges.empty());
+        m_edgeArena = arena;
     }
 
 public:
@@ -108,9 +232,82 @@ public:
         return m_outEdges.end();
     }
 
+public:
+    /// Dense module-wide id, assigned when the node is added to PDG
+    NodeId getNodeId() const
+    {
+        return m_nodeId;
+    }
+
+    void setNodeId(NodeId id)
+    {
+        m_nodeId = id;
+    }
+
+    /// Frozen nodes keep their edges in compact graph, see PDG::freeze.
+    /// Edges added to a frozen node stay here until the graph is compacted again
+    bool isFrozen() const
+    {
+        return m_compactGraph != nullptr;
+    }
+
+    PDGCompactGraph* getCompactGraph() const
+    {
+        return m_compactGraph;
+    }
+
+    void setCompactGraph(PDGCompactGraph* graph)
+    {
+        m_compactGraph = graph;
+    }
+
+    /// Block node this node is control dependent through, InvalidNodeId if there is none.
+    /// The control edge from the block to its member is implicit: it is not kept in edge sets
+    /// nor in compact graph, traversals synthesize it
+    NodeId getBlockNodeId() const
+    {
+        return m_blockNodeId;
+    }
+
+    bool hasBlockNode() const
+    {
+        return m_blockNodeId != InvalidNodeId;
+    }
+
+    void setBlockNodeId(NodeId id)
+    {
+        m_blockNodeId = id;
+    }
+
+    /// Rewrites ids of edge ends, used when provisional node ids are replaced by final ones
+    template <typename IdMapping>
+    void remapEdges(const IdMapping& mapping)
+    {
+        for (auto* edges : {&m_inEdges, &m_outEdges}) {
+            for (auto& edge : *edges) {
+                edge = PDGEdge(mapping(edge.getSourceId()), mapping(edge.getDestinationId()), edge.getKind());
+            }
+        }
+        if (hasBlockNode()) {
+            m_blockNodeId = mapping(m_blockNodeId);
+        }
+    }
+
+    void releaseEdges()
+    {
+        if (m_edgeArena) {
+            m_inEdges.release(*m_edgeArena);
+            m_outEdges.release(*m_edgeArena);
+        }
+    }
+
 private:
     PDGEdges m_inEdges;
     PDGEdges m_outEdges;
+    PDGArena* m_edgeArena = nullptr;
+    PDGCompactGraph* m_compactGraph = nullptr;
+    NodeId m_nodeId = InvalidNodeId;
+    NodeId m_blockNodeId = InvalidNodeId;
 }; // class PDGNode
 
 } // namespace pdg
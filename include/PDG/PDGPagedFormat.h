@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace pdg {
+
+/// On-disk layout of a PDG split into pages, one per function, plus a module page holding nodes
+/// which do not belong to any written function (globals, function nodes, interfaces of declarations).
+/// Pages are loaded one at a time by PDGPagedGraph, the index sections are used in place.
+/// Values are in byte order of the writer (checked with byteOrderMark), sections and pages
+/// are placed at 8 byte aligned offsets.
+///
+/// Index sections:
+///   NodePages        uint32_t[nodesNum]          page of node with given id, InvalidIndex for unused ids
+///   PageOffsets      uint64_t[pagesNum]
+///   PageSizes        uint32_t[pagesNum]          bytes
+///   PageNames        uint32_t[pagesNum]          Strings offset of function name, empty for module page
+///   CrossOutOffsets  uint32_t[nodesNum + 1]      edges between nodes of different pages, by source
+///   CrossOutTargets  uint32_t[crossEdgesNum]
+///   CrossOutKinds    uint8_t[crossEdgesNum]      PDGEdge::Kind of edge
+///   CrossInOffsets   uint32_t[nodesNum + 1]      same edges, by destination
+///   CrossInSources   uint32_t[crossEdgesNum]
+///   CrossInKinds     uint8_t[crossEdgesNum]
+///   Strings          char[stringsSize]           NUL terminated strings
+///
+/// Page, edges between nodes of the page only:
+///   PDGPageHeader
+///   NodeIds          uint32_t[nodesNum]          ascending
+///   NodeKinds        uint32_t[nodesNum]          PDGLLVMNode::NodeType of node
+///   NodeLabels       uint32_t[nodesNum]          Labels offset of node label
+///   OutOffsets       uint32_t[nodesNum + 1]      by position of node in the page
+///   OutTargets       uint32_t[edgesNum]          node ids
+///   OutKinds         uint8_t[edgesNum]
+///   Labels           char[labelsSize]            NUL terminated strings
+///
+/// Version must be increased whenever layout, node types or edge kind values change.
+struct PDGPagedHeader
+{
+    static const uint32_t CurrentVersion = 1;
+    static const uint32_t ByteOrderMark = 0x01020304;
+    static const uint32_t InvalidIndex = ~0u;
+    static const unsigned MagicSize = 8;
+
+    enum Section : uint32_t {
+        NodePages = 0,
+        PageOffsets,
+        PageSizes,
+        PageNames,
+        CrossOutOffsets,
+        CrossOutTargets,
+        CrossOutKinds,
+        CrossInOffsets,
+        CrossInSources,
+        CrossInKinds,
+        Strings,
+        SectionsNum
+    };
+
+    static const char* getMagic()
+    {
+        return "PDGPAGE";
+    }
+
+    bool hasValidMagic() const
+    {
+        return std::memcmp(magic, getMagic(), MagicSize) == 0;
+    }
+
+    char magic[MagicSize];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    uint32_t nodesNum;
+    uint32_t pagesNum;
+    uint32_t modulePage;
+    uint32_t crossEdgesNum;
+    uint32_t stringsSize;
+    uint32_t reserved;
+    uint64_t sectionOffsets[SectionsNum];
+    uint64_t fileSize;
+}; // struct PDGPagedHeader
+
+struct PDGPageHeader
+{
+    uint32_t nodesNum;
+    uint32_t edgesNum;
+    uint32_t labelsSize;
+    uint32_t reserved;
+}; // struct PDGPageHeader
+
+static_assert(sizeof(PDGPagedHeader) % 8 == 0, "sections following the header must stay aligned");
+static_assert(sizeof(PDGPageHeader) % 8 == 0, "page arrays must stay aligned");
+
+} // namespace pdg
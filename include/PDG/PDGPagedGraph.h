@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PDGEdge.h"
+#include "PDGPagedFormat.h"
+
+namespace pdg {
+
+/// Read only PDG loaded from a file written by PDGPagedWriter, for graphs larger than memory.
+/// Index of the file is mapped and used in place. Function pages are decoded when one of their
+/// nodes is accessed and are kept in LRU order until the memory budget is exceeded.
+/// Queries crossing function boundaries load the needed pages transparently.
+/// Only the header and section bounds are validated on open, contents are trusted.
+class PDGPagedGraph
+{
+public:
+    using NodeId = PDGEdge::NodeId;
+    using EdgeKinds = PDGEdge::EdgeKinds;
+    using NodeIds = std::vector<NodeId>;
+
+    static const uint32_t InvalidIndex = PDGPagedHeader::InvalidIndex;
+
+    /// Page cache counters
+    struct Statistics
+    {
+        uint64_t hitsNum = 0;
+        uint64_t missesNum = 0;
+        uint64_t evictionsNum = 0;
+        std::size_t residentSize = 0;
+        std::size_t peakResidentSize = 0;
+
+        double getHitRate() const
+        {
+            const uint64_t accessesNum = hitsNum + missesNum;
+            return accessesNum == 0 ? 0 : double(hitsNum) / accessesNum;
+        }
+    };
+
+public:
+    PDGPagedGraph();
+    ~PDGPagedGraph();
+    PDGPagedGraph(const PDGPagedGraph& ) = delete;
+    PDGPagedGraph(PDGPagedGraph&& ) = delete;
+    PDGPagedGraph& operator =(const PDGPagedGraph& ) = delete;
+    PDGPagedGraph& operator =(PDGPagedGraph&& ) = delete;
+
+public:
+    /// Maps the file. Returns false and sets error message on failure
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const
+    {
+        return m_header != nullptr;
+    }
+
+    const std::string& getError() const
+    {
+        return m_error;
+    }
+
+    /// Bytes of decoded pages kept in memory. The most recently used page always stays
+    void setMemoryBudget(std::size_t budget);
+
+    std::size_t getMemoryBudget() const
+    {
+        return m_memoryBudget;
+    }
+
+    const Statistics& getStatistics() const
+    {
+        return m_statistics;
+    }
+
+public:
+    /// Upper bound of node ids. Not every id below it has a node, see hasNode
+    NodeId size() const
+    {
+        return m_header->nodesNum;
+    }
+
+    bool hasNode(NodeId id) const
+    {
+        return id < size() && m_nodePages[id] != InvalidIndex;
+    }
+
+    /// Index of the function node belongs to, InvalidIndex for module level nodes
+    uint32_t getNodeFunction(NodeId id) const
+    {
+        assert(hasNode(id));
+        const uint32_t page = m_nodePages[id];
+        return page == m_header->modulePage ? InvalidIndex : page;
+    }
+
+    /// PDGLLVMNode::NodeType of the node
+    unsigned getNodeKind(NodeId id);
+    std::string getNodeLabel(NodeId id);
+
+    /// Number of function pages, functions are indexed by pages
+    uint32_t functionsSize() const
+    {
+        return m_header->pagesNum - 1;
+    }
+
+    const char* getFunctionName(uint32_t index) const
+    {
+        return m_strings + m_pageNames[index];
+    }
+
+    /// Index of the function with given name, InvalidIndex if there is no such function
+    uint32_t findFunction(const std::string& name) const;
+    /// Ids of nodes of the function, loads its page
+    NodeIds getFunctionNodes(uint32_t index);
+
+    /// Adjacent nodes, optionally restricted to edges of given kinds
+    NodeIds getSuccessors(NodeId id, EdgeKinds kinds = PDGEdge::AnyEdge);
+    NodeIds getPredecessors(NodeId id, EdgeKinds kinds = PDGEdge::AnyEdge);
+
+public:
+    /// Same semantics as PDGCompactGraph slices
+    NodeIds forwardSlice(NodeId from, EdgeKinds kinds = PDGEdge::AnyEdge);
+    NodeIds backwardSlice(NodeId from, EdgeKinds kinds = PDGEdge::AnyEdge);
+
+private:
+    /// Decoded page, adjacency is indexed by position of node in the page
+    struct Page
+    {
+        NodeIds nodes;
+        std::vector<uint32_t> kinds;
+        std::vector<uint32_t> labels;
+        std::vector<uint32_t> outOffsets;
+        NodeIds outTargets;
+        std::vector<EdgeKinds> outKinds;
+        std::vector<uint32_t> inOffsets;
+        NodeIds inSources;
+        std::vector<EdgeKinds> inKinds;
+        std::string labelsData;
+        std::list<uint32_t>::iterator lruPosition;
+        std::size_t memorySize = 0;
+
+        uint32_t getPosition(NodeId id) const;
+    };
+
+    bool fail(const std::string& error);
+    bool mapSections();
+
+    template <typename T>
+    bool getSection(PDGPagedHeader::Section section, uint64_t size, const T*& data);
+
+    const Page& getNodePage(NodeId id);
+    /// Returns decoded page, loading it and evicting least recently used pages if needed
+    const Page& getPage(uint32_t index);
+    std::unique_ptr<Page> loadPage(uint32_t page) const;
+    void evictPages();
+
+    NodeIds getAdjacent(NodeId id, EdgeKinds kinds, bool forward);
+    NodeIds slice(NodeId from, EdgeKinds kinds, bool forward);
+
+private:
+    std::string m_error;
+    void* m_mapping;
+    uint64_t m_mappingSize;
+    const PDGPagedHeader* m_header;
+    const uint32_t* m_nodePages;
+    const uint64_t* m_pageOffsets;
+    const uint32_t* m_pageSizes;
+    const uint32_t* m_pageNames;
+    const uint32_t* m_crossOutOffsets;
+    const NodeId* m_crossOutTargets;
+    const EdgeKinds* m_crossOutKinds;
+    const uint32_t* m_crossInOffsets;
+    const NodeId* m_crossInSources;
+    const EdgeKinds* m_crossInKinds;
+    const char* m_strings;
+
+    std::size_t m_memoryBudget;
+    std::vector<std::unique_ptr<Page>> m_pages;
+    // most recently used first
+    std::list<uint32_t> m_lru;
+    Statistics m_statistics;
+}; // class PDGPagedGraph
+
+} // namespace pdg
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PDGEdge.h"
+
+namespace llvm {
+
+class raw_fd_ostream;
+} // namespace llvm
+
+namespace pdg {
+
+class PDG;
+class PDGNode;
+class FunctionPDG;
+
+/// Writes PDG in the format described in PDGPagedFormat.h while it is being built.
+/// Meant to be the sink of PDGBuilder::buildStreaming: every function is written as a page
+/// as soon as it is finished, only edges crossing pages are kept until the index is written.
+class PDGPagedWriter
+{
+public:
+    explicit PDGPagedWriter(const std::string& path);
+    ~PDGPagedWriter();
+
+    PDGPagedWriter(const PDGPagedWriter& ) = delete;
+    PDGPagedWriter(PDGPagedWriter&& ) = delete;
+    PDGPagedWriter& operator =(const PDGPagedWriter& ) = delete;
+    PDGPagedWriter& operator =(PDGPagedWriter&& ) = delete;
+
+public:
+    /// False if the file can not be written
+    bool isOpen() const;
+
+    /// Writes page of a finished function
+    void addFunction(FunctionPDG& functionPDG);
+    /// Writes nodes of the graph not written with any function to module page, then writes the index.
+    /// Returns false if the file can not be written
+    bool finish(const PDG& pdg);
+
+    unsigned getPagesNum() const
+    {
+        return m_pageOffsets.size();
+    }
+
+private:
+    using Nodes = std::vector<PDGNode*>;
+
+    /// Writes nodes as a page and records edges leaving it
+    void writePage(const std::string& name, Nodes& nodes);
+    void writePadding();
+    void setNodePage(PDGEdge::NodeId id, uint32_t page);
+    uint32_t getNodePage(PDGEdge::NodeId id) const;
+    uint32_t addString(const std::string& str);
+
+private:
+    std::unique_ptr<llvm::raw_fd_ostream> m_os;
+    uint64_t m_offset;
+    std::vector<uint32_t> m_nodePages;
+    std::vector<uint64_t> m_pageOffsets;
+    std::vector<uint32_t> m_pageSizes;
+    std::vector<uint32_t> m_pageNames;
+    std::vector<PDGEdge> m_crossEdges;
+    std::vector<char> m_strings;
+}; // class PDGPagedWriter
+
+} // namespace pdg
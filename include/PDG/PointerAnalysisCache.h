@@ -0,0 +1,65 @@
+#pragma once
+
+#include "PDG/PDG/IndirectCallSiteResults.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace llvm {
+class Instruction;
+class Module;
+class Value;
+} // namespace llvm
+
+namespace pdg {
+
+/// Persistent copy of pointer analysis results for a module.
+/// Keeps resolved indirect call targets only, which is all the builder takes from pointer analysis
+/// when memory def-use comes from MemorySSA. SVFG can not be rebuilt without Andersen analysis,
+/// so points-to sets are not stored. Values are stored by their position in module order (globals, functions, then
+/// arguments and instructions of each function), the file is tied to a content hash of
+/// the module, so it is valid only for the exact module it was produced for.
+class PointerAnalysisCache : public IndirectCallSiteResults
+{
+public:
+    using FunctionSet = IndirectCallSiteResults::FunctionSet;
+
+public:
+    explicit PointerAnalysisCache(llvm::Module* M);
+
+    PointerAnalysisCache(const PointerAnalysisCache& ) = delete;
+    PointerAnalysisCache(PointerAnalysisCache&& ) = delete;
+    PointerAnalysisCache& operator =(const PointerAnalysisCache& ) = delete;
+    PointerAnalysisCache& operator =(PointerAnalysisCache&& ) = delete;
+
+public:
+    /// Hex MD5 digest of textual module representation
+    static std::string getModuleHash(const llvm::Module& M);
+
+    /// Returns false if file is missing, corrupted or was produced for other module
+    bool load(const std::string& path, const std::string& moduleHash);
+    bool save(const std::string& path, const std::string& moduleHash) const;
+
+public:
+    void addIndCSCallees(llvm::Instruction* callInst, const FunctionSet& callees);
+
+    virtual bool hasIndCSCallees(const llvm::CallSite& callSite) const override;
+    virtual FunctionSet getIndCSCallees(const llvm::CallSite& callSite) override;
+
+private:
+    void numberValues();
+    void addValue(llvm::Value* value);
+
+private:
+    static const uint32_t FormatVersion = 2;
+
+    llvm::Module* m_module;
+    std::vector<llvm::Value*> m_values;
+    std::unordered_map<llvm::Value*, uint32_t> m_valueIds;
+    std::unordered_map<llvm::Instruction*, FunctionSet> m_indCSCallees;
+}; // class PointerAnalysisCache
+
+} // namespace pdg
+
@@ -2,6 +2,7 @@
 
 #include "PDG/PDG/DefUseResults.h"
 
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -12,8 +13,13 @@ namespace pdg {
 
 class SVFGDefUseAnalysisResults : public DefUseResults
 {
+public:
+    using SVFGTy = std::shared_ptr<SVFG>;
+
 public:
     explicit SVFGDefUseAnalysisResults(SVFG* svfg);
+    /// Shares ownership of the graph, for results outliving its owner, e.g. in lazy builds
+    explicit SVFGDefUseAnalysisResults(SVFGTy svfg);
     
     SVFGDefUseAnalysisResults(const SVFGDefUseAnalysisResults& ) = delete;
     SVFGDefUseAnalysisResults(SVFGDefUseAnalysisResults&& ) = delete;
@@ -27,9 +33,10 @@ private:
     SVFGNode* getSVFGNode(llvm::Value* value);
     std::unordered_set<SVFGNode*> getSVFGDefNodes(SVFGNode* svfgNode, std::unordered_set<SVFGNode*>& processedNodes);
     DefSite getPdgDefNode(const std::unordered_set<SVFGNode*>& svfgDefNodes);
-    PDGNodeTy getNode(SVFGNode* svfgNode);
+    llvm::Value* getDefValue(SVFGNode* svfgNode);
 
 private:
+    SVFGTy m_svfgOwner;
     SVFG* m_svfg;
     std::unordered_map<llvm::Value*, DefSite> m_valueDefSite;
 }; // class SVFGDefUseAnalysisResults
@@ -2,6 +2,8 @@
 
 #include "PDG/PDG/IndirectCallSiteResults.h"
 
+#include <memory>
+
 class PTACallGraph;
 
 namespace pdg {
@@ -10,14 +12,18 @@ class SVFGIndirectCallSiteResults : public IndirectCallSiteResults
 {
 public:
     using FunctionSet = IndirectCallSiteResults::FunctionSet;
+    using PTACallGraphTy = std::shared_ptr<PTACallGraph>;
 
 public:
     explicit SVFGIndirectCallSiteResults(PTACallGraph* ptaGraph);
+    /// Shares ownership of the call graph, for results outliving its owner, e.g. in lazy builds
+    explicit SVFGIndirectCallSiteResults(PTACallGraphTy ptaGraph);
 
     virtual bool hasIndCSCallees(const llvm::CallSite& callSite) const override;
     virtual FunctionSet getIndCSCallees(const llvm::CallSite& callSite) override;
 
 private:
+    PTACallGraphTy m_ptaGraphOwner;
     PTACallGraph* m_ptaGraph;
 }; // class SVFGIndirectCallSiteResults
 
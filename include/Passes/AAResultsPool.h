@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+
+namespace llvm {
+class AAResults;
+class BasicAAResult;
+class Function;
+class Pass;
+} // namespace llvm
+
+namespace pdg {
+
+/// Alias analysis results of legacy pass manager, one per function.
+/// Results are created on first request and owned by the pool until released or the pool is
+/// destroyed. The pass they are created for has to require getAAResultsAnalysisUsage analyses
+/// and outlive the pool. Not thread safe, def sites are requested in single threaded stage.
+class AAResultsPool
+{
+public:
+    explicit AAResultsPool(llvm::Pass& pass);
+    ~AAResultsPool();
+
+    AAResultsPool(const AAResultsPool& ) = delete;
+    AAResultsPool(AAResultsPool&& ) = delete;
+    AAResultsPool& operator =(const AAResultsPool& ) = delete;
+    AAResultsPool& operator =(AAResultsPool&& ) = delete;
+
+public:
+    llvm::AAResults* getAAResults(llvm::Function* F);
+    /// Frees results of the function, next request creates them again
+    void release(llvm::Function* F);
+
+    std::size_t size() const
+    {
+        return m_results.size();
+    }
+
+private:
+    struct Results;
+
+private:
+    llvm::Pass& m_pass;
+    std::unordered_map<llvm::Function*, std::unique_ptr<Results>> m_results;
+}; // class AAResultsPool
+
+} // namespace pdg
+
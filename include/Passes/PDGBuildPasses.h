@@ -7,6 +7,7 @@
 namespace pdg {
 
 class PDG;
+class FunctionAnalyses;
 
 /// LLVM pass to build PDG from SVFG
 class SVFGPDGBuilder : public llvm::ModulePass
@@ -16,13 +17,12 @@ public:
 
 public:
     static char ID;
-    SVFGPDGBuilder()
-        : llvm::ModulePass(ID)
-    {
-    }
+    SVFGPDGBuilder();
+    ~SVFGPDGBuilder();
 
     void getAnalysisUsage(llvm::AnalysisUsage& AU) const override;
     bool runOnModule(llvm::Module& M) override;
+    void releaseMemory() override;
 
     PDGType getPDG()
     {
@@ -31,6 +31,8 @@ public:
 
 private:
     PDGType m_pdg;
+    // analyses of lazily built functions, shared with the PDG building them
+    std::shared_ptr<FunctionAnalyses> m_analyses;
 };
 
 /// LLVM pass to build PDG from DG
@@ -41,13 +43,12 @@ public:
 
 public:
     static char ID;
-    LLVMPDGBuilder()
-        : llvm::ModulePass(ID)
-    {
-    }
+    LLVMPDGBuilder();
+    ~LLVMPDGBuilder();
 
     void getAnalysisUsage(llvm::AnalysisUsage& AU) const override;
     bool runOnModule(llvm::Module& M) override;
+    void releaseMemory() override;
 
     PDGType getPDG()
     {
@@ -56,7 +57,8 @@ public:
 
 private:
     PDGType m_pdg;
-
+    // analyses of lazily built functions, shared with the PDG building them
+    std::shared_ptr<FunctionAnalyses> m_analyses;
 };
 
 }
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "llvm/Pass.h"
+
+#include <memory>
+#include <string>
+
+class AndersenWaveDiff;
+class PTACallGraph;
+class SVFG;
+class SVFGBuilder;
+class SVFModule;
+
+namespace pdg {
+
+class IndirectCallSiteResults;
+class PointerAnalysisCache;
+
+/// Module analysis owning whole program pointer analysis results shared by PDG passes.
+/// Andersen analysis is run in runOnModule, before dependent passes run other analyses on the module.
+/// SVFG is built on first request. Users outliving the pass, e.g. lazily built PDGs, share ownership
+/// of the results through getSharedSVFG and getIndirectCallSiteResults.
+/// With -pdg-pta-cache=<dir> indirect call targets are stored in the directory keyed by module hash.
+/// A cache hit skips Andersen analysis only for users needing nothing but indirect call targets,
+/// i.e. llvm-pdg. Andersen result, its call graph and SVFG are computed on request,
+/// so svfg-pdg runs the analysis on a hit as well.
+class SVFPointerAnalysisPass : public llvm::ModulePass
+{
+public:
+    static char ID;
+    SVFPointerAnalysisPass();
+    ~SVFPointerAnalysisPass();
+
+    void getAnalysisUsage(llvm::AnalysisUsage& AU) const override;
+    bool runOnModule(llvm::Module& M) override;
+    void releaseMemory() override;
+    void print(llvm::raw_ostream& OS, const llvm::Module* M) const override;
+
+public:
+    using IndCSResultsTy = std::shared_ptr<IndirectCallSiteResults>;
+    using PointerAnalysisCacheTy = std::shared_ptr<PointerAnalysisCache>;
+    using SVFGTy = std::shared_ptr<SVFG>;
+
+    AndersenWaveDiff* getAndersen();
+    PTACallGraph* getPTACallGraph();
+    SVFG* getSVFG();
+    /// SVFG keeping all analysis results alive while it is referred to, after releaseMemory included
+    SVFGTy getSharedSVFG();
+
+    /// Indirect call targets, served from the cache on a hit.
+    /// Keep analysis results they come from alive, as getSharedSVFG does
+    IndCSResultsTy getIndirectCallSiteResults();
+
+    unsigned getCacheHitsNum() const
+    {
+        return m_cacheHitsNum;
+    }
+
+    unsigned getCacheMissesNum() const
+    {
+        return m_cacheMissesNum;
+    }
+
+private:
+    /// Analysis results, destroyed in reverse order of construction
+    struct Results;
+
+    void runAnalysis();
+    void storeCache();
+
+private:
+    llvm::Module* m_module;
+    std::shared_ptr<Results> m_results;
+    PointerAnalysisCacheTy m_cache;
+    std::string m_cachePath;
+    std::string m_moduleHash;
+    bool m_cacheHit;
+    unsigned m_cacheHitsNum;
+    unsigned m_cacheMissesNum;
+}; // class SVFPointerAnalysisPass
+
+} // namespace pdg
+
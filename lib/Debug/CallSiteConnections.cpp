@@ -15,22 +15,19 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 
+#include "Passes/AAResultsPool.h"
+#include "Passes/SVFPointerAnalysisPass.h"
 #include "PDG/PDG/PDG.h"
 #include "PDG/PDG/FunctionPDG.h"
 #include "PDG/SVFGDefUseAnalysisResults.h"
 #include "PDG/LLVMMemorySSADefUseAnalysisResults.h"
 //#include "PDG/DGDefUseAnalysisResults.h"
-#include "PDG/LLVMDominanceTree.h"
+#include "PDG/LLVMDominanceIntervals.h"
 #include "PDG/PDGBuilder.h"
 #include "PDG/PDGGraphTraits.h"
-#include "PDG/SVFGIndirectCallSiteResults.h"
 
 #include "SVF/MSSA/SVFG.h"
-#include "SVF/MSSA/SVFGBuilder.h"
-#include "SVF/Util/SVFModule.h"
-#include "SVF/MemoryModel/PointerAnalysis.h"
 #include "SVF/WPA/Andersen.h"
-#include "SVF/PDG/PDGPointerAnalysis.h"
 
 #include <fstream>
 #include <memory>
@@ -53,6 +50,7 @@ public:
         AU.addRequiredTransitive<llvm::MemorySSAWrapperPass>();
         AU.addRequired<llvm::PostDominatorTreeWrapperPass>();
         AU.addRequired<llvm::DominatorTreeWrapperPass>();
+        AU.addRequired<pdg::SVFPointerAnalysisPass>();
         AU.setPreservesAll();
     }
 
@@ -61,19 +59,14 @@ public:
         auto memSSAGetter = [this] (llvm::Function* F) -> llvm::MemorySSA* {
             return &this->getAnalysis<llvm::MemorySSAWrapperPass>(*F).getMSSA();
         };
-        llvm::Optional<llvm::BasicAAResult> BAR;
-        llvm::Optional<llvm::AAResults> AAR;
-        auto AARGetter = [&](llvm::Function* F) -> llvm::AAResults* {
-            BAR.emplace(llvm::createLegacyPMBasicAAResult(*this, *F));
-            AAR.emplace(llvm::createLegacyPMAAResults(*this, *F, *BAR));
-            return &*AAR;
+        // one alias analysis result per function, freed once memory uses of the function are connected
+        pdg::AAResultsPool aaResultsPool(*this);
+        auto aliasAnalysisResGetter = [&aaResultsPool] (llvm::Function* F) {
+            return aaResultsPool.getAAResults(F);
+        };
+        auto aliasAnalysisResReleaser = [&aaResultsPool] (llvm::Function* F) {
+            aaResultsPool.release(F);
         };
-        std::unordered_map<llvm::Function*, llvm::AAResults*> functionAAResults;
-        for (auto& F : M) {
-            if (!F.isDeclaration()) {
-                functionAAResults.insert(std::make_pair(&F, AARGetter(&F)));
-            }
-        }
         auto domTreeGetter = [&] (llvm::Function* F) {
             return &this->getAnalysis<llvm::DominatorTreeWrapperPass>(*F).getDomTree();
         };
@@ -81,18 +74,7 @@ public:
             return &this->getAnalysis<llvm::PostDominatorTreeWrapperPass>(*F).getPostDomTree();
         };
 
-        // Passing AARGetter to LLVMMemorySSADefUseAnalysisResults causes segmentation fault when requesting AAR
-        // use following functional as a workaround before the problem with AARGetter is found
-        auto aliasAnalysisResGetter = [&functionAAResults] (llvm::Function* F) {
-            return functionAAResults[F];
-        };
-
-        SVFModule svfM(M);
-        AndersenWaveDiff* ander = new svfg::PDGAndersenWaveDiff();
-        ander->disablePrintStat();
-        ander->analyze(svfM);
-        SVFGBuilder memSSA(true);
-        SVFG *svfg = memSSA.buildSVFG((BVDataPTAImpl*)ander);
+        auto& pta = getAnalysis<pdg::SVFPointerAnalysisPass>();
 
         using DefUseResultsTy = PDGBuilder::DefUseResultsTy;
         using IndCSResultsTy = PDGBuilder::IndCSResultsTy;
@@ -100,14 +82,16 @@ public:
         DefUseResultsTy defUse;
         if (def_use == "llvm") {
             llvm::dbgs() << "Using llvm for def-use information\n";
-            defUse = DefUseResultsTy(new LLVMMemorySSADefUseAnalysisResults(memSSAGetter, aliasAnalysisResGetter));
+            auto memorySSADefUse = std::make_shared<LLVMMemorySSADefUseAnalysisResults>(memSSAGetter,
+                                                                                        aliasAnalysisResGetter);
+            memorySSADefUse->setAAResultsReleaser(aliasAnalysisResReleaser);
+            defUse = memorySSADefUse;
         } else {
             llvm::dbgs() << "Using (default) svfg for def-use information\n";
-            defUse = DefUseResultsTy(new SVFGDefUseAnalysisResults(svfg));
+            defUse = DefUseResultsTy(new SVFGDefUseAnalysisResults(pta.getSVFG()));
         }
-        IndCSResultsTy indCSRes = IndCSResultsTy(new
-                pdg::SVFGIndirectCallSiteResults(ander->getPTACallGraph()));
-        DominanceResultsTy domResults = DominanceResultsTy(new LLVMDominanceTree(domTreeGetter,
+        IndCSResultsTy indCSRes = pta.getIndirectCallSiteResults();
+        DominanceResultsTy domResults = DominanceResultsTy(new LLVMDominanceIntervals(domTreeGetter,
                     postdomTreeGetter));
 
         pdg::PDGBuilder pdgBuilder(&M);
@@ -117,6 +101,7 @@ public:
         pdgBuilder.build();
 
         auto pdg = pdgBuilder.getPDG();
+        pdg->freeze();
 
         dumpCallSitesConnections(M, pdg);
     }
@@ -154,11 +139,13 @@ private:
             llvm::dbgs() << "   Arg: " << *arg << "\n";
             assert(F_pdg->hasFormalArgNode(arg));
             auto arg_node = F_pdg->getFormalArgNode(arg);
-            for (auto edge_it = arg_node->inEdgesBegin();
-                    edge_it != arg_node->inEdgesEnd();
-                    ++edge_it) {
-                auto src = (*edge_it)->getSource();
-                if (auto* actual_arg = llvm::dyn_cast<pdg::PDGLLVMActualArgumentNode>(src.get())) {
+            auto* graph = arg_node->getCompactGraph();
+            const auto arg_id = arg_node->getNodeId();
+            for (auto pred_it = graph->predBegin(arg_id);
+                    pred_it != graph->predEnd(arg_id);
+                    ++pred_it) {
+                PDGNode* src = *pred_it;
+                if (auto* actual_arg = llvm::dyn_cast<pdg::PDGLLVMActualArgumentNode>(src)) {
                     if (cs == actual_arg->getCallSite()) {
                         llvm::dbgs() << "       conn: " << src->getNodeAsString() << "\n";
                     }
@@ -15,22 +15,20 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 
+#include "Passes/AAResultsPool.h"
+#include "Passes/SVFPointerAnalysisPass.h"
 #include "PDG/PDG/PDG.h"
 #include "PDG/SVFGDefUseAnalysisResults.h"
 #include "PDG/LLVMMemorySSADefUseAnalysisResults.h"
-#include "PDG/LLVMDominanceTree.h"
+#include "PDG/LLVMDominanceIntervals.h"
 #include "PDG/PDGBuilder.h"
 #include "PDG/PDGGraphTraits.h"
-#include "PDG/SVFGIndirectCallSiteResults.h"
 
 #include "SVF/MSSA/SVFG.h"
-#include "SVF/MSSA/SVFGBuilder.h"
-#include "SVF/Util/SVFModule.h"
-#include "SVF/MemoryModel/PointerAnalysis.h"
 #include "SVF/WPA/Andersen.h"
-#include "SVF/PDG/PDGPointerAnalysis.h"
 
 #include <fstream>
+#include <memory>
 
 llvm::cl::opt<std::string> def_use(
     "def-use",
@@ -53,6 +51,7 @@ public:
         AU.addRequiredTransitive<llvm::MemorySSAWrapperPass>();
         AU.addRequired<llvm::PostDominatorTreeWrapperPass>();
         AU.addRequired<llvm::DominatorTreeWrapperPass>();
+        AU.addRequired<pdg::SVFPointerAnalysisPass>();
         AU.setPreservesAll();
     }
 
@@ -61,19 +60,14 @@ public:
         auto memSSAGetter = [this] (llvm::Function* F) -> llvm::MemorySSA* {
             return &this->getAnalysis<llvm::MemorySSAWrapperPass>(*F).getMSSA();
         };
-        llvm::Optional<llvm::BasicAAResult> BAR;
-        llvm::Optional<llvm::AAResults> AAR;
-        auto AARGetter = [&](llvm::Function* F) -> llvm::AAResults* {
-            BAR.emplace(llvm::createLegacyPMBasicAAResult(*this, *F));
-            AAR.emplace(llvm::createLegacyPMAAResults(*this, *F, *BAR));
-            return &*AAR;
+        // one alias analysis result per function, freed once memory uses of the function are connected
+        pdg::AAResultsPool aaResultsPool(*this);
+        auto aliasAnalysisResGetter = [&aaResultsPool] (llvm::Function* F) {
+            return aaResultsPool.getAAResults(F);
+        };
+        auto aliasAnalysisResReleaser = [&aaResultsPool] (llvm::Function* F) {
+            aaResultsPool.release(F);
         };
-        std::unordered_map<llvm::Function*, llvm::AAResults*> functionAAResults;
-        for (auto& F : M) {
-            if (!F.isDeclaration()) {
-                functionAAResults.insert(std::make_pair(&F, AARGetter(&F)));
-            }
-        }
 
         auto domTreeGetter = [&] (llvm::Function* F) {
             return &this->getAnalysis<llvm::DominatorTreeWrapperPass>(*F).getDomTree();
@@ -82,18 +76,7 @@ public:
             return &this->getAnalysis<llvm::PostDominatorTreeWrapperPass>(*F).getPostDomTree();
         };
 
-        // Passing AARGetter to LLVMMemorySSADefUseAnalysisResults causes segmentation fault when requesting AAR
-        // use following functional as a workaround before the problem with AARGetter is found
-        auto aliasAnalysisResGetter = [&functionAAResults] (llvm::Function* F) {
-            return functionAAResults[F];
-        };
-
-        SVFModule svfM(M);
-        AndersenWaveDiff* ander = new svfg::PDGAndersenWaveDiff();
-        ander->disablePrintStat();
-        ander->analyze(svfM);
-        SVFGBuilder memSSA(true);
-        SVFG *svfg = memSSA.buildSVFG((BVDataPTAImpl*)ander);
+        auto& pta = getAnalysis<pdg::SVFPointerAnalysisPass>();
 
         using DefUseResultsTy = PDGBuilder::DefUseResultsTy;
         using IndCSResultsTy = PDGBuilder::IndCSResultsTy;
@@ -101,15 +84,17 @@ public:
         DefUseResultsTy defUse;
         if (def_use == "llvm") {
             llvm::dbgs() << "Use llvm def-use analysis\n";
-            defUse = DefUseResultsTy(new LLVMMemorySSADefUseAnalysisResults(memSSAGetter, aliasAnalysisResGetter));
+            auto memorySSADefUse = std::make_shared<LLVMMemorySSADefUseAnalysisResults>(memSSAGetter,
+                                                                                        aliasAnalysisResGetter);
+            memorySSADefUse->setAAResultsReleaser(aliasAnalysisResReleaser);
+            defUse = memorySSADefUse;
         } else {
             llvm::dbgs() << "Use llvm svfg analysis\n";
-            defUse = DefUseResultsTy(new SVFGDefUseAnalysisResults(svfg));
+            defUse = DefUseResultsTy(new SVFGDefUseAnalysisResults(pta.getSVFG()));
         }
-        IndCSResultsTy indCSRes = IndCSResultsTy(new
-                pdg::SVFGIndirectCallSiteResults(ander->getPTACallGraph()));
-        DominanceResultsTy domResults = DominanceResultsTy(new LLVMDominanceTree(domTreeGetter,
-                                                                                 postdomTreeGetter));
+        IndCSResultsTy indCSRes = pta.getIndirectCallSiteResults();
+        DominanceResultsTy domResults = DominanceResultsTy(new LLVMDominanceIntervals(domTreeGetter,
+                                                                                      postdomTreeGetter));
 
         pdg::PDGBuilder pdgBuilder(&M);
         pdgBuilder.setDesUseResults(defUse);
@@ -118,6 +103,9 @@ public:
         pdgBuilder.build();
 
         auto pdg = pdgBuilder.getPDG();
+        llvm::dbgs() << "PDG edges: " << pdg->getEdgesNum()
+                     << ", duplicate edges skipped: " << pdg->getDuplicateEdgesNum() << "\n";
+        pdg->freeze();
         for (auto& F : M) {
             if (F.isDeclaration()) {
                 continue;
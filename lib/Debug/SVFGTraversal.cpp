@@ -10,10 +10,8 @@
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 
 #include "SVF/MSSA/SVFG.h"
-#include "SVF/MSSA/SVFGBuilder.h"
-#include "SVF/Util/SVFModule.h"
-#include "SVF/MemoryModel/PointerAnalysis.h"
-#include "SVF/WPA/Andersen.h"
+
+#include "Passes/SVFPointerAnalysisPass.h"
 
 #include <unordered_set>
 
@@ -63,14 +61,15 @@ public:
     {
     }
 
+    void getAnalysisUsage(llvm::AnalysisUsage& AU) const override
+    {
+        AU.addRequired<pdg::SVFPointerAnalysisPass>();
+        AU.setPreservesAll();
+    }
+
     bool runOnModule(llvm::Module& M) override
     {
-        SVFModule svfM(M);
-        AndersenWaveDiff* ander = new AndersenWaveDiff();
-        ander->disablePrintStat();
-        ander->analyze(svfM);
-        SVFGBuilder memSSA(true);
-        SVFG *svfg = memSSA.buildSVFG((BVDataPTAImpl*)ander);
+        SVFG *svfg = getAnalysis<pdg::SVFPointerAnalysisPass>().getSVFG();
         auto* pag = svfg->getPAG();
         for (auto& F : M) {
             if (F.isDeclaration()) {
@@ -0,0 +1,119 @@
+#include "PDG/ControlDependencies.h"
+#include "PDG/DominanceIntervals.h"
+
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instruction.h"
+
+#include <unordered_set>
+
+namespace pdg {
+
+namespace {
+
+/// Post-dominator queries of ControlDependencies::compute. A block is null once the walk
+/// up the tree reaches the virtual exit
+class PostDominatorTreeQueries
+{
+public:
+    explicit PostDominatorTreeQueries(const llvm::PostDominatorTree& postDomTree)
+        : m_postDomTree(postDomTree)
+    {
+    }
+
+    bool isInTree(llvm::BasicBlock* block) const
+    {
+        return m_postDomTree.getNode(block) != nullptr;
+    }
+
+    llvm::BasicBlock* getImmediatePostDominator(llvm::BasicBlock* block) const
+    {
+        auto* idom = m_postDomTree.getNode(block)->getIDom();
+        return idom ? idom->getBlock() : nullptr;
+    }
+
+private:
+    const llvm::PostDominatorTree& m_postDomTree;
+}; // class PostDominatorTreeQueries
+
+class DominanceIntervalsQueries
+{
+public:
+    explicit DominanceIntervalsQueries(const DominanceIntervals& intervals)
+        : m_intervals(intervals)
+    {
+    }
+
+    bool isInTree(llvm::BasicBlock* block) const
+    {
+        return m_intervals.isInPostDomTree(block);
+    }
+
+    llvm::BasicBlock* getImmediatePostDominator(llvm::BasicBlock* block) const
+    {
+        return m_intervals.getImmediatePostDominator(block);
+    }
+
+private:
+    const DominanceIntervals& m_intervals;
+}; // class DominanceIntervalsQueries
+
+} // unnamed namespace
+
+ControlDependencies::ControlDependencies(llvm::Function& F, const llvm::PostDominatorTree& postDomTree)
+    : m_dependenciesNum(0)
+{
+    compute(F, PostDominatorTreeQueries(postDomTree));
+}
+
+ControlDependencies::ControlDependencies(llvm::Function& F, const DominanceIntervals& intervals)
+    : m_dependenciesNum(0)
+{
+    compute(F, DominanceIntervalsQueries(intervals));
+}
+
+template <typename PostDominators>
+void ControlDependencies::compute(llvm::Function& F, const PostDominators& postDominators)
+{
+    std::unordered_set<llvm::BasicBlock*> successors;
+    for (auto& B : F) {
+        auto* branch = B.getTerminator();
+        // the only successor of a block post-dominates it
+        if (!branch || branch->getNumSuccessors() < 2) {
+            continue;
+        }
+        if (!postDominators.isInTree(&B)) {
+            continue;
+        }
+        auto* stopBlock = postDominators.getImmediatePostDominator(&B);
+        successors.clear();
+        for (unsigned i = 0; i < branch->getNumSuccessors(); ++i) {
+            auto* successor = branch->getSuccessor(i);
+            // switch may have several cases going to the same block
+            if (!successors.insert(successor).second || !postDominators.isInTree(successor)) {
+                continue;
+            }
+            // chains of different successors may meet before the immediate post-dominator of the branch.
+            // Blocks get branches in order, so a branch already added is the last one
+            for (auto* block = successor;
+                    block && block != stopBlock;
+                    block = postDominators.getImmediatePostDominator(block)) {
+                auto& branches = m_blockBranches[block];
+                if (branches.empty() || branches.back() != branch) {
+                    branches.push_back(branch);
+                    ++m_dependenciesNum;
+                }
+            }
+        }
+    }
+}
+
+const ControlDependencies::Branches& ControlDependencies::getControllingBranches(llvm::BasicBlock* block) const
+{
+    static const Branches noBranches;
+    auto pos = m_blockBranches.find(block);
+    return pos == m_blockBranches.end() ? noBranches : pos->second;
+}
+
+} // namespace pdg
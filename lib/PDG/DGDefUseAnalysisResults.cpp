@@ -36,7 +36,7 @@ DefUseResults::DefSite DGDefUseAnalysisResults::getDefNode(llvm::Value* value)
     if (pos != m_valueDefSite.end()) {
         return pos->second;
     }
-    DefSite nulldefSite(nullptr, PDGNodeTy());
+    DefSite nulldefSite;
     auto* pts = getPointsTo(value);
     if (!pts) {
         m_valueDefSite.insert(std::make_pair(value, nulldefSite));
@@ -61,14 +61,12 @@ DefUseResults::DefSite DGDefUseAnalysisResults::getPdgDefNode(llvm::Value* value
 {
     llvm::DataLayout dl(m_module);
     const auto size = dl.getTypeAllocSize(value->getType());
-    llvm::Value* defValue = nullptr;
-    PDGNodeTy defNode;
     std::vector<llvm::Value*> values;
     std::vector<llvm::BasicBlock*> blocks;
 
     auto *mem = m_rd->getMapping(value);
     if (!mem) {
-        return DefSite(nullptr, PDGNodeTy());
+        return DefSite();
     }
     for (const auto& ptr : pts->pointsTo) {
         if (!ptr.isValid() || ptr.isInvalidated()) {
@@ -78,14 +76,12 @@ DefUseResults::DefSite DGDefUseAnalysisResults::getPdgDefNode(llvm::Value* value
     }
     assert(values.size() == blocks.size());
     if (values.size() == 1) {
-        if (auto* instr = llvm::dyn_cast<llvm::Instruction>(values[0])) {
-            defNode = PDGNodeTy(new PDGLLVMInstructionNode(instr));
-            defValue = values[0];
+        if (llvm::isa<llvm::Instruction>(values[0])) {
+            return DefSite(values[0]);
         }
-    } else {
-        defNode.reset(new PDGPhiNode(values, blocks));
+        return DefSite();
     }
-    return DefSite(defValue, defNode);
+    return DefSite(values, blocks);
 }
 
 void DGDefUseAnalysisResults::collectValuesAndBlocks(const dg::analysis::pta::Pointer& ptr,
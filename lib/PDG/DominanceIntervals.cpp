@@ -0,0 +1,79 @@
+#include "PDG/DominanceIntervals.h"
+
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+
+#include <utility>
+
+namespace pdg {
+
+const unsigned DominanceIntervals::NoBlock;
+const uint32_t DominanceIntervals::NotInTree;
+
+DominanceIntervals::DominanceIntervals(llvm::Function& F,
+                                       const llvm::DominatorTree& domTree,
+                                       const llvm::PostDominatorTree& postDomTree)
+{
+    for (auto& B : F) {
+        m_blockIndices[&B] = m_blocks.size();
+        m_blocks.push_back(&B);
+    }
+    m_domIntervals.resize(m_blocks.size());
+    m_postDomIntervals.resize(m_blocks.size());
+    m_immediatePostDominators.assign(m_blocks.size(), NoBlock);
+
+    numberTree(domTree.getRootNode(), m_domIntervals);
+    numberTree(postDomTree.getRootNode(), m_postDomIntervals);
+    for (unsigned index = 0; index < m_blocks.size(); ++index) {
+        auto* node = postDomTree.getNode(m_blocks[index]);
+        // the virtual exit has no block
+        if (node && node->getIDom() && node->getIDom()->getBlock()) {
+            m_immediatePostDominators[index] = getBlockIndex(node->getIDom()->getBlock());
+        }
+    }
+}
+
+llvm::BasicBlock* DominanceIntervals::getImmediatePostDominator(llvm::BasicBlock* block) const
+{
+    const unsigned index = getBlockIndex(block);
+    if (index == NoBlock || m_immediatePostDominators[index] == NoBlock) {
+        return nullptr;
+    }
+    return m_blocks[m_immediatePostDominators[index]];
+}
+
+template <typename DomTreeNode>
+void DominanceIntervals::numberTree(const DomTreeNode* root, Intervals& intervals)
+{
+    if (!root) {
+        return;
+    }
+    // iterative DFS, trees of large functions are too deep for recursion.
+    // Nodes without blocks, i.e. the virtual exit of post-dominator tree, are traversed but not numbered
+    uint32_t number = 0;
+    std::vector<std::pair<const DomTreeNode*, typename DomTreeNode::const_iterator>> stack;
+    stack.push_back(std::make_pair(root, root->begin()));
+    if (root->getBlock()) {
+        intervals[getBlockIndex(root->getBlock())].in = number++;
+    }
+    while (!stack.empty()) {
+        auto& top = stack.back();
+        if (top.second == top.first->end()) {
+            if (top.first->getBlock()) {
+                intervals[getBlockIndex(top.first->getBlock())].out = number++;
+            }
+            stack.pop_back();
+            continue;
+        }
+        const DomTreeNode* child = *top.second;
+        ++top.second;
+        if (child->getBlock()) {
+            intervals[getBlockIndex(child->getBlock())].in = number++;
+        }
+        stack.push_back(std::make_pair(child, child->begin()));
+    }
+}
+
+} // namespace pdg
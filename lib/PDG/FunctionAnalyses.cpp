@@ -0,0 +1,97 @@
+#include "PDG/FunctionAnalyses.h"
+
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/AssumptionCache.h"
+#include "llvm/Analysis/BasicAliasAnalysis.h"
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+
+#include <cassert>
+
+namespace pdg {
+
+struct FunctionAnalyses::Results
+{
+    std::unique_ptr<llvm::DominatorTree> domTree;
+    std::unique_ptr<llvm::PostDominatorTree> postDomTree;
+    std::unique_ptr<llvm::AssumptionCache> assumptionCache;
+    std::unique_ptr<llvm::BasicAAResult> basicAAResult;
+    std::unique_ptr<llvm::AAResults> aaResults;
+    std::unique_ptr<llvm::MemorySSA> memorySSA;
+};
+
+FunctionAnalyses::FunctionAnalyses(llvm::Module& M)
+    : m_tlii(llvm::Triple(M.getTargetTriple()))
+    , m_tli(m_tlii)
+{
+}
+
+FunctionAnalyses::~FunctionAnalyses()
+{
+}
+
+void FunctionAnalyses::computeDominance(llvm::Function* F)
+{
+    auto& results = m_results[F];
+    results.reset(new Results());
+    results->domTree.reset(new llvm::DominatorTree(*F));
+    results->postDomTree.reset(new llvm::PostDominatorTree());
+    results->postDomTree->recalculate(*F);
+}
+
+llvm::DominatorTree* FunctionAnalyses::getDomTree(llvm::Function* F)
+{
+    return getResults(F).domTree.get();
+}
+
+llvm::PostDominatorTree* FunctionAnalyses::getPostDomTree(llvm::Function* F)
+{
+    return getResults(F).postDomTree.get();
+}
+
+llvm::AAResults* FunctionAnalyses::getAAResults(llvm::Function* F)
+{
+    auto& results = getResults(F);
+    if (!results.aaResults) {
+        results.assumptionCache.reset(new llvm::AssumptionCache(*F));
+        results.basicAAResult.reset(new llvm::BasicAAResult(F->getParent()->getDataLayout(), *F, m_tli,
+                                                            *results.assumptionCache,
+                                                            results.domTree.get()));
+        results.aaResults.reset(new llvm::AAResults(m_tli));
+        results.aaResults->addAAResult(*results.basicAAResult);
+    }
+    return results.aaResults.get();
+}
+
+llvm::MemorySSA* FunctionAnalyses::getMemorySSA(llvm::Function* F)
+{
+    auto& results = getResults(F);
+    if (!results.memorySSA) {
+        results.memorySSA.reset(new llvm::MemorySSA(*F, getAAResults(F), results.domTree.get()));
+    }
+    return results.memorySSA.get();
+}
+
+void FunctionAnalyses::release(llvm::Function* F)
+{
+    m_results.erase(F);
+}
+
+void FunctionAnalyses::releaseAll()
+{
+    m_results.clear();
+}
+
+FunctionAnalyses::Results& FunctionAnalyses::getResults(llvm::Function* F)
+{
+    auto pos = m_results.find(F);
+    assert(pos != m_results.end());
+    return *pos->second;
+}
+
+} // namespace pdg
+
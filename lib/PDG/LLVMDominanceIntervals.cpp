@@ -0,0 +1,58 @@
+#include "PDG/LLVMDominanceIntervals.h"
+#include "PDG/ControlDependencies.h"
+
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Dominators.h"
+
+namespace pdg {
+
+LLVMDominanceIntervals::LLVMDominanceIntervals(const DominatorTreeGetter& domTreeGetter,
+                                               const PostDominatorTreeGetter& postdomTreeGetter)
+    : m_domTreeGetter(domTreeGetter)
+    , m_posdomTreeGetter(postdomTreeGetter)
+    , m_lastFunction(nullptr)
+    , m_lastSnapshot(nullptr)
+{
+}
+
+bool LLVMDominanceIntervals::dominates(llvm::BasicBlock* blockA, llvm::BasicBlock* blockB)
+{
+    return snapshot(blockA->getParent()).dominates(blockA, blockB);
+}
+
+bool LLVMDominanceIntervals::posdominates(llvm::BasicBlock* blockA, llvm::BasicBlock* blockB)
+{
+    return snapshot(blockA->getParent()).posdominates(blockA, blockB);
+}
+
+std::unique_ptr<ControlDependencies> LLVMDominanceIntervals::getControlDependencies(llvm::Function* F)
+{
+    // immediate post-dominators are all it needs, numbering both trees would be wasted
+    return std::unique_ptr<ControlDependencies>(new ControlDependencies(*F, *m_posdomTreeGetter(F)));
+}
+
+void LLVMDominanceIntervals::invalidate(llvm::Function* F)
+{
+    if (F == m_lastFunction) {
+        m_lastFunction = nullptr;
+        m_lastSnapshot = nullptr;
+    }
+    m_snapshots.erase(F);
+}
+
+const DominanceIntervals& LLVMDominanceIntervals::snapshot(llvm::Function* F)
+{
+    if (F == m_lastFunction) {
+        return *m_lastSnapshot;
+    }
+    auto& intervals = m_snapshots[F];
+    if (!intervals) {
+        intervals.reset(new DominanceIntervals(*F, *m_domTreeGetter(F), *m_posdomTreeGetter(F)));
+    }
+    m_lastFunction = F;
+    m_lastSnapshot = intervals.get();
+    return *intervals;
+}
+
+} // namespace pdg
@@ -1,8 +1,9 @@
 #include "PDG/LLVMMemorySSADefUseAnalysisResults.h"
 #include "PDG/IndirectCallSitesAnalysis.h"
 
-#include "PDG/PDGLLVMNode.h"
-
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/BasicAliasAnalysis.h"
@@ -13,56 +14,281 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
+#include <iterator>
+
 namespace pdg {
 
+namespace {
+
+/// Location read by the value, false if it reads none of known size
+bool getReadLocation(llvm::Value* value, const llvm::DataLayout& DL, const llvm::Value*& pointer, uint64_t& size)
+{
+    if (auto* load = llvm::dyn_cast<llvm::LoadInst>(value)) {
+        pointer = load->getPointerOperand();
+        size = DL.getTypeStoreSize(load->getType());
+        return true;
+    }
+    if (value->getType()->isSized()) {
+        pointer = value;
+        size = DL.getTypeStoreSize(value->getType());
+        return true;
+    }
+    return false;
+}
+
+} // unnamed namespace
+
 LLVMMemorySSADefUseAnalysisResults::LLVMMemorySSADefUseAnalysisResults(
                         const MemorySSAGetter& mssaGetter,
                         const AARGetter& aarGetter)
     : m_memorySSAGetter(mssaGetter)
     , m_aarGetter(aarGetter)
+    , m_precomputeDefSites(true)
 {
 }
 
 DefUseResults::DefSite LLVMMemorySSADefUseAnalysisResults::getDefNode(llvm::Value* value)
 {
-    auto pos = m_valueDefSite.find(value);
-    if (pos != m_valueDefSite.end()) {
+    llvm::Instruction* instr = llvm::dyn_cast<llvm::Instruction>(value);
+    llvm::Function* F = instr ? instr->getFunction() : nullptr;
+    auto& valueDefSite = m_valueDefSites[F];
+    auto pos = valueDefSite.find(value);
+    if (pos != valueDefSite.end()) {
         return pos->second;
     }
-    DefSite nullDefSite(nullptr, PDGNodeTy());
-    llvm::Instruction* instr = llvm::dyn_cast<llvm::Instruction>(value);
+    DefSite nullDefSite;
     if (!instr) {
-        m_valueDefSite.insert(std::make_pair(value, nullDefSite));
+        valueDefSite.insert(std::make_pair(value, nullDefSite));
         return nullDefSite;
     }
-    auto* memorySSA = m_memorySSAGetter(instr->getParent()->getParent());
-    llvm::Function* F = instr->getFunction();
-    auto* aa = m_aarGetter(F);
+    auto* memorySSA = m_memorySSAGetter(F);
 
     auto* memDefAccess = getMemoryDefAccess(instr, memorySSA);
     if (!memDefAccess) {
-        m_valueDefSite.insert(std::make_pair(value, nullDefSite));
+        valueDefSite.insert(std::make_pair(value, nullDefSite));
         return nullDefSite;
     }
     if (auto* memDef = llvm::dyn_cast<llvm::MemoryDef>(memDefAccess)) {
         auto* memInst = memDef->getMemoryInst();
         if (!memInst) {
-            m_valueDefSite.insert(std::make_pair(value, nullDefSite));
+            valueDefSite.insert(std::make_pair(value, nullDefSite));
             return nullDefSite;
         }
-        return DefSite(memInst, PDGNodeTy(new PDGLLVMInstructionNode(memInst)));
+        return DefSite(memInst);
     } else if (auto* memPhi = llvm::dyn_cast<llvm::MemoryPhi>(memDefAccess)) {
-        std::unordered_set<llvm::MemoryAccess*> processedAccesses;
-        const auto& defSites = getDefSites(value, memPhi, memorySSA, aa, processedAccesses);
-        PDGNodeTy phiNode = PDGNodeTy(new PDGPhiNode(defSites.values, defSites.blocks));
-        auto res = m_valueDefSite.insert(std::make_pair(value,  DefSite(nullptr, phiNode)));
+        // alias analysis is requested only when walking, results may be created on request
+        const auto& defSites = getDefSites(value, memPhi, memorySSA, m_aarGetter(F));
+        auto res = valueDefSite.insert(std::make_pair(value, DefSite(defSites.values, defSites.blocks)));
         return res.first->second;
     }
     assert(false);
-    m_valueDefSite.insert(std::make_pair(value, nullDefSite));
+    valueDefSite.insert(std::make_pair(value, nullDefSite));
     return nullDefSite;
 }
 
+void LLVMMemorySSADefUseAnalysisResults::invalidate(llvm::Function* F)
+{
+    m_valueDefSites.erase(F);
+    m_walkResults.erase(F);
+    m_modRefCache.clear(F);
+    if (m_aarReleaser) {
+        m_aarReleaser(F);
+    }
+}
+
+void LLVMMemorySSADefUseAnalysisResults::prepareFunction(llvm::Function* F)
+{
+    if (!m_precomputeDefSites || F->isDeclaration()) {
+        return;
+    }
+    auto* memorySSA = m_memorySSAGetter(F);
+    const auto& DL = F->getParent()->getDataLayout();
+    auto& walkResults = m_walkResults[F];
+
+    // memory phis reaching loads, grouped by location read. Access of the group key is null
+    std::unordered_map<WalkKey, std::vector<llvm::MemoryPhi*>, WalkKeyHash> locationPhis;
+    std::vector<WalkKey> locations;
+    std::unordered_set<WalkKey, WalkKeyHash> queries;
+    for (auto& B : *F) {
+        for (auto& I : B) {
+            auto* load = llvm::dyn_cast<llvm::LoadInst>(&I);
+            if (!load) {
+                continue;
+            }
+            auto* memPhi = llvm::dyn_cast_or_null<llvm::MemoryPhi>(getMemoryDefAccess(load, memorySSA));
+            const llvm::Value* pointer = nullptr;
+            uint64_t size = 0;
+            if (!memPhi || !getReadLocation(load, DL, pointer, size)) {
+                continue;
+            }
+            const WalkKey query{memPhi, pointer, size};
+            if (walkResults.find(query) != walkResults.end() || !queries.insert(query).second) {
+                continue;
+            }
+            auto& phis = locationPhis[WalkKey{nullptr, pointer, size}];
+            if (phis.empty()) {
+                locations.push_back(WalkKey{nullptr, pointer, size});
+            }
+            phis.push_back(memPhi);
+        }
+    }
+
+    // a location read through a single phi is walked on request, the walk visits no more than a sweep would
+    FunctionAccesses functionAccesses;
+    llvm::AAResults* aa = nullptr;
+    for (const auto& location : locations) {
+        const auto& phis = locationPhis[location];
+        if (phis.size() < 2) {
+            continue;
+        }
+        if (!aa) {
+            aa = m_aarGetter(F);
+            for (auto& B : *F) {
+                if (auto* memPhi = memorySSA->getMemoryAccess(&B)) {
+                    functionAccesses.indices[memPhi] = functionAccesses.accesses.size();
+                    functionAccesses.accesses.push_back(memPhi);
+                }
+                for (auto& I : B) {
+                    if (auto* def = llvm::dyn_cast_or_null<llvm::MemoryDef>(memorySSA->getMemoryAccess(&I))) {
+                        functionAccesses.indices[def] = functionAccesses.accesses.size();
+                        functionAccesses.accesses.push_back(def);
+                    }
+                }
+            }
+        }
+        sweepLocation(location.pointer, location.size, phis, functionAccesses, memorySSA, aa, walkResults);
+    }
+}
+
+void LLVMMemorySSADefUseAnalysisResults::sweepLocation(const llvm::Value* pointer,
+                                                       uint64_t size,
+                                                       const std::vector<llvm::MemoryPhi*>& phis,
+                                                       const FunctionAccesses& functionAccesses,
+                                                       llvm::MemorySSA* memorySSA,
+                                                       llvm::AAResults* aa,
+                                                       WalkResults& walkResults)
+{
+    static const unsigned NoAccess = ~0u;
+    const auto& accesses = functionAccesses.accesses;
+    auto getIndex = [&functionAccesses] (llvm::MemoryAccess* access) {
+        auto pos = functionAccesses.indices.find(access);
+        assert(pos != functionAccesses.indices.end());
+        return pos->second;
+    };
+
+    // nearest phi or def site of the location at or above an access, defs not defining the location are
+    // passed as a walk passes them. NoAccess if live on entry is reached
+    llvm::DenseMap<unsigned, unsigned> representatives;
+    std::vector<unsigned> chain;
+    auto getRepresentative = [&] (llvm::MemoryAccess* access) {
+        unsigned representative = NoAccess;
+        chain.clear();
+        while (access && !memorySSA->isLiveOnEntryDef(access)) {
+            const unsigned index = getIndex(access);
+            auto pos = representatives.find(index);
+            if (pos != representatives.end()) {
+                representative = pos->second;
+                break;
+            }
+            chain.push_back(index);
+            auto* def = llvm::dyn_cast<llvm::MemoryDef>(access);
+            if (!def || isDefSite(def, pointer, size, aa)) {
+                representative = index;
+                break;
+            }
+            access = def->getDefiningAccess();
+        }
+        for (auto index : chain) {
+            representatives[index] = representative;
+        }
+        return representative;
+    };
+
+    // phis the given ones depend on, processed in block order
+    std::vector<unsigned> phiIndices;
+    llvm::DenseSet<unsigned> foundPhis;
+    std::vector<unsigned> worklist;
+    for (auto* memPhi : phis) {
+        worklist.push_back(getIndex(memPhi));
+    }
+    while (!worklist.empty()) {
+        const unsigned index = worklist.back();
+        worklist.pop_back();
+        if (!foundPhis.insert(index).second) {
+            continue;
+        }
+        phiIndices.push_back(index);
+        auto* memPhi = llvm::cast<llvm::MemoryPhi>(accesses[index]);
+        for (unsigned i = 0; i < memPhi->getNumIncomingValues(); ++i) {
+            const unsigned operand = getRepresentative(memPhi->getIncomingValue(i));
+            if (operand != NoAccess && llvm::isa<llvm::MemoryPhi>(accesses[operand])) {
+                worklist.push_back(operand);
+            }
+        }
+    }
+    std::sort(phiIndices.begin(), phiIndices.end());
+    llvm::DenseMap<unsigned, unsigned> phiPositions;
+    for (unsigned position = 0; position < phiIndices.size(); ++position) {
+        phiPositions[phiIndices[position]] = position;
+    }
+
+    // def sites of each phi as sorted access indices. Sets only grow, iterate until none does
+    std::vector<std::vector<unsigned>> defSites(phiIndices.size());
+    std::vector<unsigned> merged;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (unsigned position = 0; position < phiIndices.size(); ++position) {
+            auto* memPhi = llvm::cast<llvm::MemoryPhi>(accesses[phiIndices[position]]);
+            auto& phiDefSites = defSites[position];
+            for (unsigned i = 0; i < memPhi->getNumIncomingValues(); ++i) {
+                const unsigned operand = getRepresentative(memPhi->getIncomingValue(i));
+                if (operand == NoAccess) {
+                    continue;
+                }
+                merged.clear();
+                auto pos = phiPositions.find(operand);
+                if (pos == phiPositions.end()) {
+                    std::set_union(phiDefSites.begin(), phiDefSites.end(), &operand, &operand + 1,
+                                   std::back_inserter(merged));
+                } else {
+                    const auto& operandDefSites = defSites[pos->second];
+                    std::set_union(phiDefSites.begin(), phiDefSites.end(),
+                                   operandDefSites.begin(), operandDefSites.end(),
+                                   std::back_inserter(merged));
+                }
+                if (merged.size() != phiDefSites.size()) {
+                    phiDefSites.swap(merged);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    ++m_walkStatistics.sweepsNum;
+    for (auto* memPhi : phis) {
+        PHI phiDefSites;
+        for (auto index : defSites[phiPositions[getIndex(memPhi)]]) {
+            auto* def = llvm::cast<llvm::MemoryDef>(accesses[index]);
+            phiDefSites.values.push_back(def->getMemoryInst());
+            phiDefSites.blocks.push_back(def->getBlock());
+        }
+        walkResults.insert(std::make_pair(WalkKey{memPhi, pointer, size}, std::move(phiDefSites)));
+        ++m_walkStatistics.precomputedNum;
+    }
+}
+
+void LLVMMemorySSADefUseAnalysisResults::finishFunction(llvm::Function* F)
+{
+    // walks are keyed by memory accesses, which go away with MemorySSA if the releaser frees it
+    m_walkResults.erase(F);
+    m_modRefCache.clear(F);
+    if (m_aarReleaser) {
+        m_aarReleaser(F);
+    }
+}
+
 llvm::MemoryAccess* LLVMMemorySSADefUseAnalysisResults::getMemoryDefAccess(llvm::Instruction* instr,
                                                                            llvm::MemorySSA* memorySSA)
 {
@@ -77,53 +303,91 @@ llvm::MemoryAccess* LLVMMemorySSADefUseAnalysisResults::getMemoryDefAccess(llvm:
     return memUse->getDefiningAccess();
 }
 
-LLVMMemorySSADefUseAnalysisResults::PHI
+bool LLVMMemorySSADefUseAnalysisResults::isDefSite(llvm::MemoryDef* def,
+                                                   const llvm::Value* pointer,
+                                                   uint64_t size,
+                                                   llvm::AAResults* aa)
+{
+    auto modRef = m_modRefCache.getModRefInfo(aa, def->getMemoryInst(), pointer, size);
+    return modRef == llvm::ModRefInfo::MustMod || modRef == llvm::ModRefInfo::Mod;
+}
+
+std::size_t LLVMMemorySSADefUseAnalysisResults::WalkKeyHash::operator()(const WalkKey& key) const
+{
+    return llvm::hash_combine(key.access, key.pointer, key.size);
+}
+
+const LLVMMemorySSADefUseAnalysisResults::PHI&
 LLVMMemorySSADefUseAnalysisResults::getDefSites(llvm::Value* value,
                                                 llvm::MemoryAccess* access,
                                                 llvm::MemorySSA* memorySSA,
-                                                llvm::AAResults* aa,
-                                                std::unordered_set<llvm::MemoryAccess*>& processedAccesses)
+                                                llvm::AAResults* aa)
 {
-    PHI phi;
-    if (!processedAccesses.insert(access).second) {
-        return phi;
-    }
+    static const PHI noDefSites;
     if (!access || !value) {
-        return phi;
-    }
-    if (memorySSA->isLiveOnEntryDef(access)) {
-        return phi;
-    }
-    if (auto* def = llvm::dyn_cast<llvm::MemoryDef>(access)) {
-        const auto& DL = def->getBlock()->getModule()->getDataLayout();
-        llvm::ModRefInfo modRef;
-        if (auto* load = llvm::dyn_cast<llvm::LoadInst>(value)) {
-            modRef = aa->getModRefInfo(def->getMemoryInst(),
-                                       load->getPointerOperand(),
-                                        DL.getTypeStoreSize(load->getType()));
-        } else if (value->getType()->isSized()) {
-            modRef = aa->getModRefInfo(def->getMemoryInst(), value,
-                                       DL.getTypeStoreSize(value->getType()));
-        } else {
-            return phi;
+        return noDefSites;
+    }
+    const auto& DL = access->getBlock()->getModule()->getDataLayout();
+    const llvm::Value* pointer = nullptr;
+    uint64_t size = 0;
+    if (!getReadLocation(value, DL, pointer, size)) {
+        return noDefSites;
+    }
+
+    ++m_walkStatistics.queriesNum;
+    auto& walkResults = m_walkResults[access->getBlock()->getParent()];
+    auto pos = walkResults.find(WalkKey{access, pointer, size});
+    if (pos != walkResults.end()) {
+        ++m_walkStatistics.memoHitsNum;
+        return pos->second;
+    }
+
+    // depth first, in the order of phi operands. Only complete walks are memoized, an access on a cycle
+    // can not be given def sites before the whole cycle is walked
+    PHI defSites;
+    std::unordered_set<llvm::Value*> foundDefs;
+    auto addDefSite = [&] (llvm::Value* def, llvm::BasicBlock* block) {
+        if (foundDefs.insert(def).second) {
+            defSites.values.push_back(def);
+            defSites.blocks.push_back(block);
+        }
+    };
+    std::unordered_set<llvm::MemoryAccess*> visitedAccesses;
+    std::vector<llvm::MemoryAccess*> worklist(1, access);
+    uint64_t walkLength = 0;
+    while (!worklist.empty()) {
+        auto* current = worklist.back();
+        worklist.pop_back();
+        if (!current || memorySSA->isLiveOnEntryDef(current) || !visitedAccesses.insert(current).second) {
+            continue;
         }
-        if (modRef == llvm::ModRefInfo::MustMod || modRef == llvm::ModRefInfo::Mod) {
-            phi.values.push_back(def->getMemoryInst());
-            phi.blocks.push_back(def->getBlock());
-            return phi;
+        ++walkLength;
+        if (current != access) {
+            auto memo = walkResults.find(WalkKey{current, pointer, size});
+            if (memo != walkResults.end()) {
+                ++m_walkStatistics.memoReusesNum;
+                for (unsigned i = 0; i < memo->second.values.size(); ++i) {
+                    addDefSite(memo->second.values[i], memo->second.blocks[i]);
+                }
+                continue;
+            }
         }
-        return getDefSites(value, def->getDefiningAccess(), memorySSA, aa, processedAccesses);
-    }
-    if (auto* memphi = llvm::dyn_cast<llvm::MemoryPhi>(access)) {
-        for (auto def_it = memphi->defs_begin(); def_it != memphi->defs_end(); ++def_it) {
-            auto accesses = getDefSites(value, *def_it, memorySSA, aa, processedAccesses);
-            if (!accesses.empty()) {
-                phi.values.insert(phi.values.end(), accesses.values.begin(), accesses.values.end());
-                phi.blocks.insert(phi.blocks.end(), accesses.blocks.begin(), accesses.blocks.end());
+        if (auto* def = llvm::dyn_cast<llvm::MemoryDef>(current)) {
+            if (isDefSite(def, pointer, size, aa)) {
+                addDefSite(def->getMemoryInst(), def->getBlock());
+            } else {
+                worklist.push_back(def->getDefiningAccess());
+            }
+        } else if (auto* memphi = llvm::dyn_cast<llvm::MemoryPhi>(current)) {
+            // pushed in reverse, so that operands are walked in order
+            for (unsigned i = memphi->getNumIncomingValues(); i-- > 0; ) {
+                worklist.push_back(memphi->getIncomingValue(i));
             }
         }
     }
-    return phi;
+    m_walkStatistics.visitedAccessesNum += walkLength;
+    m_walkStatistics.longestWalk = std::max(m_walkStatistics.longestWalk, walkLength);
+    return walkResults.insert(std::make_pair(WalkKey{access, pointer, size}, std::move(defSites))).first->second;
 }
 
 } // namespace pdg
@@ -0,0 +1,60 @@
+#include "PDG/ModRefCache.h"
+
+#include "llvm/ADT/Hashing.h"
+#include "llvm/IR/Instruction.h"
+
+namespace pdg {
+
+const std::size_t ModRefCache::DefaultCapacity;
+
+ModRefCache::ModRefCache(std::size_t capacity)
+    : m_capacity(capacity)
+    , m_function(nullptr)
+{
+}
+
+std::size_t ModRefCache::KeyHash::operator()(const Key& key) const
+{
+    return llvm::hash_combine(key.instr, key.pointer, key.size);
+}
+
+llvm::ModRefInfo ModRefCache::getModRefInfo(llvm::AAResults* aa,
+                                            llvm::Instruction* instr,
+                                            const llvm::Value* pointer,
+                                            uint64_t size)
+{
+    if (m_capacity == 0) {
+        ++m_statistics.missesNum;
+        return aa->getModRefInfo(instr, pointer, size);
+    }
+    if (instr->getFunction() != m_function) {
+        m_answers.clear();
+        m_function = instr->getFunction();
+    }
+    const Key key{instr, pointer, size};
+    auto pos = m_answers.find(key);
+    if (pos != m_answers.end()) {
+        ++m_statistics.hitsNum;
+        return pos->second;
+    }
+    ++m_statistics.missesNum;
+    const llvm::ModRefInfo modRef = aa->getModRefInfo(instr, pointer, size);
+    if (m_answers.size() >= m_capacity) {
+        m_answers.clear();
+        ++m_statistics.flushesNum;
+    }
+    m_answers.insert(std::make_pair(key, modRef));
+    return modRef;
+}
+
+void ModRefCache::clear(llvm::Function* F)
+{
+    if (F != m_function) {
+        return;
+    }
+    // release memory as well, the next function may need much less
+    std::unordered_map<Key, llvm::ModRefInfo, KeyHash>().swap(m_answers);
+    m_function = nullptr;
+}
+
+} // namespace pdg
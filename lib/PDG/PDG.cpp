@@ -1,5 +1,8 @@
 #include "PDG/PDG.h"
 
+#include "PDG/FunctionPDG.h"
+#include "PDG/PDGCompactGraph.h"
+
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/GlobalVariable.h"
@@ -7,34 +10,152 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
 
 namespace pdg {
 
-PDG::PDGNodeTy PDG::getGlobalVariableNode(llvm::GlobalVariable* variable)
+PDG::PDG(llvm::Module* M)
+    : m_module(M)
+    , m_edgesNum(0)
+    , m_duplicateEdgesNum(0)
+    , m_hasRemovedNodes(false)
+{
+}
+
+PDG::~PDG()
+{
+}
+
+PDG::NodeId PDG::addNode(PDGNodeTy node)
+{
+    assert(node->getNodeId() == PDGNode::InvalidNodeId);
+    if (!node->hasEdgeArena()) {
+        node->setEdgeArena(&m_edgeArena);
+    }
+    const NodeId id = m_nodes.size();
+    m_nodes.push_back(node);
+    node->setNodeId(id);
+    return id;
+}
+
+bool PDG::addNode(llvm::Value* value, PDGNodeTy node)
+{
+    auto res = m_valueNodeIds.insert(std::make_pair(value, m_nodes.size()));
+    if (!res.second) {
+        return false;
+    }
+    addNode(node);
+    return true;
+}
+
+void PDG::removeNodes(const Nodes& nodes)
+{
+    // unregister all first, so that edges between removed nodes are not searched for
+    for (auto* node : nodes) {
+        const NodeId id = node->getNodeId();
+        assert(m_nodes[id] == node);
+        m_nodes[id] = nullptr;
+        auto* llvmNode = llvm::dyn_cast<PDGLLVMNode>(node);
+        if (!llvmNode || !llvmNode->getNodeValue()) {
+            continue;
+        }
+        // actual argument nodes have values, but are not mapped to them
+        auto pos = m_valueNodeIds.find(llvmNode->getNodeValue());
+        if (pos != m_valueNodeIds.end() && pos->second == id) {
+            m_valueNodeIds.erase(pos);
+        }
+    }
+    // edges between two removed nodes are counted once, by their source.
+    // Edges already compacted are dropped from the compact graph when it is frozen again
+    unsigned removedEdgesNum = 0;
+    for (auto* node : nodes) {
+        for (const auto& edge : node->getOutEdges()) {
+            ++removedEdgesNum;
+            if (auto* dest = m_nodes[edge.getDestinationId()]) {
+                dest->removeInEdge(edge);
+            }
+        }
+        for (const auto& edge : node->getInEdges()) {
+            if (auto* source = m_nodes[edge.getSourceId()]) {
+                source->removeOutEdge(edge);
+                ++removedEdgesNum;
+            }
+        }
+        node->releaseEdges();
+    }
+    m_edgesNum -= std::min(removedEdgesNum, m_edgesNum);
+    m_hasRemovedNodes = m_hasRemovedNodes || !nodes.empty();
+}
+
+bool PDG::addEdgeKind(EdgeKindsMap& edgeKinds, NodeId source, NodeId dest, EdgeKinds kind)
+{
+    assert(source != PDGNode::InvalidNodeId && dest != PDGNode::InvalidNodeId);
+    auto& kinds = edgeKinds[(static_cast<uint64_t>(source) << 32) | dest];
+    if (kinds & kind) {
+        return false;
+    }
+    kinds |= kind;
+    return true;
+}
+
+bool PDG::hasGlobalVariableNode(llvm::GlobalVariable* variable) const
+{
+    return hasNode(variable);
+}
+
+bool PDG::hasFunctionNode(llvm::Function* function) const
+{
+    return hasNode(function);
+}
+
+PDG::PDGNodeTy PDG::getGlobalVariableNode(llvm::GlobalVariable* variable) const
 {
-    assert(hasGlobalVariableNode(variable));
-    return m_globalVariableNodes.find(variable)->second;
+    return getNode(variable);
 }
 
 PDG::PDGFunctionNodeTy PDG::getFunctionNode(llvm::Function* function) const
 {
-    assert(hasFunctionNode(function));
-    return m_functionNodes.find(function)->second;
+    return llvm::cast<PDGLLVMFunctionNode>(getNode(function));
 }
 
 PDG::FunctionPDGTy PDG::getFunctionPDG(llvm::Function* F)
 {
     assert(hasFunctionPDG(F));
+    if (m_pendingFunctions.erase(F)) {
+        assert(m_functionPDGBuilder);
+        const NodeId oldSize = size();
+        m_functionPDGBuilder(F);
+        if (isFrozen()) {
+            // compacting whole graph for every function built would be quadratic,
+            // functions built until the next query are merged in at once
+            Nodes addedNodes;
+            for (NodeId id = oldSize; id < size(); ++id) {
+                if (m_nodes[id]) {
+                    addedNodes.push_back(m_nodes[id]);
+                }
+            }
+            m_compactGraph->markStale(addedNodes, [this] () { freeze(); });
+        }
+    }
     return m_functionPDGs.find(F)->second;
 }
 
+bool PDG::addGlobalVariableNode(llvm::GlobalVariable* variable, PDGNodeTy node)
+{
+    return addNode(variable, node);
+}
+
 bool PDG::addGlobalVariableNode(llvm::GlobalVariable* variable)
 {
     if (hasGlobalVariableNode(variable)) {
         return false;
     }
-    m_globalVariableNodes.insert(std::make_pair(variable, PDGNodeTy(new PDGLLVMGlobalVariableNode(variable))));
-    return true;
+    return addNode(variable, m_arena.create<PDGLLVMGlobalVariableNode>(variable));
+}
+
+bool PDG::addFunctionNode(llvm::Function* function, PDGFunctionNodeTy node)
+{
+    return addNode(function, node);
 }
 
 bool PDG::addFunctionNode(llvm::Function* function)
@@ -42,8 +163,27 @@ bool PDG::addFunctionNode(llvm::Function* function)
     if (hasFunctionNode(function)) {
         return false;
     }
-    m_functionNodes.insert(std::make_pair(function, PDGFunctionNodeTy(new PDGLLVMFunctionNode(function))));
-    return true;
+    return addNode(function, m_arena.create<PDGLLVMFunctionNode>(function));
+}
+
+void PDG::freeze()
+{
+    if (!m_compactGraph) {
+        m_compactGraph.reset(new PDGCompactGraph());
+    } else if (!m_compactGraph->isStale()
+                   && !m_hasRemovedNodes
+                   && m_compactGraph->size() == size()
+                   && m_compactGraph->edgesSize() == m_edgesNum) {
+        return;
+    }
+    m_duplicateEdgesNum += m_compactGraph->build(m_nodes);
+    m_edgesNum = m_compactGraph->edgesSize();
+    m_hasRemovedNodes = false;
+    // compact graph has released edges of all nodes
+    m_edgeArena.clear();
+    for (auto& item : m_functionPDGs) {
+        item.second->clearEdgeArenas();
+    }
 }
 
 } // namespace pdg
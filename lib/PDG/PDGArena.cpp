@@ -0,0 +1,94 @@
+#include "PDG/PDGArena.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+namespace pdg {
+
+PDGArena::PDGArena(std::size_t chunkSize)
+    : m_chunkSize(chunkSize)
+    , m_current(nullptr)
+    , m_end(nullptr)
+    , m_allocatedSize(0)
+{
+}
+
+PDGArena::~PDGArena()
+{
+    clear();
+}
+
+void PDGArena::clear()
+{
+    // destroy in reverse order of construction
+    for (auto it = m_destructors.rbegin(); it != m_destructors.rend(); ++it) {
+        it->destroy(it->object);
+    }
+    std::vector<Destructor>().swap(m_destructors);
+    std::vector<Chunk>().swap(m_chunks);
+    std::vector<void*>().swap(m_freeBlocks);
+    m_current = nullptr;
+    m_end = nullptr;
+    m_allocatedSize = 0;
+}
+
+bool PDGArena::contains(const void* object) const
+{
+    const char* position = static_cast<const char*>(object);
+    return std::any_of(m_chunks.begin(), m_chunks.end(), [position] (const Chunk& chunk) {
+        return position >= chunk.memory.get() && position < chunk.memory.get() + chunk.size;
+    });
+}
+
+void* PDGArena::allocateBlock(std::size_t& size)
+{
+    unsigned sizeClass = 0;
+    while ((std::size_t(1) << sizeClass) < std::max(size, sizeof(void*))) {
+        ++sizeClass;
+    }
+    size = std::size_t(1) << sizeClass;
+    if (sizeClass < m_freeBlocks.size() && m_freeBlocks[sizeClass]) {
+        void* block = m_freeBlocks[sizeClass];
+        m_freeBlocks[sizeClass] = *static_cast<void**>(block);
+        return block;
+    }
+    return allocate(size, alignof(std::max_align_t));
+}
+
+void PDGArena::deallocateBlock(void* block, std::size_t size)
+{
+    unsigned sizeClass = 0;
+    while ((std::size_t(1) << sizeClass) < size) {
+        ++sizeClass;
+    }
+    assert((std::size_t(1) << sizeClass) == size);
+    if (m_freeBlocks.size() <= sizeClass) {
+        m_freeBlocks.resize(sizeClass + 1, nullptr);
+    }
+    *static_cast<void**>(block) = m_freeBlocks[sizeClass];
+    m_freeBlocks[sizeClass] = block;
+}
+
+void* PDGArena::allocate(std::size_t size, std::size_t alignment)
+{
+    auto alignedPosition = [alignment] (char* ptr) {
+        auto address = reinterpret_cast<std::uintptr_t>(ptr);
+        return reinterpret_cast<char*>((address + alignment - 1) & ~(alignment - 1));
+    };
+    char* position = m_current ? alignedPosition(m_current) : nullptr;
+    if (!position || position + size > m_end) {
+        // objects bigger than the chunk size get a dedicated chunk
+        const std::size_t chunkSize = std::max(m_chunkSize, size + alignment);
+        m_chunks.push_back(Chunk{std::unique_ptr<char[]>(new char[chunkSize]), chunkSize});
+        m_current = m_chunks.back().memory.get();
+        m_end = m_current + chunkSize;
+        position = alignedPosition(m_current);
+    }
+    m_current = position + size;
+    m_allocatedSize += size;
+    return position;
+}
+
+} // namespace pdg
+
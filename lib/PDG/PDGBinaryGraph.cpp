@@ -0,0 +1,181 @@
+#include "PDG/PDGBinaryGraph.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace pdg {
+
+PDGBinaryGraph::PDGBinaryGraph()
+    : m_mapping(nullptr)
+    , m_mappingSize(0)
+    , m_header(nullptr)
+    , m_nodeKinds(nullptr)
+    , m_nodeLabels(nullptr)
+    , m_nodeFunctions(nullptr)
+    , m_functionNames(nullptr)
+    , m_outOffsets(nullptr)
+    , m_outTargets(nullptr)
+    , m_outKinds(nullptr)
+    , m_inOffsets(nullptr)
+    , m_inSources(nullptr)
+    , m_inKinds(nullptr)
+    , m_strings(nullptr)
+{
+}
+
+PDGBinaryGraph::~PDGBinaryGraph()
+{
+    close();
+}
+
+bool PDGBinaryGraph::open(const std::string& path)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return fail("can not open " + path + ": " + std::strerror(errno));
+    }
+    struct stat st;
+    if (::fstat(fd, &st) == -1) {
+        ::close(fd);
+        return fail("can not stat " + path + ": " + std::strerror(errno));
+    }
+    if (static_cast<uint64_t>(st.st_size) < sizeof(PDGBinaryHeader)) {
+        ::close(fd);
+        return fail(path + " is too small to be a PDG file");
+    }
+    m_mappingSize = st.st_size;
+    void* mapping = ::mmap(nullptr, m_mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    // mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        m_mappingSize = 0;
+        return fail("can not map " + path + ": " + std::strerror(errno));
+    }
+    m_mapping = mapping;
+    m_header = static_cast<const PDGBinaryHeader*>(m_mapping);
+    if (!mapSections()) {
+        const std::string error = m_error;
+        close();
+        m_error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+void PDGBinaryGraph::close()
+{
+    if (m_mapping) {
+        ::munmap(m_mapping, m_mappingSize);
+    }
+    m_mapping = nullptr;
+    m_mappingSize = 0;
+    m_header = nullptr;
+    m_error.clear();
+}
+
+uint32_t PDGBinaryGraph::findFunction(const std::string& name) const
+{
+    for (uint32_t i = 0; i < functionsSize(); ++i) {
+        if (name == getFunctionName(i)) {
+            return i;
+        }
+    }
+    return InvalidIndex;
+}
+
+PDGBinaryGraph::NodeIds PDGBinaryGraph::forwardSlice(NodeId from, EdgeKinds kinds) const
+{
+    return slice(from, kinds, true);
+}
+
+PDGBinaryGraph::NodeIds PDGBinaryGraph::backwardSlice(NodeId from, EdgeKinds kinds) const
+{
+    return slice(from, kinds, false);
+}
+
+bool PDGBinaryGraph::fail(const std::string& error)
+{
+    m_error = error;
+    return false;
+}
+
+bool PDGBinaryGraph::mapSections()
+{
+    if (!m_header->hasValidMagic()) {
+        return fail("not a PDG file");
+    }
+    if (m_header->byteOrderMark != PDGBinaryHeader::ByteOrderMark) {
+        return fail("file was written on a machine with different byte order");
+    }
+    if (m_header->version != PDGBinaryHeader::CurrentVersion) {
+        return fail("unsupported format version " + std::to_string(m_header->version));
+    }
+    if (m_header->fileSize != m_mappingSize) {
+        return fail("file is truncated");
+    }
+    const uint64_t nodesNum = m_header->nodesNum;
+    const uint64_t edgesNum = m_header->edgesNum;
+    if (!getSection(PDGBinaryHeader::NodeKinds, nodesNum, m_nodeKinds)
+            || !getSection(PDGBinaryHeader::NodeLabels, nodesNum, m_nodeLabels)
+            || !getSection(PDGBinaryHeader::NodeFunctions, nodesNum, m_nodeFunctions)
+            || !getSection(PDGBinaryHeader::FunctionNames, m_header->functionsNum, m_functionNames)
+            || !getSection(PDGBinaryHeader::OutOffsets, nodesNum + 1, m_outOffsets)
+            || !getSection(PDGBinaryHeader::OutTargets, edgesNum, m_outTargets)
+            || !getSection(PDGBinaryHeader::OutKinds, edgesNum, m_outKinds)
+            || !getSection(PDGBinaryHeader::InOffsets, nodesNum + 1, m_inOffsets)
+            || !getSection(PDGBinaryHeader::InSources, edgesNum, m_inSources)
+            || !getSection(PDGBinaryHeader::InKinds, edgesNum, m_inKinds)
+            || !getSection(PDGBinaryHeader::Strings, m_header->stringsSize, m_strings)) {
+        return fail("section is out of file bounds");
+    }
+    if (m_outOffsets[nodesNum] != edgesNum || m_inOffsets[nodesNum] != edgesNum) {
+        return fail("edge offsets do not match edges number");
+    }
+    if (m_header->stringsSize == 0 || m_strings[m_header->stringsSize - 1] != '\0') {
+        return fail("string table is not terminated");
+    }
+    return true;
+}
+
+template <typename T>
+bool PDGBinaryGraph::getSection(PDGBinaryHeader::Section section, uint64_t size, const T*& data)
+{
+    const uint64_t offset = m_header->sectionOffsets[section];
+    if (offset % alignof(T) != 0
+            || offset > m_mappingSize
+            || size > (m_mappingSize - offset) / sizeof(T)) {
+        return false;
+    }
+    data = reinterpret_cast<const T*>(static_cast<const char*>(m_mapping) + offset);
+    return true;
+}
+
+PDGBinaryGraph::NodeIds PDGBinaryGraph::slice(NodeId from, EdgeKinds kinds, bool forward) const
+{
+    NodeIds result;
+    std::vector<bool> visited(size(), false);
+    visited[from] = true;
+    result.push_back(from);
+    // result doubles as BFS queue
+    for (unsigned i = 0; i < result.size(); ++i) {
+        const auto adjacency = forward ? getSuccessors(result[i]) : getPredecessors(result[i]);
+        for (unsigned e = 0; e < adjacency.size; ++e) {
+            const NodeId next = adjacency.nodes[e];
+            if (!(adjacency.kinds[e] & kinds) || visited[next]) {
+                continue;
+            }
+            visited[next] = true;
+            result.push_back(next);
+        }
+    }
+    return result;
+}
+
+} // namespace pdg
+
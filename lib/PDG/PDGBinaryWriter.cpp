@@ -0,0 +1,171 @@
+#include "PDG/PDGBinaryWriter.h"
+
+#include "PDG/PDG/PDG.h"
+#include "PDG/PDGBinaryFormat.h"
+
+#include "llvm/IR/Function.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cassert>
+#include <unordered_map>
+#include <vector>
+
+namespace pdg {
+
+namespace {
+
+/// Strings are deduplicated, labels of module level nodes and function names repeat a lot
+class StringTable
+{
+public:
+    uint32_t add(const std::string& str)
+    {
+        auto res = m_offsets.insert(std::make_pair(str, m_data.size()));
+        if (res.second) {
+            m_data.insert(m_data.end(), str.begin(), str.end());
+            m_data.push_back('\0');
+        }
+        return res.first->second;
+    }
+
+    const std::vector<char>& getData() const
+    {
+        return m_data;
+    }
+
+private:
+    std::unordered_map<std::string, uint32_t> m_offsets;
+    std::vector<char> m_data;
+}; // class StringTable
+
+uint64_t alignedOffset(uint64_t offset)
+{
+    return (offset + 7) & ~uint64_t(7);
+}
+
+} // unnamed namespace
+
+PDGBinaryWriter::PDGBinaryWriter(const PDG& pdg)
+    : m_pdg(pdg)
+{
+}
+
+bool PDGBinaryWriter::write(const std::string& path)
+{
+    assert(m_pdg.isFrozen());
+    const auto* graph = m_pdg.getCompactGraph();
+    const uint32_t nodesNum = graph->size();
+    // implicit block membership edges are written as ordinary control edges
+    const uint32_t edgesNum = graph->edgesSize() + graph->implicitEdgesSize();
+
+    StringTable strings;
+    std::unordered_map<llvm::Function*, uint32_t> functionIndices;
+    std::vector<uint32_t> functionNames;
+    std::vector<uint8_t> nodeKinds(nodesNum);
+    std::vector<uint32_t> nodeLabels(nodesNum);
+    std::vector<uint32_t> nodeFunctions(nodesNum, uint32_t(PDGBinaryHeader::InvalidIndex));
+    for (uint32_t id = 0; id < nodesNum; ++id) {
+        const auto* node = graph->getNode(id);
+        if (!node) {
+            // removed node keeps its id as an isolated node without label
+            nodeKinds[id] = PDGLLVMNode::UnknownNode;
+            nodeLabels[id] = strings.add("");
+            continue;
+        }
+        assert(node->getNodeType() <= UINT8_MAX);
+        nodeKinds[id] = node->getNodeType();
+        nodeLabels[id] = strings.add(node->getNodeAsString());
+        if (!node->hasParent()) {
+            continue;
+        }
+        auto* parent = node->getParent();
+        auto res = functionIndices.insert(std::make_pair(parent, functionNames.size()));
+        if (res.second) {
+            functionNames.push_back(strings.add(parent->getName().str()));
+        }
+        nodeFunctions[id] = res.first->second;
+    }
+
+    std::vector<uint32_t> outOffsets(1, 0);
+    std::vector<uint32_t> outTargets;
+    std::vector<uint8_t> outKinds;
+    std::vector<uint32_t> inOffsets(1, 0);
+    std::vector<uint32_t> inSources;
+    std::vector<uint8_t> inKinds;
+    outTargets.reserve(edgesNum);
+    outKinds.reserve(edgesNum);
+    inSources.reserve(edgesNum);
+    inKinds.reserve(edgesNum);
+    for (uint32_t id = 0; id < nodesNum; ++id) {
+        for (auto it = graph->succBegin(id); it != graph->succEnd(id); ++it) {
+            outTargets.push_back(it.getNodeId());
+            outKinds.push_back(it.getEdgeKind());
+        }
+        outOffsets.push_back(outTargets.size());
+        for (auto it = graph->predBegin(id); it != graph->predEnd(id); ++it) {
+            inSources.push_back(it.getNodeId());
+            inKinds.push_back(it.getEdgeKind());
+        }
+        inOffsets.push_back(inSources.size());
+    }
+
+    PDGBinaryHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, PDGBinaryHeader::getMagic(), PDGBinaryHeader::MagicSize);
+    header.version = PDGBinaryHeader::CurrentVersion;
+    header.byteOrderMark = PDGBinaryHeader::ByteOrderMark;
+    header.nodesNum = nodesNum;
+    header.edgesNum = edgesNum;
+    header.functionsNum = functionNames.size();
+    header.stringsSize = strings.getData().size();
+
+    struct SectionData
+    {
+        const void* data;
+        uint64_t size;
+    };
+    SectionData sections[PDGBinaryHeader::SectionsNum] = {
+        {nodeKinds.data(), nodeKinds.size() * sizeof(uint8_t)},
+        {nodeLabels.data(), nodeLabels.size() * sizeof(uint32_t)},
+        {nodeFunctions.data(), nodeFunctions.size() * sizeof(uint32_t)},
+        {functionNames.data(), functionNames.size() * sizeof(uint32_t)},
+        {outOffsets.data(), outOffsets.size() * sizeof(uint32_t)},
+        {outTargets.data(), outTargets.size() * sizeof(uint32_t)},
+        {outKinds.data(), outKinds.size() * sizeof(uint8_t)},
+        {inOffsets.data(), inOffsets.size() * sizeof(uint32_t)},
+        {inSources.data(), inSources.size() * sizeof(uint32_t)},
+        {inKinds.data(), inKinds.size() * sizeof(uint8_t)},
+        {strings.getData().data(), strings.getData().size()}
+    };
+    uint64_t offset = sizeof(PDGBinaryHeader);
+    for (unsigned i = 0; i < PDGBinaryHeader::SectionsNum; ++i) {
+        offset = alignedOffset(offset);
+        header.sectionOffsets[i] = offset;
+        offset += sections[i].size;
+    }
+    header.fileSize = offset;
+
+    std::error_code EC;
+    llvm::raw_fd_ostream os(path, EC, llvm::sys::fs::F_None);
+    if (EC) {
+        return false;
+    }
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    static const char padding[8] = {};
+    offset = sizeof(PDGBinaryHeader);
+    for (unsigned i = 0; i < PDGBinaryHeader::SectionsNum; ++i) {
+        os.write(padding, header.sectionOffsets[i] - offset);
+        os.write(static_cast<const char*>(sections[i].data), sections[i].size);
+        offset = header.sectionOffsets[i] + sections[i].size;
+    }
+    os.close();
+    if (os.has_error()) {
+        os.clear_error();
+        return false;
+    }
+    return true;
+}
+
+} // namespace pdg
+
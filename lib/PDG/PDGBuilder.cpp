@@ -1,25 +1,95 @@
 #include "PDG/PDGBuilder.h"
 
 #include "PDG/PDG.h"
+#include "PDG/PDGArena.h"
 #include "PDG/FunctionPDG.h"
 #include "PDG/PDGEdge.h"
 #include "PDG/DefUseResults.h"
 #include "PDG/DominanceResults.h"
 #include "PDG/IndirectCallSiteResults.h"
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/Analysis/MemorySSA.h"
+#include "llvm/Analysis/PostDominators.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Regex.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <thread>
+
+#define DEBUG_TYPE "pdg-builder"
+
 namespace pdg {
 
+namespace {
+
+using ValueNumbers = llvm::DenseMap<const llvm::Value*, unsigned>;
+
+/// Hash of an operand which is the same for equal copies of a function body: arguments, blocks
+/// and instructions of the function by their numbers, globals by name, constants by contents
+llvm::hash_code hashOperand(const llvm::Value* value, const ValueNumbers& numbers)
+{
+    auto pos = numbers.find(value);
+    if (pos != numbers.end()) {
+        return llvm::hash_value(pos->second);
+    }
+    llvm::hash_code hash = llvm::hash_combine(value->getValueID(), value->getType());
+    if (auto* global = llvm::dyn_cast<llvm::GlobalValue>(value)) {
+        return llvm::hash_combine(hash, global->getName());
+    }
+    if (auto* constInt = llvm::dyn_cast<llvm::ConstantInt>(value)) {
+        return llvm::hash_combine(hash, constInt->getValue());
+    }
+    if (auto* constFP = llvm::dyn_cast<llvm::ConstantFP>(value)) {
+        return llvm::hash_combine(hash, constFP->getValueAPF());
+    }
+    if (auto* data = llvm::dyn_cast<llvm::ConstantDataSequential>(value)) {
+        return llvm::hash_combine(hash, data->getRawDataValues());
+    }
+    if (auto* inlineAsm = llvm::dyn_cast<llvm::InlineAsm>(value)) {
+        return llvm::hash_combine(hash, inlineAsm->getAsmString(), inlineAsm->getConstraintString());
+    }
+    if (auto* expr = llvm::dyn_cast<llvm::ConstantExpr>(value)) {
+        hash = llvm::hash_combine(hash, expr->getOpcode());
+    }
+    // aggregates and expressions, null and undef values have no operands
+    if (auto* constant = llvm::dyn_cast<llvm::Constant>(value)) {
+        for (auto& op : constant->operands()) {
+            hash = llvm::hash_combine(hash, hashOperand(op.get(), numbers));
+        }
+    }
+    return hash;
+}
+
+} // unnamed namespace
+
+struct PDGBuilder::FunctionLinkInfo
+{
+    FunctionPDGTy functionPDG;
+    CallSiteStubs callSites;
+    MemoryUses memoryUses;
+    // edges with ends shared between functions, in provisional ids
+    std::vector<PDGEdge> deferredEdges;
+    unsigned edgesNum = 0;
+    unsigned duplicateEdgesNum = 0;
+};
+
 PDGBuilder::PDGBuilder(llvm::Module* M)
     : m_module(M)
+    , m_threadsNum(1)
+    , m_linkInfo(nullptr)
+    , m_sharedNodesNum(0)
 {
 }
 
@@ -38,14 +108,167 @@ void PDGBuilder::setDominanceResults(DominanceResultsTy domResults)
     m_domResults = domResults;
 }
 
+void PDGBuilder::setThreadsNum(unsigned threadsNum)
+{
+    m_threadsNum = std::max(threadsNum, 1u);
+}
+
+void PDGBuilder::setLinkResults(LinkResultsTy linkResults)
+{
+    m_linkResults = linkResults;
+}
+
+void PDGBuilder::setFunctionMaterializer(const FunctionMaterializer& materializer)
+{
+    m_materializer = materializer;
+}
+
+void PDGBuilder::setRoots(const FunctionSet& roots)
+{
+    m_roots = roots;
+}
+
+bool PDGBuilder::findFunctions(llvm::Module* M,
+                               const std::vector<std::string>& patterns,
+                               FunctionSet& functions,
+                               std::string& error)
+{
+    std::vector<llvm::Regex> regexes;
+    for (const auto& pattern : patterns) {
+        regexes.emplace_back("^(" + pattern + ")$");
+        std::string regexError;
+        if (!regexes.back().isValid(regexError)) {
+            error = "invalid pattern '" + pattern + "': " + regexError;
+            return false;
+        }
+    }
+    for (auto& F : *M) {
+        const std::string name = F.getName().str();
+        for (unsigned i = 0; i < patterns.size(); ++i) {
+            if (name == patterns[i] || regexes[i].match(name)) {
+                functions.insert(&F);
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+bool PDGBuilder::isInBuildScope(llvm::Function* F) const
+{
+    return m_roots.empty() || m_reachableFunctions.find(F) != m_reachableFunctions.end();
+}
+
+uint64_t PDGBuilder::computeFingerprint(llvm::Function* F)
+{
+    ValueNumbers numbers;
+    unsigned number = 0;
+    for (auto& arg : F->args()) {
+        numbers[&arg] = number++;
+    }
+    for (auto& B : *F) {
+        numbers[&B] = number++;
+        for (auto& I : B) {
+            numbers[&I] = number++;
+        }
+    }
+    // types are uniqued in the context and live as long as it, their identities are stable
+    llvm::hash_code hash = llvm::hash_value(F->getFunctionType());
+    for (auto& B : *F) {
+        hash = llvm::hash_combine(hash, B.size());
+        for (auto& I : B) {
+            hash = llvm::hash_combine(hash, I.getOpcode(), I.getType(), I.getNumOperands());
+            if (auto* cmp = llvm::dyn_cast<llvm::CmpInst>(&I)) {
+                hash = llvm::hash_combine(hash, unsigned(cmp->getPredicate()));
+            } else if (auto* alloca = llvm::dyn_cast<llvm::AllocaInst>(&I)) {
+                hash = llvm::hash_combine(hash, alloca->getAllocatedType());
+            } else if (auto* gep = llvm::dyn_cast<llvm::GetElementPtrInst>(&I)) {
+                hash = llvm::hash_combine(hash, gep->getSourceElementType());
+            } else if (auto* phi = llvm::dyn_cast<llvm::PHINode>(&I)) {
+                // incoming blocks are not operands
+                for (auto* block : phi->blocks()) {
+                    hash = llvm::hash_combine(hash, numbers.lookup(block));
+                }
+            }
+            for (auto& op : I.operands()) {
+                hash = llvm::hash_combine(hash, hashOperand(op.get(), numbers));
+            }
+        }
+    }
+    const uint64_t fingerprint = static_cast<size_t>(hash);
+    return fingerprint == FunctionPDG::NoFingerprint ? 1 : fingerprint;
+}
+
+uint64_t PDGBuilder::computeLayout(llvm::Function* F)
+{
+    llvm::hash_code hash = llvm::hash_value(F->size());
+    for (auto& B : *F) {
+        hash = llvm::hash_combine(hash, &B);
+        for (auto& I : B) {
+            hash = llvm::hash_combine(hash, &I);
+        }
+    }
+    const uint64_t layout = static_cast<size_t>(hash);
+    return layout == FunctionPDG::NoFingerprint ? 1 : layout;
+}
+
+void PDGBuilder::computeReachableFunctions()
+{
+    m_reachableFunctions.clear();
+    if (m_roots.empty()) {
+        return;
+    }
+    assert(m_indCSResults);
+    std::vector<llvm::Function*> worklist(m_roots.begin(), m_roots.end());
+    m_reachableFunctions.insert(m_roots.begin(), m_roots.end());
+    while (!worklist.empty()) {
+        llvm::Function* F = worklist.back();
+        worklist.pop_back();
+        if (F->isDeclaration() || !materialize(F)) {
+            continue;
+        }
+        for (auto& I : llvm::instructions(*F)) {
+            llvm::CallSite callSite(&I);
+            if (!callSite) {
+                continue;
+            }
+            FunctionSet callees;
+            if (m_indCSResults->hasIndCSCallees(callSite)) {
+                callees = m_indCSResults->getIndCSCallees(callSite);
+            } else if (auto* calledF = callSite.getCalledFunction()) {
+                callees.insert(calledF);
+            }
+            for (auto* callee : callees) {
+                if (m_reachableFunctions.insert(callee).second) {
+                    worklist.push_back(callee);
+                }
+            }
+        }
+    }
+}
+
 void PDGBuilder::build()
 {
+    buildIntraprocedural();
+    connectMemoryDefUses();
+    link();
+}
+
+void PDGBuilder::buildIntraprocedural()
+{
+    m_callSiteStubs.clear();
+    m_memoryUses.clear();
+    if (m_threadsNum > 1) {
+        buildParallel();
+        return;
+    }
+    computeReachableFunctions();
     m_pdg.reset(new PDG(m_module));
     visitGlobals();
 
     for (auto& F : *m_module) {
         m_pdg->addFunctionNode(&F);
-        if (F.isDeclaration()) {
+        if (F.isDeclaration() || !isInBuildScope(&F) || !materialize(&F)) {
             buildFunctionDefinition(&F);
             continue;
         }
@@ -54,6 +277,360 @@ void PDGBuilder::build()
     }
 }
 
+void PDGBuilder::buildLazily()
+{
+    m_callSiteStubs.clear();
+    m_memoryUses.clear();
+    computeReachableFunctions();
+    m_pdg.reset(new PDG(m_module));
+    visitGlobals();
+    for (auto& F : *m_module) {
+        m_pdg->addFunctionNode(&F);
+        if (F.isDeclaration() || !isInBuildScope(&F)) {
+            buildFunctionDefinition(&F);
+        } else {
+            m_pdg->addPendingFunction(&F);
+        }
+    }
+    if (!m_linkResults) {
+        m_linkResults = std::make_shared<LinkResults>();
+    }
+
+    // the graph owns the context building its functions, which refers back to it without owning
+    std::shared_ptr<PDGBuilder> lazyBuilder(new PDGBuilder(m_module));
+    lazyBuilder->m_pdg = PDGType(PDGType(), m_pdg.get());
+    lazyBuilder->m_defUse = m_defUse;
+    lazyBuilder->m_indCSResults = m_indCSResults;
+    lazyBuilder->m_domResults = m_domResults;
+    lazyBuilder->m_linkResults = m_linkResults;
+    lazyBuilder->m_materializer = m_materializer;
+    lazyBuilder->m_materializedFunctions = m_materializedFunctions;
+    lazyBuilder->m_unmaterializedFunctions = m_unmaterializedFunctions;
+    m_pdg->setFunctionPDGBuilder([lazyBuilder] (llvm::Function* F) {
+        lazyBuilder->buildFunctionLazily(F);
+    });
+}
+
+void PDGBuilder::buildStreaming(const FunctionPDGSink& sink)
+{
+    m_callSiteStubs.clear();
+    m_memoryUses.clear();
+    computeReachableFunctions();
+    m_pdg.reset(new PDG(m_module));
+    visitGlobals();
+
+    const bool keepLinkResults = m_linkResults != nullptr;
+    // def sites found for a later function may be in any earlier one, e.g. through SVFG, and would be
+    // created again in a released body without its edges. Functions are kept until all are built then
+    const bool deferRelease = m_defUse && m_defUse->hasInterproceduralDefSites();
+    std::vector<FunctionPDGTy> builtFunctions;
+    for (auto& F : *m_module) {
+        m_pdg->addFunctionNode(&F);
+        if (F.isDeclaration() || !isInBuildScope(&F) || !materialize(&F)) {
+            // linking an earlier caller may have created it already
+            getFunctionDefinition(&F);
+            continue;
+        }
+        buildFunctionPDG(&F);
+        auto functionPDG = m_currentFPDG;
+        m_currentFPDG.reset();
+        connectMemoryDefUses();
+        link();
+        if (!keepLinkResults) {
+            m_linkResults.reset();
+        }
+        if (deferRelease) {
+            builtFunctions.push_back(functionPDG);
+            continue;
+        }
+        sink(*functionPDG);
+        functionPDG->releaseBody();
+    }
+    for (auto& functionPDG : builtFunctions) {
+        sink(*functionPDG);
+    }
+    for (auto& functionPDG : builtFunctions) {
+        functionPDG->releaseBody();
+    }
+}
+
+PDGBuilder::UpdateResults PDGBuilder::update(PDGType pdg)
+{
+    assert(pdg && m_linkResults && m_defUse);
+    // def sites in other functions would need their uses in unchanged functions connected again
+    assert(!m_defUse->hasInterproceduralDefSites());
+    m_pdg = pdg;
+    m_callSiteStubs.clear();
+    m_memoryUses.clear();
+    // analyses of functions built earlier are up to date, only changed ones are materialized again
+    for (auto& F : *m_module) {
+        auto functionPDG = m_pdg->findFunctionPDG(&F);
+        if (functionPDG && functionPDG->getBodyFingerprint() != FunctionPDG::NoFingerprint) {
+            m_materializedFunctions.insert(&F);
+        }
+    }
+    computeReachableFunctions();
+
+    UpdateResults results;
+    std::vector<llvm::Function*> functions;
+    for (auto& F : *m_module) {
+        // bodies never loaded have not changed, pending functions are built from the current body anyway
+        if (F.isMaterializable() || m_pdg->isPendingFunction(&F)) {
+            continue;
+        }
+        const bool hasBody = !F.isDeclaration() && isInBuildScope(&F);
+        auto functionPDG = m_pdg->findFunctionPDG(&F);
+        if (!functionPDG) {
+            m_pdg->addFunctionNode(&F);
+            if (!hasBody) {
+                buildFunctionDefinition(&F);
+                continue;
+            }
+        }
+        const uint64_t fingerprint = functionPDG ? functionPDG->getBodyFingerprint() : FunctionPDG::NoFingerprint;
+        if (fingerprint == FunctionPDG::NoFingerprint) {
+            if (hasBody) {
+                results.addedFunctions.push_back(&F);
+                functions.push_back(&F);
+            }
+            continue;
+        }
+        if (hasBody && computeFingerprint(&F) == fingerprint
+                && computeLayout(&F) == functionPDG->getBodyLayout()) {
+            results.reusedFunctions.push_back(&F);
+            continue;
+        }
+        releaseFunctionBody(*functionPDG);
+        m_defUse->invalidate(&F);
+        m_materializedFunctions.erase(&F);
+        m_unmaterializedFunctions.erase(&F);
+        results.rebuiltFunctions.push_back(&F);
+        if (hasBody) {
+            functions.push_back(&F);
+        }
+    }
+    // instructions of released bodies may have been deleted and their addresses taken by new call sites,
+    // which must not find their results
+    std::unordered_set<llvm::Instruction*> reusedInstructions;
+    for (auto* F : results.reusedFunctions) {
+        for (auto& I : llvm::instructions(*F)) {
+            reusedInstructions.insert(&I);
+        }
+    }
+    for (auto it = m_linkResults->begin(); it != m_linkResults->end(); ) {
+        if (reusedInstructions.find(it->first) == reusedInstructions.end()) {
+            it = m_linkResults->erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (auto* F : functions) {
+        // snapshots of dominance, if kept, are of the old body
+        m_domResults->invalidate(F);
+        if (!materialize(F)) {
+            getFunctionDefinition(F);
+            continue;
+        }
+        buildFunctionPDG(F);
+        m_currentFPDG.reset();
+    }
+    connectMemoryDefUses();
+    link();
+    if (m_pdg->isFrozen()) {
+        m_pdg->freeze();
+    }
+    return results;
+}
+
+void PDGBuilder::releaseFunctionBody(FunctionPDG& functionPDG)
+{
+    // instructions of the old body may have been deleted, they are used as keys only
+    std::unordered_set<llvm::Value*> instructions;
+    for (auto it = functionPDG.nodesBegin(); it != functionPDG.nodesEnd(); ++it) {
+        if (auto* instrNode = llvm::dyn_cast<PDGLLVMInstructionNode>(*it)) {
+            instructions.insert(instrNode->getNodeValue());
+        }
+    }
+    FunctionSet callees;
+    for (auto* instr : instructions) {
+        auto pos = m_linkResults->find(static_cast<llvm::Instruction*>(instr));
+        if (pos == m_linkResults->end()) {
+            continue;
+        }
+        callees.insert(pos->second.callees.begin(), pos->second.callees.end());
+        m_linkResults->erase(pos);
+    }
+    for (auto* callee : callees) {
+        if (auto calleePDG = m_pdg->findFunctionPDG(callee)) {
+            calleePDG->removeCallSites(instructions);
+        }
+    }
+    functionPDG.releaseBody();
+}
+
+void PDGBuilder::buildFunctionLazily(llvm::Function* F)
+{
+    if (!materialize(F)) {
+        getFunctionDefinition(F);
+        return;
+    }
+    buildFunctionPDG(F);
+    m_currentFPDG.reset();
+    connectMemoryDefUses();
+    link();
+}
+
+void PDGBuilder::buildParallel()
+{
+    computeReachableFunctions();
+    m_pdg.reset(new PDG(m_module));
+    prepareModuleNodes();
+
+    FunctionLinkInfos linkInfos;
+    std::vector<llvm::Function*> functions;
+    for (auto& F : *m_module) {
+        if (F.isDeclaration() || !isInBuildScope(&F) || !materialize(&F)) {
+            continue;
+        }
+        functions.push_back(&F);
+        linkInfos.emplace_back();
+        linkInfos.back().functionPDG = m_pdg->getFunctionPDG(&F);
+        linkInfos.back().functionPDG->detach(m_sharedNodesNum);
+    }
+
+    std::atomic<unsigned> nextFunction(0);
+    auto worker = [&] () {
+        // worker context: shares the graph, has its own current function state.
+        // Dominance results are not shared, workers compute control dependencies themselves
+        PDGBuilder workerBuilder(m_module);
+        workerBuilder.m_pdg = m_pdg;
+        workerBuilder.m_sharedNodesNum = m_sharedNodesNum;
+        for (unsigned i = nextFunction++; i < functions.size(); i = nextFunction++) {
+            workerBuilder.m_linkInfo = &linkInfos[i];
+            workerBuilder.buildFunctionPDG(functions[i]);
+            workerBuilder.m_currentFPDG.reset();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < m_threadsNum; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    attachFunctions(linkInfos);
+}
+
+void PDGBuilder::prepareModuleNodes()
+{
+    // create all nodes shared between functions upfront, so workers only read them.
+    // Constants are not shared, each function creates its own
+    visitGlobals();
+    for (auto& F : *m_module) {
+        m_pdg->addFunctionNode(&F);
+    }
+    for (auto& F : *m_module) {
+        if (F.isDeclaration() || !isInBuildScope(&F) || !materialize(&F)) {
+            buildFunctionDefinition(&F);
+        } else {
+            m_pdg->addFunctionPDG(&F, FunctionPDGTy(new FunctionPDG(m_pdg.get(), &F)));
+        }
+    }
+    m_sharedNodesNum = m_pdg->size();
+}
+
+void PDGBuilder::attachFunctions(FunctionLinkInfos& linkInfos)
+{
+    // final ids are given in functions order, independent of threads scheduling
+    for (auto& linkInfo : linkInfos) {
+        linkInfo.functionPDG->attach();
+    }
+    for (auto& linkInfo : linkInfos) {
+        m_pdg->addEdgeStatistics(linkInfo.edgesNum, linkInfo.duplicateEdgesNum);
+        const auto& functionPDG = linkInfo.functionPDG;
+        for (const auto& edge : linkInfo.deferredEdges) {
+            addEdge(m_pdg->getNode(functionPDG->getAttachedId(edge.getSourceId())),
+                    m_pdg->getNode(functionPDG->getAttachedId(edge.getDestinationId())),
+                    edge.getKind());
+        }
+        resetEdgeKinds();
+        std::move(linkInfo.callSites.begin(), linkInfo.callSites.end(), std::back_inserter(m_callSiteStubs));
+        std::move(linkInfo.memoryUses.begin(), linkInfo.memoryUses.end(), std::back_inserter(m_memoryUses));
+    }
+}
+
+void PDGBuilder::connectMemoryDefUses()
+{
+    assert(m_pdg && m_defUse);
+    // uses of a function are consecutive, as functions were built
+    llvm::Function* previousFunction = nullptr;
+    for (const auto& memoryUse : m_memoryUses) {
+        if (memoryUse.function != previousFunction) {
+            if (previousFunction) {
+                m_defUse->finishFunction(previousFunction);
+                resetEdgeKinds();
+            }
+            m_defUse->prepareFunction(memoryUse.function);
+        }
+        previousFunction = memoryUse.function;
+        m_currentFPDG = m_pdg->findFunctionPDG(memoryUse.function);
+        connectToDefSite(memoryUse.value, memoryUse.node);
+    }
+    if (previousFunction) {
+        m_defUse->finishFunction(previousFunction);
+    }
+    resetEdgeKinds();
+    m_currentFPDG.reset();
+    MemoryUses().swap(m_memoryUses);
+}
+
+void PDGBuilder::link()
+{
+    assert(m_pdg);
+    resolveCallSites();
+    for (const auto& stub : m_callSiteStubs) {
+        // stubs of a caller are consecutive, as functions were built
+        if (m_currentFPDG && m_currentFPDG->getFunction() != stub.callSite.getCaller()) {
+            resetEdgeKinds();
+        }
+        m_currentFPDG = m_pdg->findFunctionPDG(stub.callSite.getCaller());
+        linkCallSite(stub, m_linkResults->find(stub.callSite.getInstruction())->second);
+    }
+    resetEdgeKinds();
+    m_currentFPDG.reset();
+    CallSiteStubs().swap(m_callSiteStubs);
+}
+
+void PDGBuilder::resolveCallSites()
+{
+    if (!m_linkResults) {
+        m_linkResults = std::make_shared<LinkResults>();
+    }
+    for (const auto& stub : m_callSiteStubs) {
+        auto res = m_linkResults->insert(std::make_pair(stub.callSite.getInstruction(), CallSiteCallees()));
+        if (!res.second) {
+            continue;
+        }
+        assert(m_indCSResults);
+        auto& callSiteCallees = res.first->second;
+        if (!m_indCSResults->hasIndCSCallees(stub.callSite)) {
+            if (auto* calledF = stub.callSite.getCalledFunction()) {
+                callSiteCallees.callees.insert(calledF);
+            }
+        } else {
+            callSiteCallees.callees = m_indCSResults->getIndCSCallees(stub.callSite);
+            callSiteCallees.isIndirectCall = true;
+        }
+    }
+}
+
+bool PDGBuilder::isSharedNode(PDGNodeTy node) const
+{
+    return node->getNodeId() < m_sharedNodesNum;
+}
+
 void PDGBuilder::visitGlobals()
 {
     for (auto glob_it = m_module->global_begin();
@@ -65,26 +642,57 @@ void PDGBuilder::visitGlobals()
 
 void PDGBuilder::buildFunctionDefinition(llvm::Function* F)
 {
-    FunctionPDG* functionPDG = new FunctionPDG(F);
-    visitFormalArguments(functionPDG, F);
+    FunctionPDG* functionPDG = new FunctionPDG(m_pdg.get(), F);
     m_pdg->addFunctionPDG(F, FunctionPDGTy(functionPDG));
+    visitFormalArguments(functionPDG, F);
+}
+
+PDGBuilder::FunctionPDGTy PDGBuilder::getFunctionDefinition(llvm::Function* F)
+{
+    // body of a pending callee is not built, its formal arguments are enough to link call sites
+    if (!m_pdg->findFunctionPDG(F)) {
+        buildFunctionDefinition(F);
+    }
+    return m_pdg->findFunctionPDG(F);
+}
+
+bool PDGBuilder::materialize(llvm::Function* F)
+{
+    // reachability walk may have materialized the function already
+    if (m_materializer && m_materializedFunctions.insert(F).second && !m_materializer(F)) {
+        m_unmaterializedFunctions.insert(F);
+    }
+    return m_unmaterializedFunctions.find(F) == m_unmaterializedFunctions.end();
 }
 
 void PDGBuilder::buildFunctionPDG(llvm::Function* F)
 {
-    if (!m_pdg->hasFunctionPDG(F)) {
-        m_currentFPDG.reset(new FunctionPDG(F));
+    m_currentFPDG = m_pdg->findFunctionPDG(F);
+    if (!m_currentFPDG) {
+        m_currentFPDG.reset(new FunctionPDG(m_pdg.get(), F));
         m_pdg->addFunctionPDG(F, m_currentFPDG);
-    } else {
-        m_currentFPDG = m_pdg->getFunctionPDG(F);
     }
     if (!m_currentFPDG->isFunctionDefBuilt()) {
         visitFormalArguments(m_currentFPDG.get(), F);
     }
+    if (m_linkInfo) {
+        // dominance getters may query a pass manager, which is not thread safe.
+        // The tree is owned by the worker and dropped as soon as dependencies are known
+        llvm::PostDominatorTree postDomTree;
+        postDomTree.recalculate(*F);
+        m_controlDependencies.reset(new ControlDependencies(*F, postDomTree));
+    } else {
+        assert(m_domResults);
+        m_controlDependencies = m_domResults->getControlDependencies(F);
+    }
     for (auto& B : *F) {
         visitBlock(B);
         visitBlockInstructions(B);
     }
+    m_controlDependencies.reset();
+    resetEdgeKinds();
+    m_currentFPDG->setBodyFingerprint(computeFingerprint(F));
+    m_currentFPDG->setBodyLayout(computeLayout(F));
 }
 
 void PDGBuilder::visitFormalArguments(FunctionPDG* functionPDG, llvm::Function* F)
@@ -99,8 +707,7 @@ void PDGBuilder::visitFormalArguments(FunctionPDG* functionPDG, llvm::Function*
 
 void PDGBuilder::visitBlock(llvm::BasicBlock& B)
 {
-    m_currentFPDG->addNode(llvm::dyn_cast<llvm::Value>(&B),
-            PDGNodeTy(new PDGLLVMBasicBlockNode(&B)));
+    getNodeFor(&B);
 }
 
 void PDGBuilder::visitBlockInstructions(llvm::BasicBlock& B)
@@ -113,20 +720,26 @@ void PDGBuilder::visitBlockInstructions(llvm::BasicBlock& B)
 
 void PDGBuilder::addControlEdgesForBlock(llvm::BasicBlock& B)
 {
-    if (!m_currentFPDG->hasNode(&B)) {
-        return;
-    }
-    auto blockNode = m_currentFPDG->getNode(&B);
+    const auto& branches = m_controlDependencies->getControllingBranches(&B);
     // Don't add control edges if block is not control dependent on something
-    if (blockNode->getInEdges().empty()) {
+    if (branches.empty()) {
         return;
     }
+    auto blockNode = getNodeFor(&B);
+    llvm::cast<PDGLLVMBasicBlockNode>(blockNode)->setControlDependent(true);
+    // branches of blocks visited later, e.g. loop latches, get their nodes here
+    for (auto* branch : branches) {
+        addControlEdge(getInstructionNodeFor(branch), blockNode);
+    }
+    // block -> instruction control edges are implicit, instructions only refer to their block.
+    // Nodes created after this, e.g. definition sites of memory uses, get their block when created
     for (auto& I : B) {
-        if (!m_currentFPDG->hasNode(&I)) {
+        auto destNode = m_currentFPDG->findNode(&I);
+        if (!destNode) {
             continue;
         }
-        auto destNode = m_currentFPDG->getNode(&I);
-        addControlEdge(blockNode, destNode);
+        assert(!destNode->hasBlockNode() || destNode->getBlockNodeId() == blockNode->getNodeId());
+        destNode->setBlockNodeId(blockNode->getNodeId());
     }
 }
 
@@ -148,11 +761,10 @@ void PDGBuilder::visitLoadInst(llvm::LoadInst& I)
 {
     // TODO: output this for debug mode only
     //llvm::dbgs() << "Load Inst: " << I << "\n";
-    auto destNode = PDGNodeTy(new PDGLLVMInstructionNode(&I));
+    auto destNode = getInstructionNodeFor(&I);
     auto ptrOp = getNodeFor(I.getPointerOperand());
     addDataEdge(ptrOp, destNode);
-    m_currentFPDG->addNode(&I, destNode);
-    connectToDefSite(&I, destNode);
+    addMemoryUse(&I, destNode);
 }
 
 void PDGBuilder::visitStoreInst(llvm::StoreInst& I)
@@ -160,16 +772,14 @@ void PDGBuilder::visitStoreInst(llvm::StoreInst& I)
     // TODO: output this for debug mode only
     //llvm::dbgs() << "Store Inst: " << I << "\n";
     auto* valueOp = I.getValueOperand();
-    llvm::dbgs() << *valueOp << "\n";
     auto sourceNode = getNodeFor(valueOp);
     if (!sourceNode) {
         return;
     }
-    auto destNode = PDGNodeTy(new PDGLLVMInstructionNode(&I));
+    auto destNode = getInstructionNodeFor(&I);
     auto ptrOp = getNodeFor(I.getPointerOperand());
     addDataEdge(sourceNode, destNode);
     addDataEdge(ptrOp, destNode);
-    m_currentFPDG->addNode(&I, destNode);
 }
 
 void PDGBuilder::visitGetElementPtrInst(llvm::GetElementPtrInst& I)
@@ -239,14 +849,8 @@ void PDGBuilder::visitInvokeInst(llvm::InvokeInst& I)
 
 void PDGBuilder::visitTerminatorInst(llvm::Instruction& I)
 {
-    auto sourceNode = getInstructionNodeFor(&I);
-    for (unsigned i = 0; i < I.getNumSuccessors(); ++i) {
-        auto* block = I.getSuccessor(i);
-        if (!m_domResults->posdominates(block, I.getParent())) {
-            auto destNode = getNodeFor(block);
-            addControlEdge(sourceNode, destNode);
-        }
-    }
+    // control edges from the terminator are added with blocks depending on it, see addControlEdgesForBlock
+    getInstructionNodeFor(&I);
 }
 
 void PDGBuilder::visitReturnInst(llvm::ReturnInst& I)
@@ -260,7 +864,7 @@ void PDGBuilder::visitReturnInst(llvm::ReturnInst& I)
     }
     auto sourceNode = getInstructionNodeFor(&I);
     auto destNode = m_pdg->getFunctionNode(I.getFunction());
-    addDataEdge(sourceNode, destNode);
+    addEdge(sourceNode, destNode, PDGEdge::ParameterOutEdge);
     visitInstruction(I);
 }
 
@@ -275,61 +879,76 @@ void PDGBuilder::visitInstruction(llvm::Instruction& I)
 
 PDGBuilder::PDGNodeTy PDGBuilder::createInstructionNodeFor(llvm::Instruction* instr)
 {
-    return std::make_shared<PDGLLVMInstructionNode>(instr);
+    auto functionPDG = getOwnerFunctionPDG(instr->getFunction());
+    auto* node = functionPDG->getArena().create<PDGLLVMInstructionNode>(instr);
+    auto* blockNode = llvm::dyn_cast_or_null<PDGLLVMBasicBlockNode>(functionPDG->findNode(instr->getParent()));
+    if (blockNode && blockNode->isControlDependent()) {
+        node->setBlockNodeId(blockNode->getNodeId());
+    }
+    return node;
 }
 
 PDGBuilder::PDGNodeTy PDGBuilder::createBasicBlockNodeFor(llvm::BasicBlock* block)
 {
-    return std::make_shared<PDGLLVMBasicBlockNode>(block);
+    return m_currentFPDG->getArena().create<PDGLLVMBasicBlockNode>(block);
 }
 
 PDGBuilder::PDGNodeTy PDGBuilder::createGlobalNodeFor(llvm::GlobalVariable* global)
 {
-    return std::make_shared<PDGLLVMGlobalVariableNode>(global);
+    return m_pdg->getArena().create<PDGLLVMGlobalVariableNode>(global);
 }
 
 PDGBuilder::PDGNodeTy PDGBuilder::createFormalArgNodeFor(llvm::Argument* arg)
 {
-    return std::make_shared<PDGLLVMFormalArgumentNode>(arg);
+    return getInterfaceArenaFor(arg->getParent()).create<PDGLLVMFormalArgumentNode>(arg);
 }
 
 PDGBuilder::PDGNodeTy PDGBuilder::createNullNode()
 {
-    return std::make_shared<PDGNullNode>();
+    return m_currentFPDG->getArena().create<PDGNullNode>();
 }
 
 PDGBuilder::PDGNodeTy PDGBuilder::createConstantNodeFor(llvm::Constant* constant)
 {
-    return std::make_shared<PDGLLVMConstantNode>(constant);
+    return m_currentFPDG->getArena().create<PDGLLVMConstantNode>(constant);
 }
 
-void PDGBuilder::selfVisitCallSite(llvm::CallSite& callSite)
+PDGBuilder::PDGNodeTy PDGBuilder::createPhiNodeFor(const std::vector<llvm::Value*>& values,
+                                                   const std::vector<llvm::BasicBlock*>& blocks)
 {
-    auto destNode = getInstructionNodeFor(callSite.getInstruction());
-    bool isIndirectCall = false;
-    FunctionSet callees;
-    if (!m_indCSResults->hasIndCSCallees(callSite)) {
-        if (auto* calledF = callSite.getCalledFunction()) {
-            callees.insert(calledF);
-        }
-    } else {
-        callees = m_indCSResults->getIndCSCallees(callSite);
-        isIndirectCall = true;
+    assert(values.size() == blocks.size());
+    auto& arena = m_currentFPDG->getArena();
+    return arena.create<PDGPhiNode>(arena.copyArray(values.data(), values.size()),
+                                    arena.copyArray(blocks.data(), blocks.size()),
+                                    values.size());
+}
+
+PDGBuilder::FunctionPDGTy PDGBuilder::getOwnerFunctionPDG(llvm::Function* F)
+{
+    if (m_currentFPDG->getFunction() == F) {
+        return m_currentFPDG;
     }
-    for (auto callee : callees) {
-        if (!m_pdg->hasFunctionNode(callee)) {
-            m_pdg->addFunctionNode(callee);
-        }
-        if (isIndirectCall) {
-            auto calleeValueNode = getNodeFor(callSite.getCalledValue());
-            addDataEdge(calleeValueNode, destNode);
-        }
-        auto calleeNode = m_pdg->getFunctionNode(callee);
-        if (!callSite.getFunctionType()->isVoidTy()) {
-            addDataEdge(calleeNode, destNode);
-        }
-        addControlEdge(destNode, calleeNode);
+    // values of other functions, e.g. definition sites found by def-use analysis, belong to
+    // their function, which releases them with its body. Workers only build their own function
+    assert(!m_linkInfo);
+    return getFunctionDefinition(F);
+}
+
+PDGArena& PDGBuilder::getInterfaceArenaFor(llvm::Function* F)
+{
+    if (m_currentFPDG && m_currentFPDG->getFunction() == F) {
+        return m_currentFPDG->getInterfaceArena();
     }
+    assert(m_pdg->findFunctionPDG(F));
+    return m_pdg->findFunctionPDG(F)->getInterfaceArena();
+}
+
+void PDGBuilder::selfVisitCallSite(llvm::CallSite& callSite)
+{
+    CallSiteStub stub;
+    stub.callSite = callSite;
+    stub.callNode = getInstructionNodeFor(callSite.getInstruction());
+    stub.actualArgNodes.resize(callSite.getNumArgOperands(), nullptr);
     for (unsigned i = 0; i < callSite.getNumArgOperands(); ++i) {
         if (auto* val = llvm::dyn_cast<llvm::Value>(callSite.getArgOperand(i))) {
             auto sourceNode = getNodeFor(val);
@@ -337,52 +956,104 @@ void PDGBuilder::selfVisitCallSite(llvm::CallSite& callSite)
                 continue;
             }
             if (val->getType()->isPointerTy()
-                    && !llvm::isa<PDGNullNode>(sourceNode.get())
+                    && !llvm::isa<PDGNullNode>(sourceNode)
                     && !llvm::isa<llvm::Function>(val)) {
                 //llvm::dbgs() << *val << "\n";
-                connectToDefSite(val, sourceNode);
+                addMemoryUse(val, sourceNode);
             }
-            auto actualArgNode = PDGNodeTy(new PDGLLVMActualArgumentNode(callSite, val, i));
-            addDataEdge(sourceNode, actualArgNode);
-            addDataEdge(actualArgNode, destNode);
+            auto actualArgNode = m_currentFPDG->getArena().create<PDGLLVMActualArgumentNode>(callSite, val, i);
             m_currentFPDG->addNode(actualArgNode);
-            // connect actual args with formal args
-            addActualArgumentNodeConnections(actualArgNode, i, callSite, callees);
+            addDataEdge(sourceNode, actualArgNode);
+            addDataEdge(actualArgNode, stub.callNode);
+            stub.actualArgNodes[i] = actualArgNode;
         }
     }
-    for (auto& F : callees) {
-        if (!m_pdg->hasFunctionPDG(F)) {
-            buildFunctionDefinition(F);
+    auto& callSiteStubs = m_linkInfo ? m_linkInfo->callSites : m_callSiteStubs;
+    callSiteStubs.push_back(std::move(stub));
+}
+
+void PDGBuilder::linkCallSite(const CallSiteStub& stub, const CallSiteCallees& callSiteCallees)
+{
+    const llvm::CallSite& callSite = stub.callSite;
+    auto destNode = stub.callNode;
+    const FunctionSet& callees = callSiteCallees.callees;
+    if (callSiteCallees.isIndirectCall && !callees.empty()) {
+        auto calleeValueNode = getNodeFor(callSite.getCalledValue());
+        addDataEdge(calleeValueNode, destNode);
+    }
+    for (auto callee : callees) {
+        m_pdg->addFunctionNode(callee);
+        auto calleeNode = m_pdg->getFunctionNode(callee);
+        if (!callSite.getFunctionType()->isVoidTy()) {
+            addEdge(calleeNode, destNode, PDGEdge::ParameterOutEdge);
+        }
+        addEdge(destNode, calleeNode, PDGEdge::CallEdge);
+    }
+    // connect actual args with formal args
+    for (unsigned i = 0; i < stub.actualArgNodes.size(); ++i) {
+        if (stub.actualArgNodes[i]) {
+            addActualArgumentNodeConnections(stub.actualArgNodes[i], i, callSite, callees);
         }
-        FunctionPDGTy calleePDG = m_pdg->getFunctionPDG(F);
+    }
+    for (auto& F : callees) {
+        FunctionPDGTy calleePDG = getFunctionDefinition(F);
         calleePDG->addCallSite(callSite);
     }
 }
 
 void PDGBuilder::addDataEdge(PDGNodeTy source, PDGNodeTy dest)
+{
+    addEdge(source, dest, PDGEdge::DataEdge);
+}
+
+void PDGBuilder::addControlEdge(PDGNodeTy source, PDGNodeTy dest)
+{
+    addEdge(source, dest, PDGEdge::ControlEdge);
+}
+
+void PDGBuilder::addEdge(PDGNodeTy source, PDGNodeTy dest, PDGEdge::Kind kind)
 {
     if (!source || !dest) {
         return;
     }
-    PDGNode::PDGEdgeType edge = PDGNode::PDGEdgeType(new PDGDataEdge(source, dest));
+    PDGEdge edge(source->getNodeId(), dest->getNodeId(), kind);
+    // edges are deduplicated within a function, parallel edges added by different stages
+    // are merged when the graph is frozen
+    if (!PDG::addEdgeKind(m_edgeKinds, edge.getSourceId(), edge.getDestinationId(), kind)) {
+        if (m_linkInfo) {
+            ++m_linkInfo->duplicateEdgesNum;
+        } else {
+            m_pdg->addEdgeStatistics(0, 1);
+        }
+        return;
+    }
+    if (m_linkInfo) {
+        // nodes shared between functions are modified in link step only
+        if (isSharedNode(source) || isSharedNode(dest)) {
+            m_linkInfo->deferredEdges.push_back(edge);
+            return;
+        }
+        ++m_linkInfo->edgesNum;
+    } else {
+        m_pdg->addEdgeStatistics(1, 0);
+    }
     source->addOutEdge(edge);
     dest->addInEdge(edge);
 }
 
-void PDGBuilder::addControlEdge(PDGNodeTy source, PDGNodeTy dest)
+void PDGBuilder::resetEdgeKinds()
 {
-    PDGNode::PDGEdgeType edge = PDGNode::PDGEdgeType(new PDGControlEdge(source, dest));
-    source->addOutEdge(edge);
-    dest->addInEdge(edge);
+    PDG::EdgeKindsMap().swap(m_edgeKinds);
 }
 
 PDGBuilder::PDGNodeTy PDGBuilder::getInstructionNodeFor(llvm::Instruction* instr)
 {
-    if (m_currentFPDG->hasNode(instr)) {
-        return m_currentFPDG->getNode(instr);
+    if (auto node = m_currentFPDG->findNode(instr)) {
+        return node;
     }
-    m_currentFPDG->addNode(instr, createInstructionNodeFor(instr));
-    return m_currentFPDG->getNode(instr);
+    auto node = createInstructionNodeFor(instr);
+    getOwnerFunctionPDG(instr->getFunction())->addNode(instr, node);
+    return node;
 }
 
 PDGBuilder::PDGNodeTy PDGBuilder::getNodeFor(llvm::Value* value)
@@ -391,68 +1062,73 @@ PDGBuilder::PDGNodeTy PDGBuilder::getNodeFor(llvm::Value* value)
     if (!value) {
         return nullptr;
     }
-    if (m_currentFPDG->hasNode(value)) {
-        return m_currentFPDG->getNode(value);
+    // globals, functions and values of the current function share one table,
+    // constants are looked up among nodes of the current function
+    if (auto node = m_currentFPDG->findNode(value)) {
+        return node;
     }
+    PDGNodeTy node = nullptr;
     if (auto* global = llvm::dyn_cast<llvm::GlobalVariable>(value)) {
-        if (!m_pdg->hasGlobalVariableNode(global)) {
-            m_pdg->addGlobalVariableNode(global, createGlobalNodeFor(global));
-        }
-        return m_pdg->getGlobalVariableNode(global);
-    }
-    if (auto* argument = llvm::dyn_cast<llvm::Argument>(value)) {
-        assert(m_currentFPDG->hasFormalArgNode(argument));
-        return m_currentFPDG->getFormalArgNode(argument);
-    }
-    if (auto* nullValue = llvm::dyn_cast<llvm::ConstantPointerNull>(value)) {
-        m_currentFPDG->addNode(value, createNullNode());
+        // workers find nodes of all globals created upfront
+        assert(!m_linkInfo);
+        node = createGlobalNodeFor(global);
+        m_pdg->addNode(global, node);
+    } else if (auto* argument = llvm::dyn_cast<llvm::Argument>(value)) {
+        auto functionPDG = getOwnerFunctionPDG(argument->getParent());
+        assert(functionPDG->hasFormalArgNode(argument));
+        return functionPDG->getFormalArgNode(argument);
+    } else if (auto* nullValue = llvm::dyn_cast<llvm::ConstantPointerNull>(value)) {
+        node = createNullNode();
+        m_currentFPDG->addConstantNode(nullValue, node);
     } else if (auto* function = llvm::dyn_cast<llvm::Function>(value)) {
-        if (!m_pdg->hasFunctionNode(function)) {
-            m_pdg->addFunctionNode(function);
-        }
+        // workers find nodes of all functions created upfront
+        assert(!m_linkInfo);
+        m_pdg->addFunctionNode(function);
         return m_pdg->getFunctionNode(function);
     } else if (auto* constant = llvm::dyn_cast<llvm::Constant>(value)) {
-        m_currentFPDG->addNode(value, createConstantNodeFor(constant));
+        node = createConstantNodeFor(constant);
+        m_currentFPDG->addConstantNode(constant, node);
     } else if (auto* instr = llvm::dyn_cast<llvm::Instruction>(value)) {
-        m_currentFPDG->addNode(value, createInstructionNodeFor(instr));
+        return getInstructionNodeFor(instr);
     } else {
         // do not assert here for now to keep track of possible values to be handled here
-        llvm::dbgs() << "Unhandled value " << *value << "\n";
-        return PDGNodeTy();
+        LLVM_DEBUG(llvm::dbgs() << "Unhandled value " << *value << "\n");
+        return nullptr;
     }
-    return m_currentFPDG->getNode(value);
+    return node;
 }
 
 PDGBuilder::PDGNodeTy PDGBuilder::getNodeFor(llvm::BasicBlock* block)
 {
-    if (!m_currentFPDG->hasNode(block)) {
-        m_currentFPDG->addNode(block, createBasicBlockNodeFor(block));
+    if (auto node = m_currentFPDG->findNode(block)) {
+        return node;
     }
-    return m_currentFPDG->getNode(block);
+    auto node = createBasicBlockNodeFor(block);
+    m_currentFPDG->addNode(block, node);
+    return node;
+}
+
+void PDGBuilder::addMemoryUse(llvm::Value* value, PDGNodeTy valueNode)
+{
+    auto& memoryUses = m_linkInfo ? m_linkInfo->memoryUses : m_memoryUses;
+    memoryUses.push_back(MemoryUse{m_currentFPDG->getFunction(), value, valueNode});
 }
 
 void PDGBuilder::connectToDefSite(llvm::Value* value, PDGNodeTy valueNode)
 {
     const auto& defSite = m_defUse->getDefNode(value);
-    auto* defInst = defSite.first;
-    auto sourceNode = defSite.second;
-    if (!defInst || !m_currentFPDG->hasNode(defInst)) {
-        if (sourceNode) {
-            if (defInst) {
-                m_currentFPDG->addNode(defInst, sourceNode);
-            } else {
-                addPhiNodeConnections(sourceNode);
-            }
+    auto* defInst = defSite.value;
+    PDGNodeTy sourceNode = defInst ? m_currentFPDG->findNode(defInst) : nullptr;
+    if (!sourceNode) {
+        if (auto* defInstr = llvm::dyn_cast_or_null<llvm::Instruction>(defInst)) {
+            sourceNode = getInstructionNodeFor(defInstr);
+        } else if (defSite.isPhi()) {
+            sourceNode = createPhiNodeFor(defSite.phiValues, defSite.phiBlocks);
+            addPhiNodeConnections(sourceNode);
         }
-    } else if (defInst) {
-        sourceNode = m_currentFPDG->getNode(defInst);
-    } else {
-        // Ideally this should not happen
-        llvm::dbgs() << "No definition found for value " << *value << "\n";
-        return;
     }
     if (sourceNode) {
-        addDataEdge(sourceNode, valueNode);
+        addEdge(sourceNode, valueNode, PDGEdge::MemoryEdge);
     }
 }
 
@@ -462,10 +1138,7 @@ void PDGBuilder::addActualArgumentNodeConnections(PDGNodeTy actualArgNode,
                                                   const FunctionSet& callees)
 {
     for (auto& F : callees) {
-        if (!m_pdg->hasFunctionPDG(F)) {
-            buildFunctionDefinition(F);
-        }
-        FunctionPDGTy calleePDG = m_pdg->getFunctionPDG(F);
+        FunctionPDGTy calleePDG = getFunctionDefinition(F);
         PDGNodeTy formalArgNode;
         if (F->getFunctionType()->getNumParams() <= argIdx) {
             if (!calleePDG->isVarArg()) {
@@ -483,14 +1156,14 @@ void PDGBuilder::addActualArgumentNodeConnections(PDGNodeTy actualArgNode,
             formalArgNode = calleePDG->getFormalArgNode(formalArg);
         }
         if (formalArgNode) {
-            addDataEdge(actualArgNode, formalArgNode);
+            addEdge(actualArgNode, formalArgNode, PDGEdge::ParameterInEdge);
         }
     }
 }
 
 void PDGBuilder::addPhiNodeConnections(PDGNodeTy node)
 {
-    PDGPhiNode* phiNode = llvm::dyn_cast<PDGPhiNode>(node.get());
+    PDGPhiNode* phiNode = llvm::dyn_cast<PDGPhiNode>(node);
     if (!phiNode) {
         return;
     }
@@ -502,7 +1175,7 @@ void PDGBuilder::addPhiNodeConnections(PDGNodeTy node)
             continue;
         }
         auto destNode = getNodeFor(value);
-        addDataEdge(destNode, node);
+        addEdge(destNode, node, PDGEdge::MemoryEdge);
     }
 }
 
@@ -0,0 +1,242 @@
+#include "PDG/PDGCompactGraph.h"
+
+#include "PDG/PDGNode.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace pdg {
+
+unsigned PDGCompactGraph::build(const Nodes& nodes)
+{
+    // nodes compacted before keep their edges, edges added to nodes since then are merged in.
+    // Removed nodes are null, edges compacted before that lead to them are dropped
+    m_stale = false;
+    const NodeId oldNodesNum = m_nodes.size();
+    assert(nodes.size() >= oldNodesNum);
+    m_nodes = nodes;
+    for (NodeId id = oldNodesNum; id < m_nodes.size(); ++id) {
+        auto* node = m_nodes[id];
+        if (!node) {
+            continue;
+        }
+        // node can not be a part of two compact graphs, nodes added to stale graph are set to it already
+        assert(!node->isFrozen() || node->getCompactGraph() == this);
+        assert(node->getNodeId() == id);
+        node->setCompactGraph(this);
+    }
+
+    const NodeId nodesNum = m_nodes.size();
+    auto isOldEdgeKept = [&] (unsigned i) {
+        return m_nodes[m_outTargets[i]] != nullptr;
+    };
+    auto oldOutDegree = [&] (NodeId id) {
+        if (id >= oldNodesNum || !m_nodes[id]) {
+            return 0u;
+        }
+        unsigned degree = 0;
+        for (unsigned i = m_outOffsets[id]; i < m_outOffsets[id + 1]; ++i) {
+            degree += isOldEdgeKept(i);
+        }
+        return degree;
+    };
+    auto newOutDegree = [&] (NodeId id) {
+        return m_nodes[id] ? m_nodes[id]->getOutEdges().size() : 0u;
+    };
+    NodeIds outOffsets(nodesNum + 1, 0);
+    for (NodeId id = 0; id < nodesNum; ++id) {
+        outOffsets[id + 1] = outOffsets[id] + oldOutDegree(id) + newOutDegree(id);
+    }
+    const unsigned collectedEdgesNum = outOffsets[nodesNum];
+    NodeIds outTargets(collectedEdgesNum);
+    std::vector<EdgeKinds> outKinds(collectedEdgesNum);
+    m_inOffsets.assign(nodesNum + 1, 0);
+
+    for (NodeId id = 0; id < nodesNum; ++id) {
+        if (!m_nodes[id]) {
+            continue;
+        }
+        unsigned pos = outOffsets[id];
+        if (id < oldNodesNum) {
+            for (unsigned i = m_outOffsets[id]; i < m_outOffsets[id + 1]; ++i) {
+                if (isOldEdgeKept(i)) {
+                    outTargets[pos] = m_outTargets[i];
+                    outKinds[pos] = m_outKinds[i];
+                    ++pos;
+                }
+            }
+        }
+        for (const auto& edge : m_nodes[id]->getOutEdges()) {
+            const NodeId dest = edge.getDestinationId();
+            assert(dest < nodesNum && m_nodes[dest]);
+            outTargets[pos] = dest;
+            outKinds[pos] = edge.getKind();
+            ++pos;
+        }
+    }
+    // builder deduplicates edges of one function only, the same edge may come from another build stage
+    // or from a function built after freezing. Edges are ordered by (target, kind) and merged in place
+    std::vector<uint64_t> sortedEdges;
+    unsigned edgesNum = 0;
+    for (NodeId id = 0; id < nodesNum; ++id) {
+        const unsigned begin = outOffsets[id];
+        const unsigned end = outOffsets[id + 1];
+        outOffsets[id] = edgesNum;
+        sortedEdges.clear();
+        for (unsigned i = begin; i < end; ++i) {
+            sortedEdges.push_back((static_cast<uint64_t>(outTargets[i]) << 8) | outKinds[i]);
+        }
+        std::sort(sortedEdges.begin(), sortedEdges.end());
+        auto sortedEnd = std::unique(sortedEdges.begin(), sortedEdges.end());
+        for (auto it = sortedEdges.begin(); it != sortedEnd; ++it, ++edgesNum) {
+            outTargets[edgesNum] = static_cast<NodeId>(*it >> 8);
+            outKinds[edgesNum] = static_cast<EdgeKinds>(*it & 0xff);
+        }
+    }
+    outOffsets[nodesNum] = edgesNum;
+    outTargets.resize(edgesNum);
+    outKinds.resize(edgesNum);
+    m_outOffsets.swap(outOffsets);
+    m_outTargets.swap(outTargets);
+    m_outKinds.swap(outKinds);
+
+    // in edges are transpose of out edges
+    for (unsigned i = 0; i < edgesNum; ++i) {
+        ++m_inOffsets[m_outTargets[i] + 1];
+    }
+    for (NodeId id = 0; id < nodesNum; ++id) {
+        m_inOffsets[id + 1] += m_inOffsets[id];
+    }
+    m_inSources.resize(edgesNum);
+    m_inKinds.resize(edgesNum);
+    NodeIds inPos(m_inOffsets.begin(), m_inOffsets.end() - 1);
+    for (NodeId id = 0; id < nodesNum; ++id) {
+        for (unsigned i = m_outOffsets[id]; i < m_outOffsets[id + 1]; ++i) {
+            const unsigned pos = inPos[m_outTargets[i]]++;
+            m_inSources[pos] = id;
+            m_inKinds[pos] = m_outKinds[i];
+        }
+    }
+
+    buildMembers();
+
+    for (auto* node : m_nodes) {
+        if (node) {
+            node->releaseEdges();
+        }
+    }
+    return collectedEdgesNum - edgesNum;
+}
+
+void PDGCompactGraph::markStale(const Nodes& addedNodes, const Rebuilder& rebuilder)
+{
+    for (auto* node : addedNodes) {
+        assert(!node->isFrozen());
+        node->setCompactGraph(this);
+    }
+    m_rebuilder = rebuilder;
+    m_stale = true;
+}
+
+void PDGCompactGraph::buildMembers()
+{
+    // (block, member) pairs, members of removed blocks are dropped
+    std::vector<std::pair<NodeId, NodeId>> memberships;
+    for (NodeId id = 0; id < m_nodes.size(); ++id) {
+        const auto* node = m_nodes[id];
+        if (!node || !node->hasBlockNode()) {
+            continue;
+        }
+        const NodeId block = node->getBlockNodeId();
+        assert(block < m_nodes.size());
+        if (m_nodes[block]) {
+            memberships.push_back(std::make_pair(block, id));
+        }
+    }
+    std::sort(memberships.begin(), memberships.end());
+
+    m_memberBlocks.clear();
+    m_memberOffsets.clear();
+    m_members.clear();
+    m_members.reserve(memberships.size());
+    for (const auto& membership : memberships) {
+        if (m_memberBlocks.empty() || m_memberBlocks.back() != membership.first) {
+            m_memberBlocks.push_back(membership.first);
+            m_memberOffsets.push_back(m_members.size());
+        }
+        m_members.push_back(membership.second);
+    }
+    m_memberOffsets.push_back(m_members.size());
+}
+
+PDGCompactGraph::IdRange PDGCompactGraph::getMembers(NodeId id) const
+{
+    auto pos = std::lower_bound(m_memberBlocks.begin(), m_memberBlocks.end(), id);
+    if (pos == m_memberBlocks.end() || *pos != id) {
+        return IdRange(nullptr, nullptr);
+    }
+    const unsigned index = pos - m_memberBlocks.begin();
+    return IdRange(m_members.data() + m_memberOffsets[index], m_members.data() + m_memberOffsets[index + 1]);
+}
+
+PDGCompactGraph::IdRange PDGCompactGraph::getBlock(NodeId id) const
+{
+    const auto* node = m_nodes[id];
+    if (!node || !node->hasBlockNode()) {
+        return IdRange(nullptr, nullptr);
+    }
+    // the block is referred to by its entry in the sorted blocks array.
+    // It is not there if the node got its block after the graph was built
+    auto pos = std::lower_bound(m_memberBlocks.begin(), m_memberBlocks.end(), node->getBlockNodeId());
+    if (pos == m_memberBlocks.end() || *pos != node->getBlockNodeId()) {
+        return IdRange(nullptr, nullptr);
+    }
+    return IdRange(&*pos, &*pos + 1);
+}
+
+bool PDGCompactGraph::hasNode(const PDGNode* node) const
+{
+    return node->getCompactGraph() == this;
+}
+
+PDGCompactGraph::NodeId PDGCompactGraph::getNodeId(const PDGNode* node) const
+{
+    assert(hasNode(node));
+    return node->getNodeId();
+}
+
+PDGCompactGraph::NodeIds PDGCompactGraph::forwardSlice(NodeId from, EdgeKinds kinds) const
+{
+    return slice(from, kinds, true);
+}
+
+PDGCompactGraph::NodeIds PDGCompactGraph::backwardSlice(NodeId from, EdgeKinds kinds) const
+{
+    return slice(from, kinds, false);
+}
+
+PDGCompactGraph::NodeIds PDGCompactGraph::slice(NodeId from, EdgeKinds kinds, bool forward) const
+{
+    assert(!m_stale);
+    NodeIds result;
+    std::vector<bool> visited(m_nodes.size(), false);
+    visited[from] = true;
+    result.push_back(from);
+    // result doubles as BFS queue
+    for (unsigned i = 0; i < result.size(); ++i) {
+        const NodeId id = result[i];
+        auto it = forward ? succBegin(id, kinds) : predBegin(id, kinds);
+        const auto end = forward ? succEnd(id, kinds) : predEnd(id, kinds);
+        for (; it != end; ++it) {
+            const NodeId next = it.getNodeId();
+            if (!visited[next]) {
+                visited[next] = true;
+                result.push_back(next);
+            }
+        }
+    }
+    return result;
+}
+
+} // namespace pdg
+
@@ -3,8 +3,24 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <type_traits>
+
 namespace pdg {
 
+// arenas do not record destructors of trivially destructible objects, teardown only frees chunks
+static_assert(std::is_trivially_destructible<PDGLLVMInstructionNode>::value
+              && std::is_trivially_destructible<PDGLLVMFormalArgumentNode>::value
+              && std::is_trivially_destructible<PDGLLVMVaArgNode>::value
+              && std::is_trivially_destructible<PDGLLVMActualArgumentNode>::value
+              && std::is_trivially_destructible<PDGLLVMGlobalVariableNode>::value
+              && std::is_trivially_destructible<PDGLLVMConstantExprNode>::value
+              && std::is_trivially_destructible<PDGLLVMConstantNode>::value
+              && std::is_trivially_destructible<PDGLLVMFunctionNode>::value
+              && std::is_trivially_destructible<PDGLLVMBasicBlockNode>::value
+              && std::is_trivially_destructible<PDGNullNode>::value
+              && std::is_trivially_destructible<PDGPhiNode>::value,
+              "PDG nodes should be trivially destructible");
+
 std::string getNodeTypeAsString(PDGLLVMNode::NodeType type)
 {
     switch(type) {
@@ -49,7 +65,7 @@ std::string PDGPhiNode::getNodeAsString() const
     std::string str;
     llvm::raw_string_ostream rawstr(str);
     rawstr << "PhiNode ";
-    for (unsigned i = 0; i < m_values.size(); ++i) {
+    for (unsigned i = 0; i < m_size; ++i) {
         rawstr << " [ ";
         rawstr << *m_values[i];
         rawstr << m_blocks[i]->getName();
@@ -0,0 +1,363 @@
+#include "PDG/PDGPagedGraph.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+namespace pdg {
+
+namespace {
+
+const std::size_t DefaultMemoryBudget = 256 * 1024 * 1024;
+
+template <typename T>
+const char* readArray(const char* data, uint32_t size, std::vector<T>& array)
+{
+    array.resize(size);
+    std::memcpy(array.data(), data, size * sizeof(T));
+    return data + size * sizeof(T);
+}
+
+template <typename T>
+std::size_t arrayMemorySize(const std::vector<T>& array)
+{
+    return array.capacity() * sizeof(T);
+}
+
+} // unnamed namespace
+
+uint32_t PDGPagedGraph::Page::getPosition(NodeId id) const
+{
+    auto pos = std::lower_bound(nodes.begin(), nodes.end(), id);
+    assert(pos != nodes.end() && *pos == id);
+    return pos - nodes.begin();
+}
+
+PDGPagedGraph::PDGPagedGraph()
+    : m_mapping(nullptr)
+    , m_mappingSize(0)
+    , m_header(nullptr)
+    , m_nodePages(nullptr)
+    , m_pageOffsets(nullptr)
+    , m_pageSizes(nullptr)
+    , m_pageNames(nullptr)
+    , m_crossOutOffsets(nullptr)
+    , m_crossOutTargets(nullptr)
+    , m_crossOutKinds(nullptr)
+    , m_crossInOffsets(nullptr)
+    , m_crossInSources(nullptr)
+    , m_crossInKinds(nullptr)
+    , m_strings(nullptr)
+    , m_memoryBudget(DefaultMemoryBudget)
+{
+}
+
+PDGPagedGraph::~PDGPagedGraph()
+{
+    close();
+}
+
+bool PDGPagedGraph::open(const std::string& path)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return fail("can not open " + path + ": " + std::strerror(errno));
+    }
+    struct stat st;
+    if (::fstat(fd, &st) == -1) {
+        ::close(fd);
+        return fail("can not stat " + path + ": " + std::strerror(errno));
+    }
+    if (static_cast<uint64_t>(st.st_size) < sizeof(PDGPagedHeader)) {
+        ::close(fd);
+        return fail(path + " is too small to be a paged PDG file");
+    }
+    m_mappingSize = st.st_size;
+    void* mapping = ::mmap(nullptr, m_mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    // mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        m_mappingSize = 0;
+        return fail("can not map " + path + ": " + std::strerror(errno));
+    }
+    m_mapping = mapping;
+    m_header = static_cast<const PDGPagedHeader*>(m_mapping);
+    if (!mapSections()) {
+        const std::string error = m_error;
+        close();
+        m_error = path + ": " + error;
+        return false;
+    }
+    m_pages.resize(m_header->pagesNum);
+    return true;
+}
+
+void PDGPagedGraph::close()
+{
+    m_pages.clear();
+    m_lru.clear();
+    m_statistics = Statistics();
+    if (m_mapping) {
+        ::munmap(m_mapping, m_mappingSize);
+    }
+    m_mapping = nullptr;
+    m_mappingSize = 0;
+    m_header = nullptr;
+    m_error.clear();
+}
+
+void PDGPagedGraph::setMemoryBudget(std::size_t budget)
+{
+    m_memoryBudget = budget;
+    evictPages();
+}
+
+unsigned PDGPagedGraph::getNodeKind(NodeId id)
+{
+    const auto& page = getNodePage(id);
+    return page.kinds[page.getPosition(id)];
+}
+
+std::string PDGPagedGraph::getNodeLabel(NodeId id)
+{
+    const auto& page = getNodePage(id);
+    return page.labelsData.c_str() + page.labels[page.getPosition(id)];
+}
+
+uint32_t PDGPagedGraph::findFunction(const std::string& name) const
+{
+    for (uint32_t i = 0; i < functionsSize(); ++i) {
+        if (name == getFunctionName(i)) {
+            return i;
+        }
+    }
+    return InvalidIndex;
+}
+
+PDGPagedGraph::NodeIds PDGPagedGraph::getFunctionNodes(uint32_t index)
+{
+    assert(index < functionsSize());
+    return getPage(index).nodes;
+}
+
+PDGPagedGraph::NodeIds PDGPagedGraph::getSuccessors(NodeId id, EdgeKinds kinds)
+{
+    return getAdjacent(id, kinds, true);
+}
+
+PDGPagedGraph::NodeIds PDGPagedGraph::getPredecessors(NodeId id, EdgeKinds kinds)
+{
+    return getAdjacent(id, kinds, false);
+}
+
+PDGPagedGraph::NodeIds PDGPagedGraph::forwardSlice(NodeId from, EdgeKinds kinds)
+{
+    return slice(from, kinds, true);
+}
+
+PDGPagedGraph::NodeIds PDGPagedGraph::backwardSlice(NodeId from, EdgeKinds kinds)
+{
+    return slice(from, kinds, false);
+}
+
+bool PDGPagedGraph::fail(const std::string& error)
+{
+    m_error = error;
+    return false;
+}
+
+bool PDGPagedGraph::mapSections()
+{
+    if (!m_header->hasValidMagic()) {
+        return fail("not a paged PDG file");
+    }
+    if (m_header->byteOrderMark != PDGPagedHeader::ByteOrderMark) {
+        return fail("file was written on a machine with different byte order");
+    }
+    if (m_header->version != PDGPagedHeader::CurrentVersion) {
+        return fail("unsupported format version " + std::to_string(m_header->version));
+    }
+    if (m_header->fileSize != m_mappingSize) {
+        return fail("file is truncated");
+    }
+    if (m_header->pagesNum == 0 || m_header->modulePage != m_header->pagesNum - 1) {
+        return fail("module page is missing");
+    }
+    const uint64_t nodesNum = m_header->nodesNum;
+    const uint64_t pagesNum = m_header->pagesNum;
+    const uint64_t crossEdgesNum = m_header->crossEdgesNum;
+    if (!getSection(PDGPagedHeader::NodePages, nodesNum, m_nodePages)
+            || !getSection(PDGPagedHeader::PageOffsets, pagesNum, m_pageOffsets)
+            || !getSection(PDGPagedHeader::PageSizes, pagesNum, m_pageSizes)
+            || !getSection(PDGPagedHeader::PageNames, pagesNum, m_pageNames)
+            || !getSection(PDGPagedHeader::CrossOutOffsets, nodesNum + 1, m_crossOutOffsets)
+            || !getSection(PDGPagedHeader::CrossOutTargets, crossEdgesNum, m_crossOutTargets)
+            || !getSection(PDGPagedHeader::CrossOutKinds, crossEdgesNum, m_crossOutKinds)
+            || !getSection(PDGPagedHeader::CrossInOffsets, nodesNum + 1, m_crossInOffsets)
+            || !getSection(PDGPagedHeader::CrossInSources, crossEdgesNum, m_crossInSources)
+            || !getSection(PDGPagedHeader::CrossInKinds, crossEdgesNum, m_crossInKinds)
+            || !getSection(PDGPagedHeader::Strings, m_header->stringsSize, m_strings)) {
+        return fail("section is out of file bounds");
+    }
+    for (uint64_t page = 0; page < pagesNum; ++page) {
+        if (m_pageOffsets[page] > m_mappingSize
+                || m_pageSizes[page] > m_mappingSize - m_pageOffsets[page]
+                || m_pageSizes[page] < sizeof(PDGPageHeader)) {
+            return fail("page is out of file bounds");
+        }
+    }
+    if (m_crossOutOffsets[nodesNum] != crossEdgesNum || m_crossInOffsets[nodesNum] != crossEdgesNum) {
+        return fail("edge offsets do not match edges number");
+    }
+    if (m_header->stringsSize == 0 || m_strings[m_header->stringsSize - 1] != '\0') {
+        return fail("string table is not terminated");
+    }
+    return true;
+}
+
+template <typename T>
+bool PDGPagedGraph::getSection(PDGPagedHeader::Section section, uint64_t size, const T*& data)
+{
+    const uint64_t offset = m_header->sectionOffsets[section];
+    if (offset % alignof(T) != 0
+            || offset > m_mappingSize
+            || size > (m_mappingSize - offset) / sizeof(T)) {
+        return false;
+    }
+    data = reinterpret_cast<const T*>(static_cast<const char*>(m_mapping) + offset);
+    return true;
+}
+
+const PDGPagedGraph::Page& PDGPagedGraph::getNodePage(NodeId id)
+{
+    assert(hasNode(id));
+    return getPage(m_nodePages[id]);
+}
+
+const PDGPagedGraph::Page& PDGPagedGraph::getPage(uint32_t index)
+{
+    auto& page = m_pages[index];
+    if (page) {
+        ++m_statistics.hitsNum;
+        m_lru.splice(m_lru.begin(), m_lru, page->lruPosition);
+        return *page;
+    }
+    ++m_statistics.missesNum;
+    page = loadPage(index);
+    m_lru.push_front(index);
+    page->lruPosition = m_lru.begin();
+    m_statistics.residentSize += page->memorySize;
+    m_statistics.peakResidentSize = std::max(m_statistics.peakResidentSize, m_statistics.residentSize);
+    evictPages();
+    return *page;
+}
+
+std::unique_ptr<PDGPagedGraph::Page> PDGPagedGraph::loadPage(uint32_t index) const
+{
+    const char* data = static_cast<const char*>(m_mapping) + m_pageOffsets[index];
+    PDGPageHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    data += sizeof(header);
+
+    std::unique_ptr<Page> page(new Page());
+    data = readArray(data, header.nodesNum, page->nodes);
+    data = readArray(data, header.nodesNum, page->kinds);
+    data = readArray(data, header.nodesNum, page->labels);
+    data = readArray(data, header.nodesNum + 1, page->outOffsets);
+    data = readArray(data, header.edgesNum, page->outTargets);
+    data = readArray(data, header.edgesNum, page->outKinds);
+    page->labelsData.assign(data, header.labelsSize);
+
+    // in edges of the page are transpose of its out edges
+    const uint32_t nodesNum = header.nodesNum;
+    page->inOffsets.assign(nodesNum + 1, 0);
+    std::vector<uint32_t> targetPositions(header.edgesNum);
+    for (uint32_t i = 0; i < header.edgesNum; ++i) {
+        targetPositions[i] = page->getPosition(page->outTargets[i]);
+        ++page->inOffsets[targetPositions[i] + 1];
+    }
+    for (uint32_t pos = 0; pos < nodesNum; ++pos) {
+        page->inOffsets[pos + 1] += page->inOffsets[pos];
+    }
+    page->inSources.resize(header.edgesNum);
+    page->inKinds.resize(header.edgesNum);
+    std::vector<uint32_t> inPos(page->inOffsets.begin(), page->inOffsets.end() - 1);
+    for (uint32_t pos = 0; pos < nodesNum; ++pos) {
+        for (uint32_t i = page->outOffsets[pos]; i < page->outOffsets[pos + 1]; ++i) {
+            const uint32_t inIndex = inPos[targetPositions[i]]++;
+            page->inSources[inIndex] = page->nodes[pos];
+            page->inKinds[inIndex] = page->outKinds[i];
+        }
+    }
+
+    page->memorySize = sizeof(Page) + arrayMemorySize(page->nodes) + arrayMemorySize(page->kinds)
+                     + arrayMemorySize(page->labels) + arrayMemorySize(page->outOffsets)
+                     + arrayMemorySize(page->outTargets) + arrayMemorySize(page->outKinds)
+                     + arrayMemorySize(page->inOffsets) + arrayMemorySize(page->inSources)
+                     + arrayMemorySize(page->inKinds) + page->labelsData.capacity();
+    return page;
+}
+
+void PDGPagedGraph::evictPages()
+{
+    while (m_statistics.residentSize > m_memoryBudget && m_lru.size() > 1) {
+        const uint32_t index = m_lru.back();
+        m_lru.pop_back();
+        m_statistics.residentSize -= m_pages[index]->memorySize;
+        m_pages[index].reset();
+        ++m_statistics.evictionsNum;
+    }
+}
+
+PDGPagedGraph::NodeIds PDGPagedGraph::getAdjacent(NodeId id, EdgeKinds kinds, bool forward)
+{
+    NodeIds result;
+    const auto& page = getNodePage(id);
+    const uint32_t pos = page.getPosition(id);
+    const auto& offsets = forward ? page.outOffsets : page.inOffsets;
+    const auto& nodes = forward ? page.outTargets : page.inSources;
+    const auto& edgeKinds = forward ? page.outKinds : page.inKinds;
+    for (uint32_t i = offsets[pos]; i < offsets[pos + 1]; ++i) {
+        if (edgeKinds[i] & kinds) {
+            result.push_back(nodes[i]);
+        }
+    }
+    // edges to other functions are in the mapped index, no page needs to be loaded for them
+    const uint32_t* crossOffsets = forward ? m_crossOutOffsets : m_crossInOffsets;
+    const NodeId* crossNodes = forward ? m_crossOutTargets : m_crossInSources;
+    const EdgeKinds* crossKinds = forward ? m_crossOutKinds : m_crossInKinds;
+    for (uint32_t i = crossOffsets[id]; i < crossOffsets[id + 1]; ++i) {
+        if (crossKinds[i] & kinds) {
+            result.push_back(crossNodes[i]);
+        }
+    }
+    return result;
+}
+
+PDGPagedGraph::NodeIds PDGPagedGraph::slice(NodeId from, EdgeKinds kinds, bool forward)
+{
+    NodeIds result;
+    std::vector<bool> visited(size(), false);
+    visited[from] = true;
+    result.push_back(from);
+    // result doubles as BFS queue
+    for (unsigned i = 0; i < result.size(); ++i) {
+        for (NodeId next : getAdjacent(result[i], kinds, forward)) {
+            if (visited[next]) {
+                continue;
+            }
+            visited[next] = true;
+            result.push_back(next);
+        }
+    }
+    return result;
+}
+
+} // namespace pdg
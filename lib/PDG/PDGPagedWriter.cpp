@@ -0,0 +1,285 @@
+#include "PDG/PDGPagedWriter.h"
+
+#include "PDG/FunctionPDG.h"
+#include "PDG/PDG.h"
+#include "PDG/PDGPagedFormat.h"
+
+#include "llvm/IR/Function.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+
+namespace pdg {
+
+namespace {
+
+const uint32_t InvalidPage = PDGPagedHeader::InvalidIndex;
+
+template <typename T>
+void writeArray(llvm::raw_ostream& os, const std::vector<T>& data)
+{
+    os.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(T));
+}
+
+template <typename T>
+uint64_t arraySize(const std::vector<T>& data)
+{
+    return data.size() * sizeof(T);
+}
+
+} // unnamed namespace
+
+PDGPagedWriter::PDGPagedWriter(const std::string& path)
+    : m_offset(0)
+{
+    std::error_code EC;
+    m_os.reset(new llvm::raw_fd_ostream(path, EC, llvm::sys::fs::F_None));
+    if (EC) {
+        m_os.reset();
+        return;
+    }
+    // header is written last, when section offsets are known
+    PDGPagedHeader header;
+    std::memset(&header, 0, sizeof(header));
+    m_os->write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_offset = sizeof(header);
+}
+
+PDGPagedWriter::~PDGPagedWriter()
+{
+}
+
+bool PDGPagedWriter::isOpen() const
+{
+    return m_os != nullptr;
+}
+
+void PDGPagedWriter::addFunction(FunctionPDG& functionPDG)
+{
+    assert(isOpen());
+    Nodes nodes(functionPDG.nodesBegin(), functionPDG.nodesEnd());
+    writePage(functionPDG.getFunction()->getName().str(), nodes);
+}
+
+bool PDGPagedWriter::finish(const PDG& pdg)
+{
+    assert(isOpen());
+    Nodes moduleNodes;
+    for (PDG::NodeId id = 0; id < pdg.size(); ++id) {
+        auto* node = pdg.getNode(id);
+        if (node && getNodePage(id) == InvalidPage) {
+            moduleNodes.push_back(node);
+        }
+    }
+    const uint32_t modulePage = m_pageOffsets.size();
+    writePage("", moduleNodes);
+    // edges between remaining interface nodes of different functions
+    for (PDG::NodeId id = 0; id < pdg.size(); ++id) {
+        auto* node = pdg.getNode(id);
+        if (!node || getNodePage(id) == modulePage) {
+            continue;
+        }
+        for (const auto& edge : node->getOutEdges()) {
+            if (getNodePage(edge.getDestinationId()) != getNodePage(id)) {
+                m_crossEdges.push_back(edge);
+            }
+        }
+    }
+    m_nodePages.resize(pdg.size(), InvalidPage);
+
+    // an edge leaving a page may have been seen from both of its ends
+    auto edgeLess = [] (const PDGEdge& a, const PDGEdge& b) {
+        if (a.getSourceId() != b.getSourceId()) {
+            return a.getSourceId() < b.getSourceId();
+        }
+        if (a.getDestinationId() != b.getDestinationId()) {
+            return a.getDestinationId() < b.getDestinationId();
+        }
+        return a.getKind() < b.getKind();
+    };
+    std::sort(m_crossEdges.begin(), m_crossEdges.end(), edgeLess);
+    m_crossEdges.erase(std::unique(m_crossEdges.begin(), m_crossEdges.end()), m_crossEdges.end());
+
+    const uint32_t nodesNum = m_nodePages.size();
+    const uint32_t crossEdgesNum = m_crossEdges.size();
+    std::vector<uint32_t> crossOutOffsets(nodesNum + 1, 0);
+    std::vector<uint32_t> crossOutTargets;
+    std::vector<uint8_t> crossOutKinds;
+    std::vector<uint32_t> crossInOffsets(nodesNum + 1, 0);
+    std::vector<uint32_t> crossInSources(crossEdgesNum);
+    std::vector<uint8_t> crossInKinds(crossEdgesNum);
+    crossOutTargets.reserve(crossEdgesNum);
+    crossOutKinds.reserve(crossEdgesNum);
+    for (const auto& edge : m_crossEdges) {
+        ++crossOutOffsets[edge.getSourceId() + 1];
+        ++crossInOffsets[edge.getDestinationId() + 1];
+        crossOutTargets.push_back(edge.getDestinationId());
+        crossOutKinds.push_back(edge.getKind());
+    }
+    for (uint32_t id = 0; id < nodesNum; ++id) {
+        crossOutOffsets[id + 1] += crossOutOffsets[id];
+        crossInOffsets[id + 1] += crossInOffsets[id];
+    }
+    std::vector<uint32_t> inPos(crossInOffsets.begin(), crossInOffsets.end() - 1);
+    for (const auto& edge : m_crossEdges) {
+        const uint32_t pos = inPos[edge.getDestinationId()]++;
+        crossInSources[pos] = edge.getSourceId();
+        crossInKinds[pos] = edge.getKind();
+    }
+    std::vector<PDGEdge>().swap(m_crossEdges);
+
+    PDGPagedHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, PDGPagedHeader::getMagic(), PDGPagedHeader::MagicSize);
+    header.version = PDGPagedHeader::CurrentVersion;
+    header.byteOrderMark = PDGPagedHeader::ByteOrderMark;
+    header.nodesNum = nodesNum;
+    header.pagesNum = m_pageOffsets.size();
+    header.modulePage = modulePage;
+    header.crossEdgesNum = crossEdgesNum;
+    header.stringsSize = m_strings.size();
+
+    struct SectionData
+    {
+        const void* data;
+        uint64_t size;
+    };
+    SectionData sections[PDGPagedHeader::SectionsNum] = {
+        {m_nodePages.data(), arraySize(m_nodePages)},
+        {m_pageOffsets.data(), arraySize(m_pageOffsets)},
+        {m_pageSizes.data(), arraySize(m_pageSizes)},
+        {m_pageNames.data(), arraySize(m_pageNames)},
+        {crossOutOffsets.data(), arraySize(crossOutOffsets)},
+        {crossOutTargets.data(), arraySize(crossOutTargets)},
+        {crossOutKinds.data(), arraySize(crossOutKinds)},
+        {crossInOffsets.data(), arraySize(crossInOffsets)},
+        {crossInSources.data(), arraySize(crossInSources)},
+        {crossInKinds.data(), arraySize(crossInKinds)},
+        {m_strings.data(), arraySize(m_strings)}
+    };
+    for (unsigned i = 0; i < PDGPagedHeader::SectionsNum; ++i) {
+        writePadding();
+        header.sectionOffsets[i] = m_offset;
+        m_os->write(static_cast<const char*>(sections[i].data), sections[i].size);
+        m_offset += sections[i].size;
+    }
+    header.fileSize = m_offset;
+    m_os->seek(0);
+    m_os->write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_os->close();
+    const bool failed = m_os->has_error();
+    m_os->clear_error();
+    m_os.reset();
+    return !failed;
+}
+
+void PDGPagedWriter::writePage(const std::string& name, Nodes& nodes)
+{
+    const uint32_t page = m_pageOffsets.size();
+    std::sort(nodes.begin(), nodes.end(), [] (PDGNode* a, PDGNode* b) {
+        return a->getNodeId() < b->getNodeId();
+    });
+    // implicit block membership control edges are written as ordinary ones.
+    // Blocks and their members are in the same function, hence on the same page
+    std::unordered_map<PDGEdge::NodeId, std::vector<PDGEdge::NodeId>> blockMembers;
+    for (auto* node : nodes) {
+        setNodePage(node->getNodeId(), page);
+        if (node->hasBlockNode()) {
+            blockMembers[node->getBlockNodeId()].push_back(node->getNodeId());
+        }
+    }
+
+    std::vector<uint32_t> nodeIds;
+    std::vector<uint32_t> nodeKinds;
+    std::vector<uint32_t> nodeLabels;
+    std::vector<uint32_t> outOffsets(1, 0);
+    std::vector<uint32_t> outTargets;
+    std::vector<uint8_t> outKinds;
+    std::vector<char> labels;
+    for (auto* node : nodes) {
+        nodeIds.push_back(node->getNodeId());
+        nodeKinds.push_back(node->getNodeType());
+        nodeLabels.push_back(labels.size());
+        const std::string label = node->getNodeAsString();
+        labels.insert(labels.end(), label.begin(), label.end());
+        labels.push_back('\0');
+        for (const auto& edge : node->getOutEdges()) {
+            if (getNodePage(edge.getDestinationId()) == page) {
+                outTargets.push_back(edge.getDestinationId());
+                outKinds.push_back(edge.getKind());
+            } else {
+                m_crossEdges.push_back(edge);
+            }
+        }
+        auto members = blockMembers.find(node->getNodeId());
+        if (members != blockMembers.end()) {
+            for (auto member : members->second) {
+                outTargets.push_back(member);
+                outKinds.push_back(PDGEdge::ControlEdge);
+            }
+        }
+        outOffsets.push_back(outTargets.size());
+        for (const auto& edge : node->getInEdges()) {
+            if (getNodePage(edge.getSourceId()) != page) {
+                m_crossEdges.push_back(edge);
+            }
+        }
+    }
+
+    PDGPageHeader pageHeader;
+    std::memset(&pageHeader, 0, sizeof(pageHeader));
+    pageHeader.nodesNum = nodeIds.size();
+    pageHeader.edgesNum = outTargets.size();
+    pageHeader.labelsSize = labels.size();
+
+    writePadding();
+    m_pageOffsets.push_back(m_offset);
+    m_pageNames.push_back(addString(name));
+    m_os->write(reinterpret_cast<const char*>(&pageHeader), sizeof(pageHeader));
+    writeArray(*m_os, nodeIds);
+    writeArray(*m_os, nodeKinds);
+    writeArray(*m_os, nodeLabels);
+    writeArray(*m_os, outOffsets);
+    writeArray(*m_os, outTargets);
+    writeArray(*m_os, outKinds);
+    writeArray(*m_os, labels);
+    const uint64_t pageSize = sizeof(pageHeader) + arraySize(nodeIds) + arraySize(nodeKinds)
+                            + arraySize(nodeLabels) + arraySize(outOffsets) + arraySize(outTargets)
+                            + arraySize(outKinds) + arraySize(labels);
+    m_pageSizes.push_back(pageSize);
+    m_offset += pageSize;
+}
+
+void PDGPagedWriter::writePadding()
+{
+    static const char padding[8] = {};
+    const uint64_t aligned = (m_offset + 7) & ~uint64_t(7);
+    m_os->write(padding, aligned - m_offset);
+    m_offset = aligned;
+}
+
+void PDGPagedWriter::setNodePage(PDGEdge::NodeId id, uint32_t page)
+{
+    if (m_nodePages.size() <= id) {
+        m_nodePages.resize(id + 1, InvalidPage);
+    }
+    m_nodePages[id] = page;
+}
+
+uint32_t PDGPagedWriter::getNodePage(PDGEdge::NodeId id) const
+{
+    return id < m_nodePages.size() ? m_nodePages[id] : InvalidPage;
+}
+
+uint32_t PDGPagedWriter::addString(const std::string& str)
+{
+    const uint32_t offset = m_strings.size();
+    m_strings.insert(m_strings.end(), str.begin(), str.end());
+    m_strings.push_back('\0');
+    return offset;
+}
+
+} // namespace pdg
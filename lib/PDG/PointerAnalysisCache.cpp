@@ -0,0 +1,291 @@
+#include "PDG/PointerAnalysisCache.h"
+
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <unordered_set>
+
+namespace pdg {
+
+namespace {
+
+const char FileMagic[4] = {'P', 'P', 'T', 'A'};
+
+/// Feeds everything written to it into MD5, so that module text is never kept in memory
+class MD5Stream : public llvm::raw_ostream
+{
+public:
+    MD5Stream()
+        : m_size(0)
+    {
+    }
+
+    ~MD5Stream()
+    {
+        flush();
+    }
+
+    std::string getDigest()
+    {
+        flush();
+        llvm::MD5::MD5Result result;
+        m_md5.final(result);
+        llvm::SmallString<32> digest;
+        llvm::MD5::stringifyResult(result, digest);
+        return digest.str().str();
+    }
+
+private:
+    void write_impl(const char* ptr, size_t size) override
+    {
+        m_md5.update(llvm::ArrayRef<uint8_t>(reinterpret_cast<const uint8_t*>(ptr), size));
+        m_size += size;
+    }
+
+    uint64_t current_pos() const override
+    {
+        return m_size;
+    }
+
+private:
+    llvm::MD5 m_md5;
+    uint64_t m_size;
+}; // class MD5Stream
+
+void writeUInt32(llvm::raw_ostream& os, uint32_t value)
+{
+    char bytes[4];
+    for (unsigned i = 0; i < 4; ++i) {
+        bytes[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+    os.write(bytes, 4);
+}
+
+/// Bounds checked little endian reader over a cache file
+class BufferReader
+{
+public:
+    BufferReader(const char* begin, const char* end)
+        : m_pos(begin)
+        , m_end(end)
+    {
+    }
+
+    bool read(uint32_t& value)
+    {
+        if (m_end - m_pos < 4) {
+            return false;
+        }
+        value = 0;
+        for (unsigned i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(static_cast<unsigned char>(m_pos[i])) << (8 * i);
+        }
+        m_pos += 4;
+        return true;
+    }
+
+    bool read(std::string& str, unsigned size)
+    {
+        if (static_cast<unsigned>(m_end - m_pos) < size) {
+            return false;
+        }
+        str.assign(m_pos, size);
+        m_pos += size;
+        return true;
+    }
+
+    bool atEnd() const
+    {
+        return m_pos == m_end;
+    }
+
+private:
+    const char* m_pos;
+    const char* m_end;
+}; // class BufferReader
+
+} // unnamed namespace
+
+PointerAnalysisCache::PointerAnalysisCache(llvm::Module* M)
+    : m_module(M)
+{
+    numberValues();
+}
+
+std::string PointerAnalysisCache::getModuleHash(const llvm::Module& M)
+{
+    MD5Stream stream;
+    M.print(stream, nullptr);
+    return stream.getDigest();
+}
+
+bool PointerAnalysisCache::load(const std::string& path, const std::string& moduleHash)
+{
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    if (!buffer) {
+        return false;
+    }
+    const char* begin = (*buffer)->getBufferStart();
+    BufferReader reader(begin, (*buffer)->getBufferEnd());
+
+    std::string magic;
+    std::string hash;
+    uint32_t version = 0;
+    uint32_t valuesNum = 0;
+    if (!reader.read(magic, sizeof(FileMagic))
+            || std::memcmp(magic.data(), FileMagic, sizeof(FileMagic)) != 0
+            || !reader.read(version) || version != FormatVersion
+            || !reader.read(hash, moduleHash.size()) || hash != moduleHash
+            || !reader.read(valuesNum) || valuesNum != m_values.size()) {
+        return false;
+    }
+
+    // read into temporaries, so that corrupted file leaves no partial results
+    std::unordered_map<llvm::Instruction*, FunctionSet> indCSCallees;
+    auto readValue = [&] (llvm::Value*& value) {
+        uint32_t id = 0;
+        if (!reader.read(id) || id >= m_values.size()) {
+            return false;
+        }
+        value = m_values[id];
+        return true;
+    };
+
+    uint32_t callSitesNum = 0;
+    if (!reader.read(callSitesNum)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < callSitesNum; ++i) {
+        llvm::Value* callValue = nullptr;
+        uint32_t calleesNum = 0;
+        if (!readValue(callValue) || !reader.read(calleesNum)) {
+            return false;
+        }
+        auto* callInst = llvm::dyn_cast<llvm::Instruction>(callValue);
+        if (!callInst) {
+            return false;
+        }
+        auto& callees = indCSCallees[callInst];
+        for (uint32_t c = 0; c < calleesNum; ++c) {
+            llvm::Value* callee = nullptr;
+            if (!readValue(callee) || !llvm::isa<llvm::Function>(callee)) {
+                return false;
+            }
+            callees.insert(llvm::cast<llvm::Function>(callee));
+        }
+    }
+
+    if (!reader.atEnd()) {
+        return false;
+    }
+    m_indCSCallees = std::move(indCSCallees);
+    return true;
+}
+
+bool PointerAnalysisCache::save(const std::string& path, const std::string& moduleHash) const
+{
+    // write to a temporary file and rename, so that concurrent readers never see a partial file
+    llvm::SmallString<128> tmpPath;
+    int fd = -1;
+    if (llvm::sys::fs::createUniqueFile(path + ".tmp-%%%%%%", fd, tmpPath)) {
+        return false;
+    }
+    {
+        llvm::raw_fd_ostream os(fd, true);
+        os.write(FileMagic, sizeof(FileMagic));
+        writeUInt32(os, FormatVersion);
+        os << moduleHash;
+        writeUInt32(os, m_values.size());
+
+        // module order keeps files byte identical for identical modules
+        auto writeIds = [&] (const std::unordered_set<uint32_t>& set) {
+            std::vector<uint32_t> ids(set.begin(), set.end());
+            std::sort(ids.begin(), ids.end());
+            writeUInt32(os, ids.size());
+            for (auto id : ids) {
+                writeUInt32(os, id);
+            }
+        };
+        writeUInt32(os, m_indCSCallees.size());
+        for (uint32_t id = 0; id < m_values.size(); ++id) {
+            auto* callInst = llvm::dyn_cast<llvm::Instruction>(m_values[id]);
+            auto pos = callInst ? m_indCSCallees.find(callInst) : m_indCSCallees.end();
+            if (pos == m_indCSCallees.end()) {
+                continue;
+            }
+            writeUInt32(os, id);
+            std::unordered_set<uint32_t> calleeIds;
+            for (auto* callee : pos->second) {
+                calleeIds.insert(m_valueIds.find(callee)->second);
+            }
+            writeIds(calleeIds);
+        }
+        os.close();
+        if (os.has_error()) {
+            os.clear_error();
+            llvm::sys::fs::remove(tmpPath);
+            return false;
+        }
+    }
+    if (llvm::sys::fs::rename(tmpPath, path)) {
+        llvm::sys::fs::remove(tmpPath);
+        return false;
+    }
+    return true;
+}
+
+void PointerAnalysisCache::addIndCSCallees(llvm::Instruction* callInst, const FunctionSet& callees)
+{
+    assert(m_valueIds.find(callInst) != m_valueIds.end());
+    m_indCSCallees[callInst].insert(callees.begin(), callees.end());
+}
+
+bool PointerAnalysisCache::hasIndCSCallees(const llvm::CallSite& callSite) const
+{
+    return m_indCSCallees.find(callSite.getInstruction()) != m_indCSCallees.end();
+}
+
+PointerAnalysisCache::FunctionSet PointerAnalysisCache::getIndCSCallees(const llvm::CallSite& callSite)
+{
+    auto pos = m_indCSCallees.find(callSite.getInstruction());
+    if (pos == m_indCSCallees.end()) {
+        return FunctionSet();
+    }
+    return pos->second;
+}
+
+void PointerAnalysisCache::numberValues()
+{
+    for (auto& global : m_module->globals()) {
+        addValue(&global);
+    }
+    for (auto& F : *m_module) {
+        addValue(&F);
+    }
+    for (auto& F : *m_module) {
+        for (auto& arg : F.args()) {
+            addValue(&arg);
+        }
+        for (auto& I : llvm::instructions(F)) {
+            addValue(&I);
+        }
+    }
+}
+
+void PointerAnalysisCache::addValue(llvm::Value* value)
+{
+    m_valueIds.insert(std::make_pair(value, m_values.size()));
+    m_values.push_back(value);
+}
+
+} // namespace pdg
+
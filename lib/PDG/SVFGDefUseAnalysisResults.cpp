@@ -1,6 +1,6 @@
 #include "PDG/SVFGDefUseAnalysisResults.h"
 
-#include "PDG/PDGLLVMNode.h"
+#include "llvm/IR/Instructions.h"
 
 #include "SVF/MSSA/SVFG.h"
 #include "SVF/MSSA/SVFGNode.h"
@@ -229,16 +229,21 @@ SVFGDefUseAnalysisResults::SVFGDefUseAnalysisResults(SVFG* svfg)
 {
 }
 
+SVFGDefUseAnalysisResults::SVFGDefUseAnalysisResults(SVFGTy svfg)
+    : m_svfgOwner(svfg)
+    , m_svfg(svfg.get())
+{
+}
+
 DefUseResults::DefSite SVFGDefUseAnalysisResults::getDefNode(llvm::Value* value)
 {
     auto pos = m_valueDefSite.find(value);
     if (pos != m_valueDefSite.end()) {
         return pos->second;
     }
-    PDGNodeTy node;
     SVFGNode* valueSvfgNode = getSVFGNode(value);
     if (!valueSvfgNode) {
-        DefSite nulldefSite(nullptr, PDGNodeTy());
+        DefSite nulldefSite;
         m_valueDefSite.insert(std::make_pair(value, nulldefSite));
         return nulldefSite;
     }
@@ -304,8 +309,6 @@ std::unordered_set<SVFGNode*> SVFGDefUseAnalysisResults::getSVFGDefNodes(SVFGNod
 
 DefUseResults::DefSite SVFGDefUseAnalysisResults::getPdgDefNode(const std::unordered_set<SVFGNode*>& svfgDefNodes)
 {
-    llvm::Value* defValue = nullptr;
-    PDGNodeTy defNode;
     std::vector<llvm::Value*> values;
     std::vector<llvm::BasicBlock*> blocks;
     for (const auto& svfgDefNode : svfgDefNodes) {
@@ -313,24 +316,20 @@ DefUseResults::DefSite SVFGDefUseAnalysisResults::getPdgDefNode(const std::unord
     }
     assert(values.size() == blocks.size());
     if (values.empty()) {
-        return DefSite(defValue, defNode);
+        return DefSite();
     }
     if (values.size() == 1) {
-        defNode = getNode(*svfgDefNodes.begin());
-        defValue = values[0];
-    } else {
-        defNode.reset(new PDGPhiNode(values, blocks));
+        return DefSite(getDefValue(*svfgDefNodes.begin()));
     }
-    return DefSite(defValue, defNode);
+    return DefSite(values, blocks);
 }
 
-DefUseResults::PDGNodeTy SVFGDefUseAnalysisResults::getNode(SVFGNode* svfgNode)
+llvm::Value* SVFGDefUseAnalysisResults::getDefValue(SVFGNode* svfgNode)
 {
     if (auto* stmtNode = llvm::dyn_cast<StmtSVFGNode>(svfgNode)) {
-        llvm::Instruction* instr = const_cast<llvm::Instruction*>(stmtNode->getInst());
-        return PDGNodeTy(new PDGLLVMInstructionNode(instr));
+        return const_cast<llvm::Instruction*>(stmtNode->getInst());
     }
-    return PDGNodeTy();
+    return nullptr;
 }
 
 } // namespace pdg
@@ -9,6 +9,12 @@ SVFGIndirectCallSiteResults::SVFGIndirectCallSiteResults(PTACallGraph* ptaGraph)
 {
 }
 
+SVFGIndirectCallSiteResults::SVFGIndirectCallSiteResults(PTACallGraphTy ptaGraph)
+    : m_ptaGraphOwner(ptaGraph)
+    , m_ptaGraph(ptaGraph.get())
+{
+}
+
 bool SVFGIndirectCallSiteResults::hasIndCSCallees(const llvm::CallSite& callSite) const
 {
     return m_ptaGraph->hasIndCSCallees(callSite);
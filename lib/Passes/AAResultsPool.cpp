@@ -0,0 +1,47 @@
+#include "Passes/AAResultsPool.h"
+
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/BasicAliasAnalysis.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Pass.h"
+
+namespace pdg {
+
+struct AAResultsPool::Results
+{
+    Results(llvm::Pass& pass, llvm::Function& F)
+        : basicAAResult(llvm::createLegacyPMBasicAAResult(pass, F))
+        , aaResults(llvm::createLegacyPMAAResults(pass, F, basicAAResult))
+    {
+    }
+
+    // declared first to outlive aaResults referring to it
+    llvm::BasicAAResult basicAAResult;
+    llvm::AAResults aaResults;
+};
+
+AAResultsPool::AAResultsPool(llvm::Pass& pass)
+    : m_pass(pass)
+{
+}
+
+AAResultsPool::~AAResultsPool()
+{
+}
+
+llvm::AAResults* AAResultsPool::getAAResults(llvm::Function* F)
+{
+    auto& results = m_results[F];
+    if (!results) {
+        results.reset(new Results(m_pass, *F));
+    }
+    return &results->aaResults;
+}
+
+void AAResultsPool::release(llvm::Function* F)
+{
+    m_results.erase(F);
+}
+
+} // namespace pdg
+
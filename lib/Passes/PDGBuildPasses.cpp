@@ -1,4 +1,6 @@
 #include "Passes/PDGBuildPasses.h"
+#include "Passes/AAResultsPool.h"
+#include "Passes/SVFPointerAnalysisPass.h"
 
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/AssumptionCache.h"
@@ -9,42 +11,146 @@
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/PassRegistry.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/GraphWriter.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 
+#include "PDG/FunctionAnalyses.h"
 #include "PDG/SVFGDefUseAnalysisResults.h"
 #include "PDG/LLVMMemorySSADefUseAnalysisResults.h"
-#include "PDG/LLVMDominanceTree.h"
+#include "PDG/LLVMDominanceIntervals.h"
+#include "PDG/PDG.h"
+#include "PDG/PDGBinaryWriter.h"
 #include "PDG/PDGBuilder.h"
 #include "PDG/PDGGraphTraits.h"
-#include "PDG/SVFGIndirectCallSiteResults.h"
 
 #include "SVF/MSSA/SVFG.h"
-#include "SVF/MSSA/SVFGBuilder.h"
-#include "SVF/Util/SVFModule.h"
-#include "SVF/MemoryModel/PointerAnalysis.h"
 #include "SVF/WPA/Andersen.h"
-#include "SVF/PDG/PDGPointerAnalysis.h"
 
 #include <fstream>
+#include <memory>
+
+llvm::cl::opt<std::string> pdg_binary_output(
+    "pdg-binary-output",
+    llvm::cl::desc("Write built PDG in binary format to the given file"),
+    llvm::cl::value_desc("filename"));
+
+llvm::cl::opt<bool> pdg_lazy(
+    "pdg-lazy",
+    llvm::cl::desc("Build function PDGs on first access instead of building the whole module"),
+    llvm::cl::init(false));
+
+llvm::cl::list<std::string> pdg_roots(
+    "pdg-roots",
+    llvm::cl::desc("Build PDG of functions reachable from the given functions only, names or regular expressions"),
+    llvm::cl::value_desc("pattern"),
+    llvm::cl::CommaSeparated);
 
 namespace pdg {
 
+/// Restricts the build to functions reachable from -pdg-roots.
+/// Reachability needs indirect call targets, so they are set here as well
+static void setRootsIfRequested(PDGBuilder& pdgBuilder, llvm::Module& M, SVFPointerAnalysisPass& pta)
+{
+    if (pdg_roots.empty()) {
+        return;
+    }
+    std::vector<std::string> patterns(pdg_roots.begin(), pdg_roots.end());
+    PDGBuilder::FunctionSet roots;
+    std::string error;
+    if (!PDGBuilder::findFunctions(&M, patterns, roots, error)) {
+        llvm::report_fatal_error("-pdg-roots: " + error);
+    }
+    if (roots.empty()) {
+        llvm::errs() << "No functions match -pdg-roots, building whole module\n";
+        return;
+    }
+    pdgBuilder.setRoots(roots);
+    pdgBuilder.setIndirectCallSitesResults(pta.getIndirectCallSiteResults());
+}
+
+static void writeBinaryIfRequested(const PDG& pdg)
+{
+    if (pdg_binary_output.empty()) {
+        return;
+    }
+    PDGBinaryWriter writer(pdg);
+    if (!writer.write(pdg_binary_output)) {
+        llvm::errs() << "Failed to write PDG to " << pdg_binary_output << "\n";
+    }
+}
+
+/// Prepares builder for lazy mode. Function analyses are owned by the pass instead of the pass manager,
+/// since functions are built after the pass has run. The PDG shares them, so that it can build functions
+/// after the pass has released its memory too
+static void setupLazyBuild(PDGBuilder& pdgBuilder, llvm::Module& M, std::shared_ptr<FunctionAnalyses>& analyses)
+{
+    // functions nobody asks for are never built, writing the graph upfront would leave them out
+    if (!pdg_binary_output.empty()) {
+        llvm::report_fatal_error("-pdg-binary-output can not be used with -pdg-lazy");
+    }
+    analyses = std::make_shared<FunctionAnalyses>(M);
+    auto domTreeGetter = [analyses] (llvm::Function* F) {
+        return analyses->getDomTree(F);
+    };
+    auto postdomTreeGetter = [analyses] (llvm::Function* F) {
+        return analyses->getPostDomTree(F);
+    };
+    pdgBuilder.setDominanceResults(PDGBuilder::DominanceResultsTy(new LLVMDominanceIntervals(domTreeGetter,
+                                                                                             postdomTreeGetter)));
+    pdgBuilder.setFunctionMaterializer([analyses] (llvm::Function* F) {
+        analyses->computeDominance(F);
+        return true;
+    });
+}
+
 char SVFGPDGBuilder::ID = 0;
 static llvm::RegisterPass<SVFGPDGBuilder> X("svfg-pdg","build pdg using svfg");
 
+SVFGPDGBuilder::SVFGPDGBuilder()
+    : llvm::ModulePass(ID)
+{
+}
+
+SVFGPDGBuilder::~SVFGPDGBuilder()
+{
+}
+
+void SVFGPDGBuilder::releaseMemory()
+{
+    m_pdg.reset();
+    m_analyses.reset();
+}
+
 void SVFGPDGBuilder::getAnalysisUsage(llvm::AnalysisUsage& AU) const
 {
     AU.addRequired<llvm::PostDominatorTreeWrapperPass>();
     AU.addRequired<llvm::DominatorTreeWrapperPass>();
+    // lazily built functions use pointer analysis results after this pass has run
+    AU.addRequiredTransitive<SVFPointerAnalysisPass>();
     AU.setPreservesAll();
 }
 
 bool SVFGPDGBuilder::runOnModule(llvm::Module& M)
 {
+    if (pdg_lazy) {
+        auto& pta = getAnalysis<SVFPointerAnalysisPass>();
+        pdg::PDGBuilder pdgBuilder(&M);
+        setupLazyBuild(pdgBuilder, M, m_analyses);
+        pdgBuilder.setDesUseResults(PDGBuilder::DefUseResultsTy(
+                    new SVFGDefUseAnalysisResults(pta.getSharedSVFG())));
+        pdgBuilder.setIndirectCallSitesResults(pta.getIndirectCallSiteResults());
+        setRootsIfRequested(pdgBuilder, M, pta);
+        pdgBuilder.buildLazily();
+        m_pdg = pdgBuilder.getPDG();
+        m_pdg->freeze();
+        return false;
+    }
+
     auto domTreeGetter = [&] (llvm::Function* F) {
         return &this->getAnalysis<llvm::DominatorTreeWrapperPass>(*F).getDomTree();
     };
@@ -52,36 +158,49 @@ bool SVFGPDGBuilder::runOnModule(llvm::Module& M)
         return &this->getAnalysis<llvm::PostDominatorTreeWrapperPass>(*F).getPostDomTree();
     };
 
-    SVFModule svfM(M);
-    AndersenWaveDiff* ander = new svfg::PDGAndersenWaveDiff();
-    ander->disablePrintStat();
-    ander->analyze(svfM);
-    SVFGBuilder memSSA(true);
-    SVFG *svfg = memSSA.buildSVFG((BVDataPTAImpl*)ander);
-
+    auto& pta = getAnalysis<SVFPointerAnalysisPass>();
 
     using DefUseResultsTy = PDGBuilder::DefUseResultsTy;
     using IndCSResultsTy = PDGBuilder::IndCSResultsTy;
     using DominanceResultsTy = PDGBuilder::DominanceResultsTy;
-    DefUseResultsTy defUse = DefUseResultsTy(new SVFGDefUseAnalysisResults(svfg));
-    IndCSResultsTy indCSRes = IndCSResultsTy(new
-            pdg::SVFGIndirectCallSiteResults(ander->getPTACallGraph()));
-    DominanceResultsTy domResults = DominanceResultsTy(new LLVMDominanceTree(domTreeGetter,
+    DominanceResultsTy domResults = DominanceResultsTy(new LLVMDominanceIntervals(domTreeGetter,
                 postdomTreeGetter));
 
+    // SVFG needs Andersen analysis, which runs here even on a pointer analysis cache hit
+    DefUseResultsTy defUse = DefUseResultsTy(new SVFGDefUseAnalysisResults(pta.getSVFG()));
+    IndCSResultsTy indCSRes = pta.getIndirectCallSiteResults();
+
     pdg::PDGBuilder pdgBuilder(&M);
     pdgBuilder.setDesUseResults(defUse);
     pdgBuilder.setIndirectCallSitesResults(indCSRes);
     pdgBuilder.setDominanceResults(domResults);
+    setRootsIfRequested(pdgBuilder, M, pta);
     pdgBuilder.build();
 
     m_pdg = pdgBuilder.getPDG();
+    m_pdg->freeze();
+    writeBinaryIfRequested(*m_pdg);
     return false;
 }
 
 char LLVMPDGBuilder::ID = 0;
 static llvm::RegisterPass<LLVMPDGBuilder> Z("llvm-pdg","build pdg using dg");
 
+LLVMPDGBuilder::LLVMPDGBuilder()
+    : llvm::ModulePass(ID)
+{
+}
+
+LLVMPDGBuilder::~LLVMPDGBuilder()
+{
+}
+
+void LLVMPDGBuilder::releaseMemory()
+{
+    m_pdg.reset();
+    m_analyses.reset();
+}
+
 void LLVMPDGBuilder::getAnalysisUsage(llvm::AnalysisUsage& AU) const
 {
     AU.addRequired<llvm::AssumptionCacheTracker>(); // otherwise run-time error
@@ -89,27 +208,50 @@ void LLVMPDGBuilder::getAnalysisUsage(llvm::AnalysisUsage& AU) const
     AU.addRequiredTransitive<llvm::MemorySSAWrapperPass>();
     AU.addRequired<llvm::PostDominatorTreeWrapperPass>();
     AU.addRequired<llvm::DominatorTreeWrapperPass>();
+    // lazily built functions use pointer analysis results after this pass has run
+    AU.addRequiredTransitive<SVFPointerAnalysisPass>();
     AU.setPreservesAll();
 }
 
 bool LLVMPDGBuilder::runOnModule(llvm::Module& M)
 {
+    if (pdg_lazy) {
+        auto& pta = getAnalysis<SVFPointerAnalysisPass>();
+        pdg::PDGBuilder pdgBuilder(&M);
+        setupLazyBuild(pdgBuilder, M, m_analyses);
+        auto analyses = m_analyses;
+        auto memSSAGetter = [analyses] (llvm::Function* F) {
+            return analyses->getMemorySSA(F);
+        };
+        auto aliasAnalysisResGetter = [analyses] (llvm::Function* F) {
+            return analyses->getAAResults(F);
+        };
+        auto memorySSADefUse = std::make_shared<LLVMMemorySSADefUseAnalysisResults>(memSSAGetter,
+                                                                                     aliasAnalysisResGetter);
+        // memory uses of a lazily built function are connected right away, its analyses can go afterwards
+        memorySSADefUse->setAAResultsReleaser([analyses] (llvm::Function* F) {
+            analyses->release(F);
+        });
+        pdgBuilder.setDesUseResults(memorySSADefUse);
+        pdgBuilder.setIndirectCallSitesResults(pta.getIndirectCallSiteResults());
+        setRootsIfRequested(pdgBuilder, M, pta);
+        pdgBuilder.buildLazily();
+        m_pdg = pdgBuilder.getPDG();
+        m_pdg->freeze();
+        return false;
+    }
+
     auto memSSAGetter = [this] (llvm::Function* F) -> llvm::MemorySSA* {
         return &this->getAnalysis<llvm::MemorySSAWrapperPass>(*F).getMSSA();
     };
-    llvm::Optional<llvm::BasicAAResult> BAR;
-    llvm::Optional<llvm::AAResults> AAR;
-    auto AARGetter = [&](llvm::Function* F) -> llvm::AAResults* {
-        BAR.emplace(llvm::createLegacyPMBasicAAResult(*this, *F));
-        AAR.emplace(llvm::createLegacyPMAAResults(*this, *F, *BAR));
-        return &*AAR;
+    // one alias analysis result per function, freed once memory uses of the function are connected
+    AAResultsPool aaResultsPool(*this);
+    auto aliasAnalysisResGetter = [&aaResultsPool] (llvm::Function* F) {
+        return aaResultsPool.getAAResults(F);
+    };
+    auto aliasAnalysisResReleaser = [&aaResultsPool] (llvm::Function* F) {
+        aaResultsPool.release(F);
     };
-    std::unordered_map<llvm::Function*, llvm::AAResults*> functionAAResults;
-    for (auto& F : M) {
-        if (!F.isDeclaration()) {
-            functionAAResults.insert(std::make_pair(&F, AARGetter(&F)));
-        }
-    }
 
     auto domTreeGetter = [&] (llvm::Function* F) {
         return &this->getAnalysis<llvm::DominatorTreeWrapperPass>(*F).getDomTree();
@@ -118,32 +260,29 @@ bool LLVMPDGBuilder::runOnModule(llvm::Module& M)
         return &this->getAnalysis<llvm::PostDominatorTreeWrapperPass>(*F).getPostDomTree();
     };
 
-    auto aliasAnalysisResGetter = [&functionAAResults] (llvm::Function* F) {
-            return functionAAResults[F];
-    };
-
     // TODO: consider not using SVF here at all
-    SVFModule svfM(M);
-    AndersenWaveDiff* ander = new svfg::PDGAndersenWaveDiff();
-    ander->disablePrintStat();
-    ander->analyze(svfM);
+    auto& pta = getAnalysis<SVFPointerAnalysisPass>();
 
     using DefUseResultsTy = PDGBuilder::DefUseResultsTy;
     using IndCSResultsTy = PDGBuilder::IndCSResultsTy;
     using DominanceResultsTy = PDGBuilder::DominanceResultsTy;
-    DefUseResultsTy defUse = DefUseResultsTy(new LLVMMemorySSADefUseAnalysisResults(memSSAGetter, aliasAnalysisResGetter));
-    IndCSResultsTy indCSRes = IndCSResultsTy(new
-            pdg::SVFGIndirectCallSiteResults(ander->getPTACallGraph()));
-    DominanceResultsTy domResults = DominanceResultsTy(new LLVMDominanceTree(domTreeGetter,
+    auto memorySSADefUse = std::make_shared<LLVMMemorySSADefUseAnalysisResults>(memSSAGetter, aliasAnalysisResGetter);
+    memorySSADefUse->setAAResultsReleaser(aliasAnalysisResReleaser);
+    DefUseResultsTy defUse = memorySSADefUse;
+    DominanceResultsTy domResults = DominanceResultsTy(new LLVMDominanceIntervals(domTreeGetter,
                 postdomTreeGetter));
+    IndCSResultsTy indCSRes = pta.getIndirectCallSiteResults();
 
     pdg::PDGBuilder pdgBuilder(&M);
     pdgBuilder.setDesUseResults(defUse);
     pdgBuilder.setIndirectCallSitesResults(indCSRes);
     pdgBuilder.setDominanceResults(domResults);
+    setRootsIfRequested(pdgBuilder, M, pta);
     pdgBuilder.build();
 
     m_pdg = pdgBuilder.getPDG();
+    m_pdg->freeze();
+    writeBinaryIfRequested(*m_pdg);
     return false;
 }
 
@@ -0,0 +1,192 @@
+#include "Passes/SVFPointerAnalysisPass.h"
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Module.h"
+#include "llvm/PassRegistry.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "PDG/PointerAnalysisCache.h"
+#include "PDG/SVFGIndirectCallSiteResults.h"
+
+#include "SVF/MSSA/SVFG.h"
+#include "SVF/MSSA/SVFGBuilder.h"
+#include "SVF/Util/SVFModule.h"
+#include "SVF/Util/PTACallGraph.h"
+#include "SVF/MemoryModel/PointerAnalysis.h"
+#include "SVF/WPA/Andersen.h"
+#include "SVF/PDG/PDGPointerAnalysis.h"
+
+#include <cassert>
+
+#define DEBUG_TYPE "pdg-pta"
+
+STATISTIC(NumPTACacheHits, "Number of modules with pointer analysis results found in cache");
+STATISTIC(NumPTACacheMisses, "Number of modules with pointer analysis results not found in cache");
+
+llvm::cl::opt<std::string> pta_cache(
+    "pdg-pta-cache",
+    llvm::cl::desc("Directory to cache pointer analysis results in"),
+    llvm::cl::value_desc("directory"));
+
+namespace pdg {
+
+struct SVFPointerAnalysisPass::Results
+{
+    std::unique_ptr<SVFModule> svfModule;
+    std::unique_ptr<AndersenWaveDiff> andersen;
+    std::unique_ptr<SVFGBuilder> svfgBuilder;
+    SVFG* svfg = nullptr;
+};
+
+char SVFPointerAnalysisPass::ID = 0;
+static llvm::RegisterPass<SVFPointerAnalysisPass> X("svf-pta","run whole program pointer analysis once for PDG passes",
+                                                    false, true);
+
+SVFPointerAnalysisPass::SVFPointerAnalysisPass()
+    : llvm::ModulePass(ID)
+    , m_module(nullptr)
+    , m_cacheHit(false)
+    , m_cacheHitsNum(0)
+    , m_cacheMissesNum(0)
+{
+}
+
+SVFPointerAnalysisPass::~SVFPointerAnalysisPass()
+{
+    releaseMemory();
+}
+
+void SVFPointerAnalysisPass::getAnalysisUsage(llvm::AnalysisUsage& AU) const
+{
+    AU.setPreservesAll();
+}
+
+bool SVFPointerAnalysisPass::runOnModule(llvm::Module& M)
+{
+    releaseMemory();
+    m_module = &M;
+    if (!pta_cache.empty()) {
+        m_moduleHash = PointerAnalysisCache::getModuleHash(M);
+        llvm::SmallString<128> path(pta_cache.getValue());
+        llvm::sys::path::append(path, m_moduleHash + ".pta");
+        m_cachePath = path.str().str();
+        m_cache.reset(new PointerAnalysisCache(&M));
+        m_cacheHit = m_cache->load(m_cachePath, m_moduleHash);
+        if (m_cacheHit) {
+            ++NumPTACacheHits;
+            ++m_cacheHitsNum;
+            LLVM_DEBUG(llvm::dbgs() << "Pointer analysis results loaded from " << m_cachePath << "\n");
+            return false;
+        }
+        ++NumPTACacheMisses;
+        ++m_cacheMissesNum;
+    }
+    runAnalysis();
+    return false;
+}
+
+void SVFPointerAnalysisPass::releaseMemory()
+{
+    // users sharing results keep them alive
+    m_results.reset();
+    m_cache.reset();
+    m_cachePath.clear();
+    m_moduleHash.clear();
+    m_cacheHit = false;
+    m_module = nullptr;
+}
+
+void SVFPointerAnalysisPass::print(llvm::raw_ostream& OS, const llvm::Module* M) const
+{
+    OS << "Pointer analysis cache hits: " << m_cacheHitsNum
+       << ", misses: " << m_cacheMissesNum << "\n";
+}
+
+AndersenWaveDiff* SVFPointerAnalysisPass::getAndersen()
+{
+    if (!m_results) {
+        // cache hit, but full results are needed
+        runAnalysis();
+    }
+    return m_results->andersen.get();
+}
+
+PTACallGraph* SVFPointerAnalysisPass::getPTACallGraph()
+{
+    return getAndersen()->getPTACallGraph();
+}
+
+SVFG* SVFPointerAnalysisPass::getSVFG()
+{
+    auto* ander = getAndersen();
+    if (!m_results->svfg) {
+        m_results->svfgBuilder.reset(new SVFGBuilder(true));
+        m_results->svfg = m_results->svfgBuilder->buildSVFG((BVDataPTAImpl*)ander);
+    }
+    return m_results->svfg;
+}
+
+SVFPointerAnalysisPass::SVFGTy SVFPointerAnalysisPass::getSharedSVFG()
+{
+    auto* svfg = getSVFG();
+    return SVFGTy(m_results, svfg);
+}
+
+SVFPointerAnalysisPass::IndCSResultsTy SVFPointerAnalysisPass::getIndirectCallSiteResults()
+{
+    if (m_cache) {
+        return m_cache;
+    }
+    auto* callGraph = getPTACallGraph();
+    return IndCSResultsTy(new SVFGIndirectCallSiteResults(
+                std::shared_ptr<PTACallGraph>(m_results, callGraph)));
+}
+
+void SVFPointerAnalysisPass::runAnalysis()
+{
+    assert(m_module);
+    assert(!m_results);
+    m_results = std::make_shared<Results>();
+    m_results->svfModule.reset(new SVFModule(*m_module));
+    m_results->andersen.reset(new svfg::PDGAndersenWaveDiff());
+    m_results->andersen->disablePrintStat();
+    // runs to completion before any other analysis touches the module: it shares not thread safe
+    // DataLayout caches and LLVMContext with them, and SVF preprocessing may change the IR
+    m_results->andersen->analyze(*m_results->svfModule);
+    if (m_cache && !m_cacheHit) {
+        storeCache();
+    }
+}
+
+void SVFPointerAnalysisPass::storeCache()
+{
+    auto* callGraph = m_results->andersen->getPTACallGraph();
+    for (auto& F : *m_module) {
+        for (auto& I : llvm::instructions(F)) {
+            llvm::CallSite callSite(&I);
+            if (!callSite || !callGraph->hasIndCSCallees(callSite)) {
+                continue;
+            }
+            PointerAnalysisCache::FunctionSet callees;
+            for (auto* callee : callGraph->getIndCSCallees(callSite)) {
+                callees.insert(const_cast<llvm::Function*>(callee));
+            }
+            m_cache->addIndCSCallees(&I, callees);
+        }
+    }
+    if (!llvm::sys::fs::create_directories(pta_cache.getValue())
+            && m_cache->save(m_cachePath, m_moduleHash)) {
+        LLVM_DEBUG(llvm::dbgs() << "Pointer analysis results stored to " << m_cachePath << "\n");
+    } else {
+        llvm::errs() << "Failed to store pointer analysis results to " << m_cachePath << "\n";
+    }
+}
+
+} // namespace pdg
+
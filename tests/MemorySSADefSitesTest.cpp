@@ -0,0 +1,169 @@
+#include "PDGTestModule.h"
+
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+
+#include <set>
+#include <string>
+#include <unordered_set>
+
+// Def sites of loads reached by memory phis, found by memoized walks and by per location sweeps
+// (setPrecomputeDefSites), are compared with a plain recursive walk over MemorySSA.
+// Analyses of a function are released when it is finished, as pdg-build does.
+// Usage: memoryssa-def-sites-test
+
+namespace {
+
+using namespace pdg;
+
+/// Nested loops with several phis reading the same locations, appended to the shared test module
+const char* const LoopsIR = R"(
+define i32 @loops(i32* %p, i32* %q, i32 %n, i1 %c) {
+entry:
+  store i32 1, i32* %p
+  br label %outer
+outer:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  br i1 %c, label %left, label %right
+left:
+  store i32 2, i32* %q
+  br label %join
+right:
+  store i32 3, i32* %p
+  br label %join
+join:
+  %a = load i32, i32* %p
+  br label %inner
+inner:
+  %j = phi i32 [ 0, %join ], [ %j.next, %inner ]
+  %b = load i32, i32* %p
+  store i32 %b, i32* %q
+  %j.next = add i32 %j, 1
+  %inner.done = icmp sge i32 %j.next, %n
+  br i1 %inner.done, label %latch, label %inner
+latch:
+  %d = load i32, i32* %p
+  %i.next = add i32 %i, 1
+  %outer.done = icmp sge i32 %i.next, %n
+  br i1 %outer.done, label %exit, label %outer
+exit:
+  %e = load i32, i32* %p
+  %f = load i32, i32* %q
+  %r = add i32 %e, %f
+  ret i32 %r
+}
+)";
+
+using Values = std::set<llvm::Value*>;
+
+/// Definitions of the loaded location reachable from the access without passing another one
+void walk(llvm::MemoryAccess* access,
+          llvm::LoadInst* load,
+          llvm::MemorySSA* memorySSA,
+          llvm::AAResults* aa,
+          std::unordered_set<llvm::MemoryAccess*>& visited,
+          Values& defSites)
+{
+    if (!access || memorySSA->isLiveOnEntryDef(access) || !visited.insert(access).second) {
+        return;
+    }
+    if (auto* def = llvm::dyn_cast<llvm::MemoryDef>(access)) {
+        const uint64_t size = load->getModule()->getDataLayout().getTypeStoreSize(load->getType());
+        auto modRef = aa->getModRefInfo(def->getMemoryInst(), load->getPointerOperand(), size);
+        if (modRef == llvm::ModRefInfo::MustMod || modRef == llvm::ModRefInfo::Mod) {
+            defSites.insert(def->getMemoryInst());
+        } else {
+            walk(def->getDefiningAccess(), load, memorySSA, aa, visited, defSites);
+        }
+    } else if (auto* memPhi = llvm::dyn_cast<llvm::MemoryPhi>(access)) {
+        for (unsigned i = 0; i < memPhi->getNumIncomingValues(); ++i) {
+            walk(memPhi->getIncomingValue(i), load, memorySSA, aa, visited, defSites);
+        }
+    }
+}
+
+Values getDefSites(const DefUseResults::DefSite& defSite)
+{
+    if (defSite.isPhi()) {
+        return Values(defSite.phiValues.begin(), defSite.phiValues.end());
+    }
+    return defSite.value ? Values{defSite.value} : Values();
+}
+
+/// Checks def sites of all loads of the module, returns number of loads reached by memory phis
+unsigned checkDefSites(llvm::Module& M, bool precompute)
+{
+    FunctionAnalyses analyses(M);
+    auto* analysesPtr = &analyses;
+    LLVMMemorySSADefUseAnalysisResults defUse(
+            [analysesPtr] (llvm::Function* F) { return analysesPtr->getMemorySSA(F); },
+            [analysesPtr] (llvm::Function* F) { return analysesPtr->getAAResults(F); });
+    defUse.setPrecomputeDefSites(precompute);
+    defUse.setAAResultsReleaser([analysesPtr] (llvm::Function* F) { analysesPtr->release(F); });
+
+    unsigned phiLoadsNum = 0;
+    for (auto& F : M) {
+        if (F.isDeclaration()) {
+            continue;
+        }
+        analyses.computeDominance(&F);
+        auto* memorySSA = analyses.getMemorySSA(&F);
+        auto* aa = analyses.getAAResults(&F);
+        defUse.prepareFunction(&F);
+        for (auto& I : llvm::instructions(F)) {
+            auto* load = llvm::dyn_cast<llvm::LoadInst>(&I);
+            if (!load) {
+                continue;
+            }
+            auto* memoryUse = llvm::cast<llvm::MemoryUse>(memorySSA->getMemoryAccess(load));
+            auto* access = memoryUse->getDefiningAccess();
+            Values expected;
+            if (llvm::isa<llvm::MemoryPhi>(access)) {
+                ++phiLoadsNum;
+                std::unordered_set<llvm::MemoryAccess*> visited;
+                walk(access, load, memorySSA, aa, visited, expected);
+            } else if (!memorySSA->isLiveOnEntryDef(access)) {
+                expected.insert(llvm::cast<llvm::MemoryDef>(access)->getMemoryInst());
+            }
+            if (!PDG_TEST_CHECK(getDefSites(defUse.getDefNode(load)) == expected)) {
+                llvm::errs() << "  def sites of" << *load << " in " << F.getName()
+                             << (precompute ? ", precomputed\n" : ", walked\n");
+            }
+        }
+        defUse.finishFunction(&F);
+    }
+    const auto& statistics = defUse.getWalkStatistics();
+    if (precompute) {
+        PDG_TEST_CHECK(statistics.sweepsNum != 0);
+        PDG_TEST_CHECK(statistics.precomputedNum != 0);
+    } else {
+        PDG_TEST_CHECK(statistics.sweepsNum == 0);
+        PDG_TEST_CHECK(statistics.memoReusesNum + statistics.memoHitsNum != 0);
+    }
+    return phiLoadsNum;
+}
+
+} // unnamed namespace
+
+int main()
+{
+    llvm::LLVMContext context;
+    llvm::SMDiagnostic diagnostic;
+    const std::string IR = std::string(test::TestModuleIR) + LoopsIR;
+    auto M = llvm::parseAssemblyString(IR, diagnostic, context);
+    if (!M) {
+        diagnostic.print("test module", llvm::errs());
+        return 1;
+    }
+    PDG_TEST_CHECK(checkDefSites(*M, false) != 0);
+    PDG_TEST_CHECK(checkDefSites(*M, true) != 0);
+
+    const unsigned failuresNum = test::getFailuresNum();
+    if (failuresNum != 0) {
+        llvm::errs() << failuresNum << " checks failed\n";
+        return 1;
+    }
+    return 0;
+}
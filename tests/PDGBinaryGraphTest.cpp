@@ -0,0 +1,145 @@
+#include "PDGTestModule.h"
+
+#include "PDG/PDGBinaryGraph.h"
+#include "PDG/PDGBinaryWriter.h"
+#include "PDG/PDGLLVMNode.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Writes PDG of the test module in binary format, reads it back and compares
+// adjacency, node attributes and slices with the compact graph it was written from.
+// Usage: pdg-binary-graph-test <file to write>
+
+namespace {
+
+using namespace pdg;
+
+void checkNodes(const PDGCompactGraph& graph, const PDGBinaryGraph& binaryGraph)
+{
+    for (PDGEdge::NodeId id = 0; id < graph.size(); ++id) {
+        const auto* node = graph.getNode(id);
+        if (!node) {
+            continue;
+        }
+        PDG_TEST_CHECK(binaryGraph.getNodeKind(id) == unsigned(node->getNodeType()));
+        PDG_TEST_CHECK(binaryGraph.getNodeLabel(id) == node->getNodeAsString());
+        const uint32_t function = binaryGraph.getNodeFunction(id);
+        if (!node->hasParent()) {
+            PDG_TEST_CHECK(function == PDGBinaryGraph::InvalidIndex);
+            continue;
+        }
+        const std::string name = node->getParent()->getName().str();
+        if (PDG_TEST_CHECK(function != PDGBinaryGraph::InvalidIndex)) {
+            PDG_TEST_CHECK(binaryGraph.getFunctionName(function) == name);
+            PDG_TEST_CHECK(binaryGraph.findFunction(name) == function);
+        }
+    }
+}
+
+void checkAdjacency(const PDGCompactGraph& graph, const PDGBinaryGraph& binaryGraph)
+{
+    // implicit block membership edges are expanded in place, so order of adjacent nodes is kept
+    for (PDGEdge::NodeId id = 0; id < graph.size(); ++id) {
+        const auto successors = binaryGraph.getSuccessors(id);
+        unsigned i = 0;
+        for (auto it = graph.succBegin(id); it != graph.succEnd(id); ++it, ++i) {
+            if (!PDG_TEST_CHECK(i < successors.size)) {
+                break;
+            }
+            PDG_TEST_CHECK(successors.nodes[i] == it.getNodeId());
+            PDG_TEST_CHECK(successors.kinds[i] == it.getEdgeKind());
+        }
+        PDG_TEST_CHECK(i == successors.size);
+
+        const auto predecessors = binaryGraph.getPredecessors(id);
+        i = 0;
+        for (auto it = graph.predBegin(id); it != graph.predEnd(id); ++it, ++i) {
+            if (!PDG_TEST_CHECK(i < predecessors.size)) {
+                break;
+            }
+            PDG_TEST_CHECK(predecessors.nodes[i] == it.getNodeId());
+            PDG_TEST_CHECK(predecessors.kinds[i] == it.getEdgeKind());
+        }
+        PDG_TEST_CHECK(i == predecessors.size);
+    }
+}
+
+void checkParallelEdges(const PDGCompactGraph& graph)
+{
+    // freezing merges edges added twice by different build stages
+    for (PDGEdge::NodeId id = 0; id < graph.size(); ++id) {
+        std::vector<std::pair<PDGEdge::NodeId, unsigned>> edges;
+        for (auto it = graph.succBegin(id); it != graph.succEnd(id); ++it) {
+            edges.emplace_back(it.getNodeId(), it.getEdgeKind());
+        }
+        std::sort(edges.begin(), edges.end());
+        PDG_TEST_CHECK(std::adjacent_find(edges.begin(), edges.end()) == edges.end());
+    }
+}
+
+void checkSlices(const PDGCompactGraph& graph, const PDGBinaryGraph& binaryGraph)
+{
+    for (PDGEdge::NodeId id = 0; id < graph.size(); ++id) {
+        if (!graph.getNode(id)) {
+            continue;
+        }
+        for (auto kinds : test::TestEdgeKinds) {
+            PDG_TEST_CHECK(test::getSortedSet(binaryGraph.forwardSlice(id, kinds))
+                           == test::getSortedSet(graph.forwardSlice(id, kinds)));
+            PDG_TEST_CHECK(test::getSortedSet(binaryGraph.backwardSlice(id, kinds))
+                           == test::getSortedSet(graph.backwardSlice(id, kinds)));
+        }
+    }
+}
+
+} // unnamed namespace
+
+int main(int argc, char** argv)
+{
+    if (argc != 2) {
+        llvm::errs() << "usage: " << argv[0] << " <file to write>\n";
+        return 2;
+    }
+    const std::string path = argv[1];
+
+    test::TestModule testModule;
+    auto builder = testModule.createBuilder();
+    builder->build();
+    auto pdg = builder->getPDG();
+    pdg->freeze();
+    const auto* graph = pdg->getCompactGraph();
+    // the module should exercise implicit edges, otherwise their expansion is not tested
+    PDG_TEST_CHECK(graph->implicitEdgesSize() != 0);
+    PDG_TEST_CHECK(graph->edgesSize() == pdg->getEdgesNum());
+    checkParallelEdges(*graph);
+
+    PDGBinaryWriter writer(*pdg);
+    if (!PDG_TEST_CHECK(writer.write(path))) {
+        return 1;
+    }
+    PDGBinaryGraph binaryGraph;
+    if (!binaryGraph.open(path)) {
+        llvm::errs() << "can not open " << path << ": " << binaryGraph.getError() << "\n";
+        return 1;
+    }
+    PDG_TEST_CHECK(binaryGraph.size() == graph->size());
+    PDG_TEST_CHECK(binaryGraph.edgesSize() == graph->edgesSize() + graph->implicitEdgesSize());
+    if (binaryGraph.size() == graph->size()) {
+        checkNodes(*graph, binaryGraph);
+        checkAdjacency(*graph, binaryGraph);
+        checkSlices(*graph, binaryGraph);
+    }
+    binaryGraph.close();
+    std::remove(path.c_str());
+
+    const unsigned failuresNum = test::getFailuresNum();
+    if (failuresNum != 0) {
+        llvm::errs() << failuresNum << " checks failed\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,163 @@
+#include "PDGTestModule.h"
+
+#include "PDG/FunctionPDG.h"
+#include "PDG/PDGLLVMNode.h"
+#include "PDG/PDGPagedGraph.h"
+#include "PDG/PDGPagedWriter.h"
+
+#include <cstdio>
+#include <string>
+
+// Writes PDG of the test module in paged format, reads it back and compares node attributes,
+// adjacency and slices with the compact graph of the same PDG. Pages are read once with the
+// default memory budget and once with zero budget, which evicts pages on every page switch.
+// Usage: pdg-paged-graph-test <file to write>
+
+namespace {
+
+using namespace pdg;
+
+void checkNodes(const PDG& pdg, PDGPagedGraph& pagedGraph)
+{
+    for (PDGEdge::NodeId id = 0; id < pdg.size(); ++id) {
+        const auto* node = pdg.getNode(id);
+        PDG_TEST_CHECK(pagedGraph.hasNode(id) == (node != nullptr));
+        if (!node) {
+            continue;
+        }
+        PDG_TEST_CHECK(pagedGraph.getNodeKind(id) == unsigned(node->getNodeType()));
+        PDG_TEST_CHECK(pagedGraph.getNodeLabel(id) == node->getNodeAsString());
+        // interfaces of declarations are left to the module page
+        const uint32_t function = pagedGraph.getNodeFunction(id);
+        if (function == PDGPagedGraph::InvalidIndex) {
+            continue;
+        }
+        // constants are pages of functions using them, but do not have a parent
+        if (node->hasParent()) {
+            PDG_TEST_CHECK(pagedGraph.getFunctionName(function) == node->getParent()->getName().str());
+        } else {
+            PDG_TEST_CHECK(llvm::isa<PDGLLVMConstantNode>(node) || llvm::isa<PDGNullNode>(node));
+        }
+    }
+
+    for (const auto& item : pdg.getFunctionPDGs()) {
+        if (item.first->isDeclaration()) {
+            continue;
+        }
+        const uint32_t function = pagedGraph.findFunction(item.first->getName().str());
+        if (!PDG_TEST_CHECK(function != PDGPagedGraph::InvalidIndex)) {
+            continue;
+        }
+        PDGPagedGraph::NodeIds nodeIds;
+        for (auto it = item.second->nodesBegin(); it != item.second->nodesEnd(); ++it) {
+            nodeIds.push_back((*it)->getNodeId());
+            PDG_TEST_CHECK(pagedGraph.getNodeFunction((*it)->getNodeId()) == function);
+        }
+        PDG_TEST_CHECK(test::getSortedSet(pagedGraph.getFunctionNodes(function)) == test::getSortedSet(nodeIds));
+    }
+}
+
+void checkAdjacency(const PDGCompactGraph& graph, PDGPagedGraph& pagedGraph)
+{
+    // block membership edges become ordinary control edges of pages, order of adjacent nodes is not kept
+    for (PDGEdge::NodeId id = 0; id < graph.size(); ++id) {
+        if (!graph.getNode(id)) {
+            continue;
+        }
+        for (auto kinds : test::TestEdgeKinds) {
+            PDG_TEST_CHECK(test::getSortedSet(pagedGraph.getSuccessors(id, kinds))
+                           == test::getSortedSet(test::getAdjacent(graph, id, kinds, true)));
+            PDG_TEST_CHECK(test::getSortedSet(pagedGraph.getPredecessors(id, kinds))
+                           == test::getSortedSet(test::getAdjacent(graph, id, kinds, false)));
+        }
+    }
+}
+
+void checkSlices(const PDGCompactGraph& graph, PDGPagedGraph& pagedGraph)
+{
+    for (PDGEdge::NodeId id = 0; id < graph.size(); ++id) {
+        if (!graph.getNode(id)) {
+            continue;
+        }
+        for (auto kinds : test::TestEdgeKinds) {
+            PDG_TEST_CHECK(test::getSortedSet(pagedGraph.forwardSlice(id, kinds))
+                           == test::getSortedSet(graph.forwardSlice(id, kinds)));
+            PDG_TEST_CHECK(test::getSortedSet(pagedGraph.backwardSlice(id, kinds))
+                           == test::getSortedSet(graph.backwardSlice(id, kinds)));
+        }
+    }
+}
+
+bool checkPagedGraph(const PDG& pdg, const std::string& path, PDGPagedGraph& pagedGraph)
+{
+    if (!pagedGraph.open(path)) {
+        llvm::errs() << "can not open " << path << ": " << pagedGraph.getError() << "\n";
+        return false;
+    }
+    const auto* graph = pdg.getCompactGraph();
+    if (!PDG_TEST_CHECK(pagedGraph.size() == graph->size())) {
+        return false;
+    }
+    checkNodes(pdg, pagedGraph);
+    checkAdjacency(*graph, pagedGraph);
+    checkSlices(*graph, pagedGraph);
+    return true;
+}
+
+} // unnamed namespace
+
+int main(int argc, char** argv)
+{
+    if (argc != 2) {
+        llvm::errs() << "usage: " << argv[0] << " <file to write>\n";
+        return 2;
+    }
+    const std::string path = argv[1];
+
+    test::TestModule testModule;
+    auto builder = testModule.createBuilder();
+    builder->build();
+    auto pdg = builder->getPDG();
+
+    // writer reads edges of nodes, so pages are written before the graph is frozen.
+    // Node ids are kept, which lets paged graph be compared with the compact graph by id
+    PDGPagedWriter writer(path);
+    if (!PDG_TEST_CHECK(writer.isOpen())) {
+        return 1;
+    }
+    for (const auto& item : pdg->getFunctionPDGs()) {
+        if (!item.first->isDeclaration()) {
+            writer.addFunction(*item.second);
+        }
+    }
+    if (!PDG_TEST_CHECK(writer.finish(*pdg))) {
+        return 1;
+    }
+    pdg->freeze();
+    PDG_TEST_CHECK(pdg->getCompactGraph()->implicitEdgesSize() != 0);
+
+    PDGPagedGraph pagedGraph;
+    if (checkPagedGraph(*pdg, path, pagedGraph)) {
+        PDG_TEST_CHECK(pagedGraph.getStatistics().evictionsNum == 0);
+    }
+
+    // every page switch evicts the previous page, results should not change
+    PDGPagedGraph evictingGraph;
+    evictingGraph.setMemoryBudget(0);
+    if (checkPagedGraph(*pdg, path, evictingGraph)) {
+        const auto& statistics = evictingGraph.getStatistics();
+        PDG_TEST_CHECK(statistics.evictionsNum != 0);
+        PDG_TEST_CHECK(statistics.missesNum > evictingGraph.functionsSize() + 1);
+        PDG_TEST_CHECK(statistics.residentSize < pagedGraph.getStatistics().residentSize);
+    }
+    pagedGraph.close();
+    evictingGraph.close();
+    std::remove(path.c_str());
+
+    const unsigned failuresNum = test::getFailuresNum();
+    if (failuresNum != 0) {
+        llvm::errs() << failuresNum << " checks failed\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include "PDGTestModule.h"
+
+// Builds PDG of the test module serially and with several threads and compares the graphs.
+// Node ids depend on the build mode, so graphs are compared by keys of nodes and edges.
+// Usage: pdg-parallel-build-test
+
+int main()
+{
+    using namespace pdg;
+
+    test::TestModule testModule;
+    auto serialBuilder = testModule.createBuilder();
+    serialBuilder->build();
+    auto serialPDG = serialBuilder->getPDG();
+    serialPDG->freeze();
+
+    auto parallelBuilder = testModule.createBuilder();
+    parallelBuilder->setThreadsNum(4);
+    parallelBuilder->build();
+    auto parallelPDG = parallelBuilder->getPDG();
+    parallelPDG->freeze();
+
+    PDG_TEST_CHECK(parallelPDG->size() == serialPDG->size());
+    PDG_TEST_CHECK(parallelPDG->getEdgesNum() == serialPDG->getEdgesNum());
+    // every module level value has one node, however many functions refer to it
+    for (auto& global : testModule.getModule()->globals()) {
+        PDG_TEST_CHECK(parallelPDG->hasNode(&global));
+    }
+    const auto serialKeys = test::getGraphKeys(*serialPDG);
+    const auto parallelKeys = test::getGraphKeys(*parallelPDG);
+    PDG_TEST_CHECK(parallelKeys.nodes == serialKeys.nodes);
+    PDG_TEST_CHECK(parallelKeys.edges == serialKeys.edges);
+
+    const unsigned failuresNum = test::getFailuresNum();
+    if (failuresNum != 0) {
+        llvm::errs() << failuresNum << " checks failed\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,262 @@
+#pragma once
+
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "PDG/FunctionAnalyses.h"
+#include "PDG/FunctionPDG.h"
+#include "PDG/IndirectCallSitesAnalysis.h"
+#include "PDG/LLVMDominanceIntervals.h"
+#include "PDG/LLVMMemorySSADefUseAnalysisResults.h"
+#include "PDG/PDG.h"
+#include "PDG/PDGBuilder.h"
+#include "PDG/PDGCompactGraph.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Helpers shared by tests: a small module exercising every kind of edge and a builder for it.
+// Tests are plain executables, failed checks are reported and make main return non-zero.
+
+namespace pdg {
+namespace test {
+
+/// Calls, indirect calls, memory accesses through arguments and globals, branches and a loop
+const char* const TestModuleIR = R"(
+@counter = global i32 0
+@table = global [4 x i32] zeroinitializer
+
+declare i32 @external(i32)
+
+define i32 @increment(i32* %p, i32 %x) {
+entry:
+  %old = load i32, i32* %p
+  %new = add i32 %old, %x
+  store i32 %new, i32* %p
+  %positive = icmp sgt i32 %new, 0
+  br i1 %positive, label %then, label %exit
+then:
+  store i32 %new, i32* @counter
+  br label %exit
+exit:
+  %result = load i32, i32* @counter
+  ret i32 %result
+}
+
+define i32 @decrement(i32* %p, i32 %x) {
+entry:
+  %old = load i32, i32* %p
+  %new = sub i32 %old, %x
+  store i32 %new, i32* %p
+  ret i32 %new
+}
+
+define i32 @sum(i32 %n, i32 (i32*, i32)* %step) {
+entry:
+  %acc = alloca i32
+  store i32 0, i32* %acc
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %body ]
+  %done = icmp sge i32 %i, %n
+  br i1 %done, label %exit, label %body
+body:
+  %slot = getelementptr [4 x i32], [4 x i32]* @table, i32 0, i32 %i
+  %value = load i32, i32* %slot
+  %r = call i32 %step(i32* %acc, i32 %value)
+  %next = add i32 %i, 1
+  br label %loop
+exit:
+  %total = load i32, i32* %acc
+  %e = call i32 @external(i32 %total)
+  ret i32 %e
+}
+
+define i32 @main(i32 %argc) {
+entry:
+  %odd = and i32 %argc, 1
+  %is_odd = icmp ne i32 %odd, 0
+  br i1 %is_odd, label %up, label %down
+up:
+  %a = call i32 @sum(i32 %argc, i32 (i32*, i32)* @increment)
+  br label %exit
+down:
+  %b = call i32 @sum(i32 %argc, i32 (i32*, i32)* @decrement)
+  br label %exit
+exit:
+  %r = phi i32 [ %a, %up ], [ %b, %down ]
+  ret i32 %r
+}
+)";
+
+/// Edge kind masks queries are checked with
+const PDGEdge::EdgeKinds TestEdgeKinds[] = {
+    PDGEdge::AnyEdge,
+    PDGEdge::DataEdges,
+    PDGEdge::ControlEdges,
+    PDGEdge::MemoryEdge,
+    PDGEdge::ParameterInEdge | PDGEdge::CallEdge
+};
+
+inline unsigned& getFailuresNum()
+{
+    static unsigned failuresNum = 0;
+    return failuresNum;
+}
+
+inline bool check(bool condition, const char* expression, const char* file, int line)
+{
+    if (!condition) {
+        llvm::errs() << file << ":" << line << ": check failed: " << expression << "\n";
+        ++getFailuresNum();
+    }
+    return condition;
+}
+
+#define PDG_TEST_CHECK(condition) ::pdg::test::check((condition), #condition, __FILE__, __LINE__)
+
+/// Owns parsed test module and analyses the builder queries
+class TestModule
+{
+public:
+    using DefUseResultsTy = PDGBuilder::DefUseResultsTy;
+    using IndCSResultsTy = PDGBuilder::IndCSResultsTy;
+    using DominanceResultsTy = PDGBuilder::DominanceResultsTy;
+
+public:
+    TestModule()
+    {
+        llvm::SMDiagnostic diagnostic;
+        m_module = llvm::parseAssemblyString(TestModuleIR, diagnostic, m_context);
+        if (!m_module) {
+            diagnostic.print("test module", llvm::errs());
+            std::abort();
+        }
+        m_analyses.reset(new FunctionAnalyses(*m_module));
+    }
+
+    TestModule(const TestModule& ) = delete;
+    TestModule(TestModule&& ) = delete;
+    TestModule& operator =(const TestModule& ) = delete;
+    TestModule& operator =(TestModule&& ) = delete;
+
+public:
+    llvm::Module* getModule()
+    {
+        return m_module.get();
+    }
+
+    /// Builder with LLVM MemorySSA def-use, dominance intervals and type based indirect call targets
+    std::unique_ptr<PDGBuilder> createBuilder()
+    {
+        auto* analyses = m_analyses.get();
+        auto memSSAGetter = [analyses] (llvm::Function* F) {
+            return analyses->getMemorySSA(F);
+        };
+        auto aliasAnalysisResGetter = [analyses] (llvm::Function* F) {
+            return analyses->getAAResults(F);
+        };
+        auto domTreeGetter = [analyses] (llvm::Function* F) {
+            return analyses->getDomTree(F);
+        };
+        auto postdomTreeGetter = [analyses] (llvm::Function* F) {
+            return analyses->getPostDomTree(F);
+        };
+        auto typeResults = std::make_shared<IndirectCallSiteAnalysisResult>();
+        for (auto& F : *m_module) {
+            if (!F.isDeclaration()) {
+                typeResults->addIndirectCallTarget(F.getFunctionType(), &F);
+            }
+        }
+
+        std::unique_ptr<PDGBuilder> builder(new PDGBuilder(m_module.get()));
+        builder->setDesUseResults(DefUseResultsTy(new LLVMMemorySSADefUseAnalysisResults(memSSAGetter,
+                                                                                          aliasAnalysisResGetter)));
+        builder->setIndirectCallSitesResults(typeResults);
+        builder->setDominanceResults(DominanceResultsTy(new LLVMDominanceIntervals(domTreeGetter,
+                                                                                   postdomTreeGetter)));
+        builder->setFunctionMaterializer([analyses] (llvm::Function* F) {
+            analyses->computeDominance(F);
+            return true;
+        });
+        return builder;
+    }
+
+private:
+    llvm::LLVMContext m_context;
+    std::unique_ptr<llvm::Module> m_module;
+    std::unique_ptr<FunctionAnalyses> m_analyses;
+}; // class TestModule
+
+/// Adjacent node ids of a node in the compact graph, restricted to edges of given kinds
+inline PDGCompactGraph::NodeIds getAdjacent(const PDGCompactGraph& graph,
+                                            PDGCompactGraph::NodeId id,
+                                            PDGEdge::EdgeKinds kinds,
+                                            bool forward)
+{
+    PDGCompactGraph::NodeIds adjacent;
+    auto it = forward ? graph.succBegin(id, kinds) : graph.predBegin(id, kinds);
+    const auto end = forward ? graph.succEnd(id, kinds) : graph.predEnd(id, kinds);
+    for (; it != end; ++it) {
+        adjacent.push_back(it.getNodeId());
+    }
+    return adjacent;
+}
+
+/// Node ids sorted and deduplicated, for comparing results which do not define order
+inline std::vector<PDGEdge::NodeId> getSortedSet(std::vector<PDGEdge::NodeId> ids)
+{
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
+
+/// Sorted keys of nodes and edges of a frozen PDG. Node ids depend on how the graph was built,
+/// so nodes are keyed by kind, owning function and label, and edges by keys of their ends
+struct GraphKeys
+{
+    std::vector<std::string> nodes;
+    std::vector<std::string> edges;
+};
+
+inline GraphKeys getGraphKeys(const PDG& pdg)
+{
+    std::unordered_map<PDGEdge::NodeId, std::string> functionNames;
+    for (const auto& item : pdg.getFunctionPDGs()) {
+        for (auto it = item.second->nodesBegin(); it != item.second->nodesEnd(); ++it) {
+            functionNames[(*it)->getNodeId()] = item.first->getName().str();
+        }
+    }
+    const auto* graph = pdg.getCompactGraph();
+    std::vector<std::string> nodeKeys(graph->size());
+    GraphKeys keys;
+    for (PDGEdge::NodeId id = 0; id < graph->size(); ++id) {
+        const auto* node = graph->getNode(id);
+        if (!node) {
+            continue;
+        }
+        nodeKeys[id] = std::to_string(node->getNodeType()) + "|" + functionNames[id] + "|"
+                       + node->getNodeAsString();
+        keys.nodes.push_back(nodeKeys[id]);
+    }
+    for (PDGEdge::NodeId id = 0; id < graph->size(); ++id) {
+        for (auto it = graph->succBegin(id); it != graph->succEnd(id); ++it) {
+            keys.edges.push_back(nodeKeys[id] + " -" + std::to_string(it.getEdgeKind()) + "-> "
+                                 + nodeKeys[it.getNodeId()]);
+        }
+    }
+    std::sort(keys.nodes.begin(), keys.nodes.end());
+    std::sort(keys.edges.begin(), keys.edges.end());
+    return keys;
+}
+
+} // namespace test
+} // namespace pdg
@@ -0,0 +1,125 @@
+#include "PDGTestModule.h"
+
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Verifier.h"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+// Builds PDG of the test module, edits function bodies in place, updates the PDG and compares it
+// with a fresh build of the edited module. Graphs are compared by keys of nodes and edges.
+// Usage: pdg-update-test
+
+namespace {
+
+using namespace pdg;
+
+llvm::Instruction* findInstruction(llvm::Function* F, const char* name)
+{
+    for (auto& I : llvm::instructions(*F)) {
+        if (I.getName() == name) {
+            return &I;
+        }
+    }
+    return nullptr;
+}
+
+/// Replaces the instruction with a copy created by the callback, which is given an IR builder
+/// positioned before it
+template <typename CreateCopy>
+void replaceInstruction(llvm::Instruction* I, CreateCopy createCopy)
+{
+    llvm::IRBuilder<> irBuilder(I);
+    llvm::Value* copy = createCopy(irBuilder);
+    I->replaceAllUsesWith(copy);
+    copy->takeName(I);
+    I->eraseFromParent();
+}
+
+void editModule(llvm::Module* M)
+{
+    // different operation: fingerprint changes
+    auto* sub = llvm::cast<llvm::BinaryOperator>(findInstruction(M->getFunction("decrement"), "new"));
+    replaceInstruction(sub, [sub] (llvm::IRBuilder<>& irBuilder) {
+        return irBuilder.CreateMul(sub->getOperand(0), sub->getOperand(1));
+    });
+
+    // new definition of memory read later: fingerprint and memory def-use change
+    auto* increment = M->getFunction("increment");
+    llvm::IRBuilder<> irBuilder(findInstruction(increment, "result"));
+    irBuilder.CreateStore(&*std::next(increment->arg_begin()), M->getGlobalVariable("counter"));
+
+    // equal copy: fingerprint stays, nodes are keyed by the erased instruction
+    auto* odd = llvm::cast<llvm::BinaryOperator>(findInstruction(M->getFunction("main"), "odd"));
+    replaceInstruction(odd, [odd] (llvm::IRBuilder<>& irBuilder) {
+        return irBuilder.CreateAnd(odd->getOperand(0), odd->getOperand(1));
+    });
+}
+
+std::vector<std::string> getSortedNames(const std::vector<llvm::Function*>& functions)
+{
+    std::vector<std::string> names;
+    for (auto* F : functions) {
+        names.push_back(F->getName().str());
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+} // unnamed namespace
+
+int main()
+{
+    test::TestModule testModule;
+    auto* M = testModule.getModule();
+    auto builder = testModule.createBuilder();
+    builder->build();
+    auto linkResults = builder->getLinkResults();
+    auto pdg = builder->getPDG();
+    pdg->freeze();
+
+    const uint64_t mainFingerprint = PDGBuilder::computeFingerprint(M->getFunction("main"));
+    editModule(M);
+    if (!PDG_TEST_CHECK(!llvm::verifyModule(*M, &llvm::errs()))) {
+        return 1;
+    }
+    // fingerprint of the body with an equal copy of an instruction stays
+    PDG_TEST_CHECK(PDGBuilder::computeFingerprint(M->getFunction("main")) == mainFingerprint);
+
+    auto updater = testModule.createBuilder();
+    updater->setLinkResults(linkResults);
+    const auto results = updater->update(pdg);
+    PDG_TEST_CHECK(pdg->isFrozen());
+    PDG_TEST_CHECK(getSortedNames(results.reusedFunctions) == std::vector<std::string>({"sum"}));
+    PDG_TEST_CHECK(getSortedNames(results.rebuiltFunctions)
+                   == std::vector<std::string>({"decrement", "increment", "main"}));
+    PDG_TEST_CHECK(results.addedFunctions.empty());
+
+    auto freshBuilder = testModule.createBuilder();
+    freshBuilder->build();
+    auto freshPDG = freshBuilder->getPDG();
+    freshPDG->freeze();
+
+    const auto updatedKeys = test::getGraphKeys(*pdg);
+    const auto freshKeys = test::getGraphKeys(*freshPDG);
+    PDG_TEST_CHECK(updatedKeys.nodes == freshKeys.nodes);
+    PDG_TEST_CHECK(updatedKeys.edges == freshKeys.edges);
+
+    // nothing changed since, everything is reused
+    auto secondUpdater = testModule.createBuilder();
+    secondUpdater->setLinkResults(linkResults);
+    const auto secondResults = secondUpdater->update(pdg);
+    PDG_TEST_CHECK(secondResults.reusedFunctions.size() == 4);
+    PDG_TEST_CHECK(secondResults.rebuiltFunctions.empty());
+    PDG_TEST_CHECK(test::getGraphKeys(*pdg).edges == freshKeys.edges);
+
+    const unsigned failuresNum = test::getFailuresNum();
+    if (failuresNum != 0) {
+        llvm::errs() << failuresNum << " checks failed\n";
+        return 1;
+    }
+    return 0;
+}
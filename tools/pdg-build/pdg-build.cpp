@@ -0,0 +1,480 @@
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "PDG/FunctionAnalyses.h"
+#include "PDG/FunctionPDG.h"
+#include "PDG/IndirectCallSitesAnalysis.h"
+#include "PDG/LLVMDominanceIntervals.h"
+#include "PDG/LLVMMemorySSADefUseAnalysisResults.h"
+#include "PDG/PDG.h"
+#include "PDG/PDGBinaryWriter.h"
+#include "PDG/PDGBuilder.h"
+#include "PDG/PDGPagedWriter.h"
+#include "PDG/SVFGDefUseAnalysisResults.h"
+#include "PDG/SVFGIndirectCallSiteResults.h"
+
+#include "SVF/MSSA/SVFG.h"
+#include "SVF/MSSA/SVFGBuilder.h"
+#include "SVF/Util/SVFModule.h"
+#include "SVF/MemoryModel/PointerAnalysis.h"
+#include "SVF/WPA/Andersen.h"
+#include "SVF/PDG/PDGPointerAnalysis.h"
+
+#include <cassert>
+#include <memory>
+#include <thread>
+#include <unordered_set>
+
+// Builds PDG of a bitcode file outside of opt.
+// Bitcode is loaded lazily and function bodies are materialized when the builder gets to them.
+// SVF analyses work on the whole module and need all bodies materialized upfront, which defeats
+// lazy loading; selecting any of them requires -materialize-all. The defaults, -def-use=llvm and
+// -indirect-calls=types, keep loading lazy. Function analyses are freed as soon as memory uses of
+// the function are connected.
+// Andersen analysis then runs on a thread of its own, overlapped with building function PDGs
+// when the whole module is built at once.
+
+namespace {
+
+enum DefUseBackend {
+    LLVMDefUse,
+    SVFGDefUse
+};
+
+enum IndirectCallsBackend {
+    SVFIndirectCalls,
+    TypeIndirectCalls
+};
+
+llvm::cl::opt<std::string> InputFilename(
+    llvm::cl::Positional,
+    llvm::cl::desc("<input bitcode>"),
+    llvm::cl::Required);
+
+llvm::cl::opt<std::string> OutputFilename(
+    "o",
+    llvm::cl::desc("Write PDG in binary format to the given file"),
+    llvm::cl::value_desc("filename"));
+
+llvm::cl::opt<DefUseBackend> DefUse(
+    "def-use",
+    llvm::cl::desc("Def-use analysis to use"),
+    llvm::cl::values(clEnumValN(LLVMDefUse, "llvm", "LLVM MemorySSA"),
+                     clEnumValN(SVFGDefUse, "svfg", "SVF sparse value flow graph")),
+    llvm::cl::init(LLVMDefUse));
+
+llvm::cl::opt<IndirectCallsBackend> IndirectCalls(
+    "indirect-calls",
+    llvm::cl::desc("Analysis resolving indirect call targets"),
+    llvm::cl::values(clEnumValN(SVFIndirectCalls, "svf", "SVF Andersen call graph"),
+                     clEnumValN(TypeIndirectCalls, "types", "all defined functions of matching type")),
+    llvm::cl::init(TypeIndirectCalls));
+
+llvm::cl::opt<bool> MaterializeAll(
+    "materialize-all",
+    llvm::cl::desc("Load all function bodies upfront, required by SVF analyses"),
+    llvm::cl::init(false));
+
+llvm::cl::opt<unsigned> ThreadsNum(
+    "threads",
+    llvm::cl::desc("Number of threads building function PDGs"),
+    llvm::cl::init(1));
+
+llvm::cl::opt<bool> PrecomputeDefSites(
+    "precompute-def-sites",
+    llvm::cl::desc("Compute MemorySSA def sites of all loads of a function in one sweep per location, "
+                   "instead of walking for each load"),
+    llvm::cl::init(true));
+
+llvm::cl::list<std::string> FunctionNames(
+    "function",
+    llvm::cl::desc("Build PDGs of given functions only, other functions are left pending"),
+    llvm::cl::value_desc("name"),
+    llvm::cl::CommaSeparated);
+
+llvm::cl::opt<std::string> StreamFilename(
+    "stream",
+    llvm::cl::desc("Build functions one at a time and write each as a JSON line to the given file, "
+                   "freeing it afterwards"),
+    llvm::cl::value_desc("filename"));
+
+llvm::cl::opt<std::string> PagedFilename(
+    "paged-output",
+    llvm::cl::desc("Build functions one at a time and write PDG in paged format to the given file, "
+                   "freeing each function afterwards"),
+    llvm::cl::value_desc("filename"));
+
+llvm::cl::list<std::string> RootPatterns(
+    "roots",
+    llvm::cl::desc("Build PDGs of functions reachable from the given functions only, names or regular expressions"),
+    llvm::cl::value_desc("pattern"),
+    llvm::cl::CommaSeparated);
+
+/// Writes each function PDG as one JSON object per line:
+/// {"function": name, "nodes": [[id, kind, label], ...], "edges": [[source, destination, kind], ...]}
+class FunctionPDGJSONWriter
+{
+public:
+    explicit FunctionPDGJSONWriter(llvm::raw_ostream& os)
+        : m_os(os)
+    {
+    }
+
+    FunctionPDGJSONWriter(const FunctionPDGJSONWriter& ) = delete;
+    FunctionPDGJSONWriter(FunctionPDGJSONWriter&& ) = delete;
+    FunctionPDGJSONWriter& operator =(const FunctionPDGJSONWriter& ) = delete;
+    FunctionPDGJSONWriter& operator =(FunctionPDGJSONWriter&& ) = delete;
+
+public:
+    void write(pdg::FunctionPDG& functionPDG)
+    {
+        std::unordered_set<pdg::PDGNode::NodeId> functionNodeIds;
+        for (auto it = functionPDG.nodesBegin(); it != functionPDG.nodesEnd(); ++it) {
+            functionNodeIds.insert((*it)->getNodeId());
+        }
+        m_os << "{\"function\": ";
+        writeString(functionPDG.getFunction()->getName());
+        m_os << ", \"nodes\": [";
+        const char* separator = "";
+        for (auto it = functionPDG.nodesBegin(); it != functionPDG.nodesEnd(); ++it) {
+            m_os << separator << "[" << (*it)->getNodeId() << ", " << (*it)->getNodeType() << ", ";
+            writeString((*it)->getNodeAsString());
+            m_os << "]";
+            separator = ", ";
+        }
+        m_os << "], \"edges\": [";
+        separator = "";
+        for (auto it = functionPDG.nodesBegin(); it != functionPDG.nodesEnd(); ++it) {
+            for (const auto& edge : (*it)->getOutEdges()) {
+                writeEdge(edge, separator);
+            }
+            // implicit control edge from the block of the node
+            if ((*it)->hasBlockNode()) {
+                writeEdge(pdg::PDGEdge((*it)->getBlockNodeId(), (*it)->getNodeId(), pdg::PDGEdge::ControlEdge),
+                          separator);
+            }
+            // edges from module level nodes and interfaces of other functions
+            for (const auto& edge : (*it)->getInEdges()) {
+                if (functionNodeIds.find(edge.getSourceId()) == functionNodeIds.end()) {
+                    writeEdge(edge, separator);
+                }
+            }
+        }
+        m_os << "]}\n";
+    }
+
+private:
+    void writeEdge(const pdg::PDGEdge& edge, const char*& separator)
+    {
+        m_os << separator << "[" << edge.getSourceId() << ", " << edge.getDestinationId()
+             << ", " << unsigned(edge.getKind()) << "]";
+        separator = ", ";
+    }
+
+    void writeString(llvm::StringRef str)
+    {
+        m_os << '"';
+        for (char c : str) {
+            if (c == '"' || c == '\\') {
+                m_os << '\\' << c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                m_os << "\\u00";
+                m_os.write_hex(static_cast<unsigned char>(c) >> 4);
+                m_os.write_hex(c & 0xf);
+            } else {
+                m_os << c;
+            }
+        }
+        m_os << '"';
+    }
+
+private:
+    llvm::raw_ostream& m_os;
+}; // class FunctionPDGJSONWriter
+
+/// Runs a task on its own thread and joins it at the latest when leaving the scope,
+/// so that early returns do not leave a joinable thread behind
+class JoiningThread
+{
+public:
+    JoiningThread() = default;
+    ~JoiningThread()
+    {
+        join();
+    }
+
+    JoiningThread(const JoiningThread& ) = delete;
+    JoiningThread(JoiningThread&& ) = delete;
+    JoiningThread& operator =(const JoiningThread& ) = delete;
+    JoiningThread& operator =(JoiningThread&& ) = delete;
+
+public:
+    template <typename Task>
+    void start(Task task)
+    {
+        assert(!m_thread.joinable());
+        m_thread = std::thread(task);
+    }
+
+    /// Returns false if there was nothing to wait for
+    bool join()
+    {
+        if (!m_thread.joinable()) {
+            return false;
+        }
+        m_thread.join();
+        return true;
+    }
+
+private:
+    std::thread m_thread;
+}; // class JoiningThread
+
+void printDefUseStatistics(const pdg::LLVMMemorySSADefUseAnalysisResults* defUse)
+{
+    if (!defUse) {
+        return;
+    }
+    const auto& statistics = defUse->getWalkStatistics();
+    llvm::errs() << "MemorySSA def site queries: " << statistics.queriesNum
+                 << ", memo hit rate: " << llvm::format("%.2f", statistics.getHitRate() * 100) << "%"
+                 << ", memo reuses in walks: " << statistics.memoReusesNum
+                 << ", average walk length: " << llvm::format("%.2f", statistics.getAverageWalkLength())
+                 << ", longest walk: " << statistics.longestWalk
+                 << ", precomputed: " << statistics.precomputedNum
+                 << " in " << statistics.sweepsNum << " sweeps\n";
+    const auto& cacheStatistics = defUse->getModRefCacheStatistics();
+    llvm::errs() << "ModRef queries: " << cacheStatistics.hitsNum + cacheStatistics.missesNum
+                 << ", cache hit rate: " << llvm::format("%.2f", cacheStatistics.getHitRate() * 100) << "%"
+                 << ", cache flushes: " << cacheStatistics.flushesNum << "\n";
+}
+
+} // unnamed namespace
+
+int main(int argc, char** argv)
+{
+    llvm::llvm_shutdown_obj shutdown;
+    llvm::cl::ParseCommandLineOptions(argc, argv, "Program dependence graph builder\n");
+
+    llvm::LLVMContext context;
+    llvm::SMDiagnostic diagnostic;
+    std::unique_ptr<llvm::Module> M = llvm::getLazyIRFileModule(InputFilename, diagnostic, context);
+    if (!M) {
+        diagnostic.print(argv[0], llvm::errs());
+        return 1;
+    }
+
+    const bool useSVF = DefUse == SVFGDefUse || IndirectCalls == SVFIndirectCalls;
+    if (useSVF && !MaterializeAll) {
+        llvm::errs() << "pdg-build: -def-use=svfg and -indirect-calls=svf analyze the whole module "
+                     << "and load all function bodies, pass -materialize-all to allow it\n";
+        return 1;
+    }
+    if (MaterializeAll) {
+        if (auto error = M->materializeAll()) {
+            llvm::logAllUnhandledErrors(std::move(error), llvm::errs(), "pdg-build: ");
+            return 1;
+        }
+    }
+
+    pdg::FunctionAnalyses analyses(*M);
+    bool materializationFailed = false;
+    // functions failed to materialize are built without bodies, the build fails once it is done
+    auto materializer = [&] (llvm::Function* F) {
+        if (auto error = F->materialize()) {
+            llvm::logAllUnhandledErrors(std::move(error), llvm::errs(), "pdg-build: ");
+            materializationFailed = true;
+            return false;
+        }
+        analyses.computeDominance(F);
+        return true;
+    };
+
+    std::unique_ptr<SVFModule> svfM;
+    std::unique_ptr<AndersenWaveDiff> ander;
+    std::unique_ptr<SVFGBuilder> svfgBuilder;
+    JoiningThread andersenThread;
+    if (useSVF) {
+        // SVF module is created upfront, since it may change the IR
+        svfM.reset(new SVFModule(*M));
+        ander.reset(new svfg::PDGAndersenWaveDiff());
+        ander->disablePrintStat();
+        andersenThread.start([&svfM, &ander] () {
+            ander->analyze(*svfM);
+        });
+    }
+
+    using DefUseResultsTy = pdg::PDGBuilder::DefUseResultsTy;
+    using IndCSResultsTy = pdg::PDGBuilder::IndCSResultsTy;
+    using DominanceResultsTy = pdg::PDGBuilder::DominanceResultsTy;
+    DefUseResultsTy defUse;
+    // kept for walk statistics
+    std::shared_ptr<pdg::LLVMMemorySSADefUseAnalysisResults> memorySSADefUse;
+    if (DefUse == LLVMDefUse) {
+        auto memSSAGetter = [&analyses] (llvm::Function* F) {
+            return analyses.getMemorySSA(F);
+        };
+        auto aliasAnalysisResGetter = [&analyses] (llvm::Function* F) {
+            return analyses.getAAResults(F);
+        };
+        memorySSADefUse = std::make_shared<pdg::LLVMMemorySSADefUseAnalysisResults>(memSSAGetter,
+                                                                                      aliasAnalysisResGetter);
+        memorySSADefUse->setPrecomputeDefSites(PrecomputeDefSites);
+        // memory uses of a function are connected at once, all its analyses can go afterwards
+        memorySSADefUse->setAAResultsReleaser([&analyses] (llvm::Function* F) {
+            analyses.release(F);
+        });
+        defUse = memorySSADefUse;
+    }
+    IndCSResultsTy indCSRes;
+    if (IndirectCalls == TypeIndirectCalls) {
+        // function types are known without materializing bodies
+        auto typeResults = std::make_shared<pdg::IndirectCallSiteAnalysisResult>();
+        for (auto& F : *M) {
+            if (!F.isDeclaration()) {
+                typeResults->addIndirectCallTarget(F.getFunctionType(), &F);
+            }
+        }
+        indCSRes = typeResults;
+    }
+    // results depending on Andersen analysis, set once it is done
+    auto waitForPointerAnalysis = [&] () {
+        if (!andersenThread.join()) {
+            return;
+        }
+        if (DefUse == SVFGDefUse) {
+            svfgBuilder.reset(new SVFGBuilder(true));
+            defUse = DefUseResultsTy(new pdg::SVFGDefUseAnalysisResults(
+                        svfgBuilder->buildSVFG((BVDataPTAImpl*)ander.get())));
+        }
+        if (IndirectCalls == SVFIndirectCalls) {
+            indCSRes = IndCSResultsTy(new pdg::SVFGIndirectCallSiteResults(ander->getPTACallGraph()));
+        }
+    };
+    auto domTreeGetter = [&analyses] (llvm::Function* F) {
+        return analyses.getDomTree(F);
+    };
+    auto postdomTreeGetter = [&analyses] (llvm::Function* F) {
+        return analyses.getPostDomTree(F);
+    };
+    DominanceResultsTy domResults = DominanceResultsTy(new pdg::LLVMDominanceIntervals(domTreeGetter,
+                                                                                       postdomTreeGetter));
+
+    pdg::PDGBuilder pdgBuilder(M.get());
+    pdgBuilder.setDominanceResults(domResults);
+    pdgBuilder.setFunctionMaterializer(materializer);
+    pdgBuilder.setThreadsNum(ThreadsNum);
+    auto setPointerAnalysisResults = [&] () {
+        waitForPointerAnalysis();
+        pdgBuilder.setDesUseResults(defUse);
+        pdgBuilder.setIndirectCallSitesResults(indCSRes);
+    };
+    // reachability from roots needs indirect call targets, other modes need all results per function
+    if (!RootPatterns.empty() || !StreamFilename.empty() || !PagedFilename.empty() || !FunctionNames.empty()) {
+        setPointerAnalysisResults();
+    }
+    if (!RootPatterns.empty()) {
+        std::vector<std::string> patterns(RootPatterns.begin(), RootPatterns.end());
+        pdg::PDGBuilder::FunctionSet roots;
+        std::string error;
+        if (!pdg::PDGBuilder::findFunctions(M.get(), patterns, roots, error)) {
+            llvm::errs() << "pdg-build: -roots: " << error << "\n";
+            return 1;
+        }
+        if (roots.empty()) {
+            llvm::errs() << "pdg-build: no functions match -roots\n";
+            return 1;
+        }
+        pdgBuilder.setRoots(roots);
+    }
+    if (!StreamFilename.empty() || !PagedFilename.empty()) {
+        std::unique_ptr<llvm::raw_fd_ostream> jsonOS;
+        std::unique_ptr<FunctionPDGJSONWriter> jsonWriter;
+        if (!StreamFilename.empty()) {
+            std::error_code EC;
+            jsonOS.reset(new llvm::raw_fd_ostream(StreamFilename, EC, llvm::sys::fs::F_Text));
+            if (EC) {
+                llvm::errs() << "pdg-build: can not write " << StreamFilename << ": " << EC.message() << "\n";
+                return 1;
+            }
+            jsonWriter.reset(new FunctionPDGJSONWriter(*jsonOS));
+        }
+        std::unique_ptr<pdg::PDGPagedWriter> pagedWriter;
+        if (!PagedFilename.empty()) {
+            pagedWriter.reset(new pdg::PDGPagedWriter(PagedFilename));
+            if (!pagedWriter->isOpen()) {
+                llvm::errs() << "pdg-build: can not write " << PagedFilename << "\n";
+                return 1;
+            }
+        }
+        unsigned functionsNum = 0;
+        pdgBuilder.buildStreaming([&] (pdg::FunctionPDG& functionPDG) {
+            if (jsonWriter) {
+                jsonWriter->write(functionPDG);
+            }
+            if (pagedWriter) {
+                pagedWriter->addFunction(functionPDG);
+            }
+            analyses.release(functionPDG.getFunction());
+            domResults->invalidate(functionPDG.getFunction());
+            ++functionsNum;
+        });
+        llvm::errs() << "Functions streamed: " << functionsNum << "\n";
+        printDefUseStatistics(memorySSADefUse.get());
+        if (pagedWriter && !pagedWriter->finish(*pdgBuilder.getPDG())) {
+            llvm::errs() << "pdg-build: can not write " << PagedFilename << "\n";
+            return 1;
+        }
+        return materializationFailed ? 1 : 0;
+    }
+    if (FunctionNames.empty()) {
+        // Andersen analysis keeps running while function PDGs are built. Intraprocedural stage reads
+        // the IR and computes dominance only, it neither queries DataLayout nor creates types or
+        // constants in the context, which the analysis does and which are not thread safe
+        pdgBuilder.buildIntraprocedural();
+        setPointerAnalysisResults();
+        pdgBuilder.connectMemoryDefUses();
+        // functions without memory uses keep their dominator trees until here, link does not need them
+        analyses.releaseAll();
+        pdgBuilder.link();
+    } else {
+        pdgBuilder.buildLazily();
+    }
+    auto pdg = pdgBuilder.getPDG();
+    for (const auto& name : FunctionNames) {
+        auto* F = M->getFunction(name);
+        if (!F || !pdg->hasFunctionPDG(F)) {
+            llvm::errs() << "pdg-build: no function " << name << "\n";
+            return 1;
+        }
+        pdg->getFunctionPDG(F);
+    }
+    if (materializationFailed) {
+        return 1;
+    }
+
+    pdg->freeze();
+    llvm::errs() << "PDG nodes: " << pdg->size() << ", edges: " << pdg->getEdgesNum()
+                 << ", implicit control edges: " << pdg->getCompactGraph()->implicitEdgesSize()
+                 << ", duplicate edges skipped: " << pdg->getDuplicateEdgesNum()
+                 << ", functions not built: " << pdg->getPendingFunctionsNum() << "\n";
+    printDefUseStatistics(memorySSADefUse.get());
+    if (!OutputFilename.empty()) {
+        pdg::PDGBinaryWriter writer(*pdg);
+        if (!writer.write(OutputFilename)) {
+            llvm::errs() << "pdg-build: can not write " << OutputFilename << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
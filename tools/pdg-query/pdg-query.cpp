@@ -0,0 +1,92 @@
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "PDG/PDGPagedGraph.h"
+
+// Slices a PDG written with pdg-build -paged-output without loading the whole graph.
+// Function pages are loaded on demand and kept within the given memory budget.
+
+namespace {
+
+llvm::cl::opt<std::string> InputFilename(
+    llvm::cl::Positional,
+    llvm::cl::desc("<input paged PDG>"),
+    llvm::cl::Required);
+
+llvm::cl::list<std::string> FunctionNames(
+    "function",
+    llvm::cl::desc("Slice from all nodes of the given functions"),
+    llvm::cl::value_desc("name"),
+    llvm::cl::CommaSeparated,
+    llvm::cl::OneOrMore);
+
+llvm::cl::opt<bool> Backward(
+    "backward",
+    llvm::cl::desc("Compute backward slice instead of forward slice"),
+    llvm::cl::init(false));
+
+llvm::cl::opt<unsigned> MemoryBudget(
+    "memory-budget",
+    llvm::cl::desc("Megabytes of decoded function pages kept in memory"),
+    llvm::cl::init(256));
+
+llvm::cl::opt<bool> PrintNodes(
+    "print-nodes",
+    llvm::cl::desc("Print id, function and label of each node in the slice"),
+    llvm::cl::init(false));
+
+} // unnamed namespace
+
+int main(int argc, char** argv)
+{
+    llvm::llvm_shutdown_obj shutdown;
+    llvm::cl::ParseCommandLineOptions(argc, argv, "Program dependence graph slicer\n");
+
+    pdg::PDGPagedGraph graph;
+    if (!graph.open(InputFilename)) {
+        llvm::errs() << "pdg-query: " << graph.getError() << "\n";
+        return 1;
+    }
+    graph.setMemoryBudget(static_cast<std::size_t>(MemoryBudget) * 1024 * 1024);
+
+    std::vector<bool> inSlice(graph.size(), false);
+    pdg::PDGPagedGraph::NodeIds slice;
+    for (const auto& name : FunctionNames) {
+        const uint32_t function = graph.findFunction(name);
+        if (function == pdg::PDGPagedGraph::InvalidIndex) {
+            llvm::errs() << "pdg-query: no function " << name << "\n";
+            return 1;
+        }
+        for (auto id : graph.getFunctionNodes(function)) {
+            if (inSlice[id]) {
+                continue;
+            }
+            auto nodes = Backward ? graph.backwardSlice(id) : graph.forwardSlice(id);
+            for (auto sliceId : nodes) {
+                if (!inSlice[sliceId]) {
+                    inSlice[sliceId] = true;
+                    slice.push_back(sliceId);
+                }
+            }
+        }
+    }
+
+    if (PrintNodes) {
+        for (auto id : slice) {
+            const uint32_t function = graph.getNodeFunction(id);
+            llvm::outs() << id << "\t"
+                         << (function == pdg::PDGPagedGraph::InvalidIndex ? "" : graph.getFunctionName(function))
+                         << "\t" << graph.getNodeLabel(id) << "\n";
+        }
+    }
+    const auto& statistics = graph.getStatistics();
+    llvm::errs() << "Slice nodes: " << slice.size()
+                 << ", page hits: " << statistics.hitsNum
+                 << ", misses: " << statistics.missesNum
+                 << ", evictions: " << statistics.evictionsNum
+                 << ", hit rate: " << llvm::format("%.2f", statistics.getHitRate() * 100) << "%"
+                 << ", peak resident: " << statistics.peakResidentSize / 1024 << " KB\n";
+    return 0;
+}